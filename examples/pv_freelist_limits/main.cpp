@@ -0,0 +1,63 @@
+#include "storage/PVManagerFactory.hpp"
+#include <cstring>
+#include <iostream>
+
+using namespace yas;
+
+// prints sizes of entries stored in the PV and limits of free space bins derived from them, with --apply the derived
+// limits are saved in the PV
+// usage: pv_freelist_limits <pv_path> [--apply]
+
+int main(int argc, char *argv[]) {
+  if (argc < 2 || (argc > 2 && 0 != std::strcmp(argv[2], "--apply"))) {
+    std::cout << "usage: " << argv[0] << " <pv_path> [--apply]\n";
+    return -1;
+  }
+
+  const fs::path pv_path{ argv[1] };
+  if (!fs::exists(pv_path)) {
+    std::cout << "PV doesn't exist: " << pv_path << '\n';
+    return -1;
+  }
+
+  const utils::Version desired_version{ 1,1 };
+  auto &factory = storage::PVManagerFactory::Instance();
+  auto manager = factory.Create(pv_path, desired_version);
+  if (!manager) {
+    std::cout << manager.error().message_;
+    return -1;
+  }
+
+  auto pv_manager = manager.value();
+  using FreelistHelperType = freelist_helper::FreelistHelper<DOffsetType>;
+  try {
+    const auto entry_sizes = pv_manager->GetEntrySizesHistogram();
+    std::cout << "entry size: count\n";
+    for (const auto &[entry_size, count] : entry_sizes) {
+      std::cout << entry_size << ": " << count << '\n';
+    }
+
+    const auto print_limits = [](const char *title, const FreelistHelperType::limits_type &limits) {
+      std::cout << title;
+      for (const auto limit : limits) {
+        std::cout << ' ' << limit;
+      }
+      std::cout << '\n';
+    };
+
+    const auto cluster_size = pv_manager->cluster_size();
+    const auto derived_limits = FreelistHelperType::DeriveLimits(entry_sizes, cluster_size);
+    print_limits("current limits:", pv_manager->freelist_limits());
+    print_limits("derived limits:", derived_limits);
+    if (argc > 2) {
+      pv_manager->freelist_limits(derived_limits);
+      std::cout << "derived limits are applied\n";
+    }
+  }
+  catch (const exception::YASException &exception) {
+    std::cout << exception.getError().message_;
+    return -1;
+  }
+
+  return 0;
+}
@@ -2,13 +2,40 @@
 #include "lib/physical_volume/PVDeviceDataReaderWriter.hpp"
 #include "lib/physical_volume/PVEntriesManager.hpp"
 #include "lib/inverted_index/InvertedIndexHelper.hpp"
+#include "lib/devices/MappedRegion.hpp"
 #include "lib/exceptions/ExceptionHandler.hpp"
 #include "IStorage.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <limits>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace yas {
 namespace storage {
 
+// describes how changes of the index are saved between Load/Create and close (see PVManager::index_sync_policy)
+struct IndexSyncPolicy {
+  // if it isn't zero, the changed index is saved by the background thread with this interval
+  std::chrono::milliseconds sync_interval_{ 0 };
+  // changes are appended to the index log until its size exceeds this part of the saved index, then the whole index
+  // is saved again (the checkpoint) and the log is dropped
+  double checkpoint_ratio_ = 0.25;
+};
+
 /**
  *    \brief This class encapsulates all high-level storage-like operations on one Physical Volume (PV)
  *
@@ -19,14 +46,28 @@ namespace storage {
 template <typename CharType=DCharType, typename OffsetType=DOffsetType, typename Device=DDevice>
 class PVManager : public IStorage<CharType> {
   using InvertedIndexType = index_helper::InvertedIndexHelper<CharType, OffsetType>;
+  using IndexLogType = index_helper::IndexLogHelper<CharType, OffsetType>;
   using PVEntriesManagerType = pv::PVEntriesManager<OffsetType, Device>;
+  static constexpr std::chrono::microseconds kCompactionStepTime{ 2000 };
+  // the first version that saves the index in the flat format (see FlatTrieIndex), it is queried in place after Load
+  static constexpr utils::Version kFlatIndexVersion = utils::Version(1, 5);
+  // the first version that saves changes of the index to the log (see IndexLogHelper) instead of the whole index
+  static constexpr utils::Version kIndexLogVersion = utils::Version(1, 6);
+  using FreelistLimitsType = typename freelist_helper::FreelistHelper<OffsetType>::limits_type;
+  // read-only operations could be processed simultaneously only if the device supports concurrent reads
+  using ReadLockType = std::conditional_t<Device::kConcurrentRead, std::shared_lock<std::shared_mutex>,
+      std::unique_lock<std::shared_mutex>>;
+  using WriteLockType = std::unique_lock<std::shared_mutex>;
 
  public:
   using pv_manager_type = PVManager<CharType, OffsetType, Device>;
   using key_type = typename IStorage<CharType>::key_type;
   using pv_path_type = typename Device::path_type;
+  using get_result_type = nonstd::expected<storage_value_type, StorageErrorDescriptor>;
 
   virtual ~PVManager() {
+    stopExtender();
+    stopIndexSyncer();
     close();
   }
 
@@ -39,6 +80,12 @@ class PVManager : public IStorage<CharType> {
     auto pv_volume_manager = std::unique_ptr<pv_manager_type>(new pv_manager_type(pv_path, version));
 
     pv_volume_manager->inverted_index_offset_ = pv_volume_manager->entries_manager_.LoadStartEntries();
+    if (!(pv_volume_manager->entries_manager_.pv_version() < kFlatIndexVersion)) {
+      pv_volume_manager->loadIndex(pv_path);
+      pv_volume_manager->inverted_index_->log_changes(!(version < kIndexLogVersion));
+      return pv_volume_manager;
+    }
+
     const auto serialized_index = pv_volume_manager->entries_manager_.GetEntryContent(
         pv_volume_manager->inverted_index_offset_);
     const auto &vector_serialized_index = std::get<ByteVector>(serialized_index);
@@ -48,6 +95,11 @@ class PVManager : public IStorage<CharType> {
         version);
 
     pv_volume_manager->inverted_index_ = std::move(indexer);
+    pv_volume_manager->inverted_index_->log_changes(!(version < kIndexLogVersion));
+    pv_volume_manager->checkpoint_offset_ = pv_volume_manager->inverted_index_offset_;
+    pv_volume_manager->checkpoint_size_ = vector_serialized_index.size();
+    // the index is saved in the format of the newer version
+    pv_volume_manager->is_checkpoint_needed_ = !(version < kFlatIndexVersion);
     return pv_volume_manager;
   }
 
@@ -55,27 +107,39 @@ class PVManager : public IStorage<CharType> {
   ///         returns success) then it tries to load existing by Load method. Can throw YASExceptions if device fails.
   ///  \param pv_path - a path to newly created PV
   ///  \param version - the maximum supported version (PVEntriesManager could use it for parsing)
+  ///  \param cluster_size - from kMinimumClusterSize up to kMaximumClusterSize, huge clusters (f.e. 2M) suit PVs of
+  ///         big blobs
+  ///  \param freelist_limits - limits of free space bins, by default they are chosen by the cluster size
   ///  \return - the new PVManager instance
   static std::unique_ptr<pv_manager_type> Create(pv_path_type pv_path, utils::Version version,
-      int32_t priority, int32_t cluster_size = kDefaultClusterSize) {
+      int32_t priority, int32_t cluster_size = kDefaultClusterSize,
+      const std::optional<FreelistLimitsType> &freelist_limits = {}) {
     if (Device::Exists(pv_path)) {
       return Load(pv_path, version);
     }
 
+    // some devices (f.e. DirectFileDevice) work better with clusters multiple of their block size
+    cluster_size = Device::RecommendedClusterSize(cluster_size);
+    PVEntriesManagerType::CheckClusterSize(cluster_size);
     Device::CreateEmpty(pv_path);
 
     // std::make_unique needs access to the class ctor
     auto pv_volume_manager = std::unique_ptr<pv_manager_type>(new pv_manager_type(pv_path, version, priority, 
         cluster_size));
+    if (freelist_limits) {
+      pv_volume_manager->entries_manager_.freelist_limits(*freelist_limits);
+    }
     pv_volume_manager->entries_manager_.SaveStartEntries(offset_traits<OffsetType>::NonExistValue());
     pv_volume_manager->inverted_index_.reset(new InvertedIndexType());
+    pv_volume_manager->inverted_index_->log_changes(!(version < kIndexLogVersion));
     pv_volume_manager->inverted_index_offset_ = offset_traits<OffsetType>::NonExistValue();
     return pv_volume_manager;
   }
 
   StorageErrorDescriptor Put(key_type key, const storage_value_type &value) noexcept override {
     try {
-      std::lock_guard<std::mutex> lock(manager_guard_mutex_);
+      WriteLockType lock(manager_guard_mutex_);
+      waitAsyncReads();
 
       if (value.valueless_by_exception()) {
         return { "Put key: value is valueless", StorageError::kIncorrectStorageValue };
@@ -87,6 +151,12 @@ class PVManager : public IStorage<CharType> {
 
       const auto offset = entries_manager_.CreateNewEntryValue(value);
       inverted_index_->Insert(key, offset);
+      if (!(version_ < kIndexLogVersion)) {
+        unsynced_entries_.insert(offset);
+      }
+      if (entries_manager_.IsReserveLow()) {
+        notifyExtender();
+      }
       return { std::string(), StorageError::kSuccess };
     }
     catch (...) {
@@ -96,7 +166,7 @@ class PVManager : public IStorage<CharType> {
 
   nonstd::expected<storage_value_type, StorageErrorDescriptor> Get(key_type key) noexcept override {
     try {
-      std::lock_guard<std::mutex> lock(manager_guard_mutex_);
+      ReadLockType lock(manager_guard_mutex_);
 
       const auto entry_offset = inverted_index_->Get(key);
       if (!index_helper::leaf_type_traits<OffsetType>::IsExistValue(entry_offset)) {
@@ -109,8 +179,8 @@ class PVManager : public IStorage<CharType> {
       }
 
       // delete expired values during access
-      entries_manager_.DeleteEntry(entry_offset);
-      inverted_index_->Delete(key);
+      lock.unlock();
+      deleteExpiredEntry(key);
       return nonstd::make_unexpected(StorageErrorDescriptor{ "Get key: key hasn't been found",
           StorageError::kKeyNotFound });
     }
@@ -119,9 +189,51 @@ class PVManager : public IStorage<CharType> {
     }
   }
 
+  ///  \brief asynchronous version of Get: the entry is read by chains of device submissions without blocking of the
+  ///         caller thread. Available only for devices that support asynchronous reads (f.e. AsyncFileDevice).
+  ///         Note that an expired entry is reported as absent, but it is deleted only by the next synchronous access.
+  ///  \param key - key to get
+  ///  \return - the future with the same result as Get would return
+  std::future<get_result_type> GetAsync(key_type key) {
+    auto promise = std::make_shared<std::promise<get_result_type>>();
+    auto result = promise->get_future();
+    try {
+      ReadLockType lock(manager_guard_mutex_);
+
+      const auto entry_offset = inverted_index_->Get(key);
+      if (!index_helper::leaf_type_traits<OffsetType>::IsExistValue(entry_offset)) {
+        promise->set_value(nonstd::make_unexpected(StorageErrorDescriptor{ "Get key: key hasn't been found",
+            StorageError::kKeyNotFound }));
+        return result;
+      }
+
+      // writers wait for all async reads, so entries couldn't be changed until the callback is called
+      ++async_reads_count_;
+      entries_manager_.GetEntryContentAsync(entry_offset,
+          [this, promise](std::optional<storage_value_type> value, std::exception_ptr exception) {
+        if (exception) {
+          promise->set_value(nonstd::make_unexpected(exception::ExceptionHandler::Handle(exception)));
+        }
+        else if (!value.has_value()) {
+          promise->set_value(nonstd::make_unexpected(StorageErrorDescriptor{ "Get key: key hasn't been found",
+              StorageError::kKeyNotFound }));
+        }
+        else {
+          promise->set_value(std::move(value.value()));
+        }
+        completeAsyncRead();
+      });
+    }
+    catch (...) {
+      promise->set_value(nonstd::make_unexpected(exception::ExceptionHandler::Handle(std::current_exception())));
+    }
+
+    return result;
+  }
+
   StorageErrorDescriptor HasKey(key_type key) noexcept override {
     try {
-      std::lock_guard<std::mutex> lock(manager_guard_mutex_);
+      ReadLockType lock(manager_guard_mutex_);
 
       const auto entry_offset = inverted_index_->Get(key);
       if (!index_helper::leaf_type_traits<OffsetType>::IsExistValue(entry_offset)) {
@@ -133,8 +245,8 @@ class PVManager : public IStorage<CharType> {
       }
 
       // delete expired values during access
-      entries_manager_.DeleteEntry(entry_offset);
-      inverted_index_->Delete(key);
+      lock.unlock();
+      deleteExpiredEntry(key);
       return { std::string(), StorageError::kKeyNotFound};
     }
     catch (...) {
@@ -144,7 +256,7 @@ class PVManager : public IStorage<CharType> {
 
   StorageErrorDescriptor HasCatalog(key_type key) noexcept override {
     try {
-      std::lock_guard<std::mutex> lock(manager_guard_mutex_);
+      ReadLockType lock(manager_guard_mutex_);
 
       return 0 == inverted_index_->FindMaxSubKey(key) ?
           StorageErrorDescriptor{ std::string(), StorageError::kKeyNotFound } :
@@ -157,13 +269,14 @@ class PVManager : public IStorage<CharType> {
 
    StorageErrorDescriptor Delete(key_type key) noexcept override {
     try {
-      std::lock_guard<std::mutex> lock(manager_guard_mutex_);
+      WriteLockType lock(manager_guard_mutex_);
+      waitAsyncReads();
 
       const auto entry_offset = inverted_index_->Get(key);
       if (!index_helper::leaf_type_traits<OffsetType>::IsExistValue(entry_offset)) {
         return { "Delete key: the key hasn't been found", StorageError::kKeyNotFound };
       }
-      entries_manager_.DeleteEntry(entry_offset);
+      deleteValueEntry(entry_offset);
       inverted_index_->Delete(key);
       return { std::string(), StorageError::kSuccess };
     }
@@ -174,7 +287,8 @@ class PVManager : public IStorage<CharType> {
 
   StorageErrorDescriptor SetExpiredDate(key_type key, time_t expired) noexcept override {
     try {
-      std::lock_guard<std::mutex> lock(manager_guard_mutex_);
+      WriteLockType lock(manager_guard_mutex_);
+      waitAsyncReads();
 
       const auto entry_offset = inverted_index_->Get(key);
       if (!index_helper::leaf_type_traits<OffsetType>::IsExistValue(entry_offset)) {
@@ -191,7 +305,7 @@ class PVManager : public IStorage<CharType> {
 
   nonstd::expected<time_t, StorageErrorDescriptor> GetExpiredDate(key_type key) noexcept override {
     try {
-      std::lock_guard<std::mutex> lock(manager_guard_mutex_);
+      ReadLockType lock(manager_guard_mutex_);
 
       const auto entry_offset = inverted_index_->Get(key);
       if (!index_helper::leaf_type_traits<OffsetType>::IsExistValue(entry_offset)) {
@@ -212,6 +326,203 @@ class PVManager : public IStorage<CharType> {
 
   int32_t priority() const { return entries_manager_.priority(); }
 
+  ///  \brief the growth policy isn't saved in PV, so it should be set after each Load/Create (f.e. bigger
+  ///         expansions for append-heavy ingest). If the low water mark is set, the device space is reserved
+  ///         right away and then the background thread refills it when Put finds it low. If the shrink threshold
+  ///         is set, the free space at the PV end is given back after deletes. Note that the policy shouldn't be
+  ///         changed from several threads simultaneously.
+  pv::GrowthPolicy growth_policy() const { return entries_manager_.growth_policy(); }
+  void growth_policy(const pv::GrowthPolicy &growth_policy) {
+    {
+      WriteLockType lock(manager_guard_mutex_);
+      waitAsyncReads();
+      entries_manager_.growth_policy(growth_policy);
+      entries_manager_.ReserveAhead();
+    }
+
+    if (0 == growth_policy.low_water_mark_) {
+      stopExtender();
+    }
+    else if (!extender_thread_.joinable()) {
+      is_extender_stopped_ = false;
+      extender_thread_ = std::thread([this]() { extendInBackground(); });
+      is_extender_running_ = true;
+    }
+  }
+
+  ///  \brief the sync policy isn't saved in PV, by default the index is saved only on close (and by SyncIndex). If
+  ///         the sync interval is set, the background thread saves the changed index periodically, so a crash loses
+  ///         only changes made after the last sync. Since 1.6 only changes are appended to the index log, the whole
+  ///         index is saved when the log becomes big enough (see IndexSyncPolicy::checkpoint_ratio_). Note that the
+  ///         policy shouldn't be changed from several threads simultaneously.
+  IndexSyncPolicy index_sync_policy() const { return index_sync_policy_; }
+  void index_sync_policy(const IndexSyncPolicy &index_sync_policy) {
+    stopIndexSyncer();
+    {
+      WriteLockType lock(manager_guard_mutex_);
+      index_sync_policy_ = index_sync_policy;
+    }
+
+    if (0 != index_sync_policy.sync_interval_.count()) {
+      is_index_syncer_stopped_ = false;
+      index_syncer_thread_ = std::thread([this, sync_interval = index_sync_policy.sync_interval_]() {
+        syncIndexInBackground(sync_interval);
+      });
+    }
+  }
+
+  ///  \brief saves changes of the index and the free space index, so they survive a crash of the process. Since the
+  ///         version 1.6 the space of values deleted after the last sync is reused only after the next one (the saved
+  ///         index could refer to them), except values put after the last sync. Can throw YASException if device fails.
+  void SyncIndex() {
+    WriteLockType lock(manager_guard_mutex_);
+    waitAsyncReads();
+    saveIndex();
+  }
+
+  ///  \brief the fit policy of free space allocations isn't saved in PV (by default it is the best fit). The first fit
+  ///         keeps values closer to the PV beginning, but free entries are also kept ordered by offsets in each bin
+  ///         (more memory) and smaller entries of the bin of the requested size are skipped one by one.
+  freelist_helper::FitPolicy fit_policy() const { return entries_manager_.fit_policy(); }
+  void fit_policy(freelist_helper::FitPolicy fit_policy) {
+    WriteLockType lock(manager_guard_mutex_);
+    waitAsyncReads();
+    entries_manager_.fit_policy(fit_policy);
+  }
+
+  ///  \brief in the slab mode small values (numbers and short strings) are packed into clusters dedicated to their
+  ///         size class, so their allocation doesn't search the free space and neighbour values share device pages.
+  ///         The mode is saved in PV. Switching it off keeps already placed values, but the free space of slabs
+  ///         returns to the common free space.
+  bool slab_mode() const { return entries_manager_.slab_mode(); }
+  void slab_mode(bool is_slab_mode) {
+    WriteLockType lock(manager_guard_mutex_);
+    waitAsyncReads();
+    entries_manager_.slab_mode(is_slab_mode);
+  }
+
+  int32_t cluster_size() const { return entries_manager_.cluster_size(); }
+
+  ///  \brief limits of free space bins are saved in PV. Free entries up to the limit of the bin are kept together,
+  ///         so limits matching sizes of stored values make allocations faster and PV less fragmented. Can throw
+  ///         YASException with kInvalidFreelistLimits if limits aren't increasing multiples of 4.
+  const FreelistLimitsType& freelist_limits() const { return entries_manager_.freelist_limits(); }
+  void freelist_limits(const FreelistLimitsType &freelist_limits) {
+    WriteLockType lock(manager_guard_mutex_);
+    waitAsyncReads();
+    entries_manager_.freelist_limits(freelist_limits);
+  }
+
+  ///  \brief collects sizes of entries of all stored values (only the first chunk for large values), f.e. for
+  ///         FreelistHelper::DeriveLimits. Can throw YASException if device fails.
+  ///  \return - the map of entry sizes to their counts
+  std::map<OffsetType, uint64_t> GetEntrySizesHistogram() {
+    ReadLockType lock(manager_guard_mutex_);
+    std::map<OffsetType, uint64_t> entry_sizes;
+    inverted_index_->VisitLeaves([this, &entry_sizes](OffsetType entry_offset) {
+      ++entry_sizes[entries_manager_.GetEntrySize(entry_offset)];
+    });
+    return entry_sizes;
+  }
+
+  ///  \brief gives the free space at the PV end back to the device (values aren't moved, see CompactStep). It is
+  ///         done automatically after deletes if GrowthPolicy::shrink_threshold_ is set. Can throw YASException if
+  ///         device fails.
+  ///  \return - the count of released bytes
+  OffsetType Shrink() {
+    WriteLockType lock(manager_guard_mutex_);
+    waitAsyncReads();
+    return entries_manager_.ReleaseTailSpace();
+  }
+
+  ///  \brief one step of the online compaction: values are moved to the free space closer to the PV beginning
+  ///         (from the PV end) until time_budget is exhausted, the step is done under the write lock, so other
+  ///         operations are processed between steps. Old places of moved values are reused only after the index is
+  ///         saved (at the end of each pass or by SyncIndex), so PV left by a crash is still valid. When no value could
+  ///         be moved anymore the free space at the PV end is given back to the device. Can throw YASException if
+  ///         device fails.
+  ///  \param time_budget - the time after which the step stops (at least one value is processed)
+  ///  \return - true if the compaction is finished, the next call starts the new one
+  bool CompactStep(std::chrono::microseconds time_budget) {
+    WriteLockType lock(manager_guard_mutex_);
+    waitAsyncReads();
+    const auto deadline = std::chrono::steady_clock::now() + time_budget;
+
+    // entries (and the saved index) are processed from the PV end, the cursor keeps the place of the previous step
+    std::vector<OffsetType> entry_offsets;
+    inverted_index_->VisitLeaves([this, &entry_offsets](OffsetType entry_offset) {
+      if (entry_offset < compaction_cursor_) {
+        entry_offsets.push_back(entry_offset);
+      }
+    });
+    // entries of the index log refer to previous ones, so only the index without the log is moved
+    if (offset_traits<OffsetType>::IsExistValue(inverted_index_offset_) && log_offsets_.empty() &&
+        inverted_index_offset_ < compaction_cursor_) {
+      // the flat index could be mapped from its entry, so it is built before the entry is moved
+      inverted_index_->Materialize();
+      entry_offsets.push_back(inverted_index_offset_);
+    }
+    std::sort(std::begin(entry_offsets), std::end(entry_offsets), std::greater<OffsetType>());
+
+    std::unordered_map<OffsetType, OffsetType> moved_entries;
+    compaction_cursor_ = 0;
+    for (const auto entry_offset : entry_offsets) {
+      const auto new_entry_offset = entries_manager_.MoveEntryLower(entry_offset);
+      if (new_entry_offset != entry_offset) {
+        moved_entries.emplace(entry_offset, new_entry_offset);
+      }
+      if (std::chrono::steady_clock::now() >= deadline) {
+        compaction_cursor_ = entry_offset;
+        break;
+      }
+    }
+
+    if (!moved_entries.empty()) {
+      is_compaction_moved_ = true;
+      const auto moved_index = moved_entries.find(inverted_index_offset_);
+      if (std::cend(moved_entries) != moved_index) {
+        inverted_index_offset_ = moved_index->second;
+        checkpoint_offset_ = moved_index->second;
+        moved_entries.erase(moved_index);
+      }
+      // moved values aren't logged as changes, so the whole index is saved by the next sync
+      is_checkpoint_needed_ = is_checkpoint_needed_ || !moved_entries.empty();
+      if (!(version_ < kIndexLogVersion)) {
+        for (const auto &[entry_offset, new_entry_offset] : moved_entries) {
+          unsynced_entries_.erase(entry_offset);
+          unsynced_entries_.insert(new_entry_offset);
+        }
+      }
+      inverted_index_->UpdateLeaves([&moved_entries](OffsetType &entry_offset) {
+        if (const auto moved_entry = moved_entries.find(entry_offset); std::cend(moved_entries) != moved_entry) {
+          entry_offset = moved_entry->second;
+        }
+      });
+    }
+
+    if (0 != compaction_cursor_) {
+      return false;
+    }
+    // the pass over all entries is finished, the next one could move entries into the space freed by this one
+    compaction_cursor_ = std::numeric_limits<OffsetType>::max();
+    if (is_compaction_moved_ || entries_manager_.HasMovedEntries()) {
+      is_compaction_moved_ = false;
+      // old places of moved values are freed only after the index refers to the new ones, so the next pass could
+      // move values there and the tail is released only by the pass that hasn't moved anything
+      saveIndex();
+      return false;
+    }
+    entries_manager_.ReleaseTailSpace();
+    return true;
+  }
+
+  ///  \brief compacts PV by steps of kCompactionStepTime (see CompactStep) until the compaction is finished
+  void Compact() {
+    while (!CompactStep(kCompactionStepTime)) {
+      std::this_thread::yield();
+    }
+  }
+
 #ifdef UNIT_TEST
   PVEntriesManagerType& entries_manager() const { return entries_manager_; }
 #endif
@@ -223,10 +534,42 @@ class PVManager : public IStorage<CharType> {
 
  private:
   std::unique_ptr<InvertedIndexType> inverted_index_;
+  // the last saved entry of the index: the checkpoint or the last entry of the index log that refers to it
   OffsetType inverted_index_offset_;
+  OffsetType checkpoint_offset_ = offset_traits<OffsetType>::NonExistValue();
+  uint64_t checkpoint_size_ = 0;
+  std::vector<OffsetType> log_offsets_;
+  uint64_t log_size_ = 0;
+  // true if the index should be saved whole by the next sync (f.e. its format differs from version_)
+  bool is_checkpoint_needed_ = false;
+  // values deleted after the last sync which the saved index could refer to (they are deleted by the next sync) and
+  // values put after it (they could be deleted at once), see deleteValueEntry
+  std::vector<OffsetType> unsynced_deletes_;
+  std::unordered_set<OffsetType> unsynced_entries_;
+  IndexSyncPolicy index_sync_policy_;
   PVEntriesManagerType entries_manager_;
-  std::mutex manager_guard_mutex_;
+  std::shared_mutex manager_guard_mutex_;
   utils::Version version_;
+  // count of GetAsync calls that haven't been completed yet
+  std::atomic<int32_t> async_reads_count_ = 0;
+  std::mutex async_reads_mutex_;
+  std::condition_variable async_reads_condition_;
+  // the background thread that refills the reserved device space (see GrowthPolicy::low_water_mark_)
+  std::thread extender_thread_;
+  std::mutex extender_mutex_;
+  std::condition_variable extender_condition_;
+  bool is_extender_stopped_ = false;
+  bool is_extend_requested_ = false;
+  // Put checks it instead of extender_thread_, which is started and joined without the manager lock
+  std::atomic<bool> is_extender_running_ = false;
+  // the background thread that saves the changed index (see IndexSyncPolicy::sync_interval_)
+  std::thread index_syncer_thread_;
+  std::mutex index_syncer_mutex_;
+  std::condition_variable index_syncer_condition_;
+  bool is_index_syncer_stopped_ = false;
+  // entries before the cursor haven't been processed by the current pass of the compaction
+  OffsetType compaction_cursor_ = std::numeric_limits<OffsetType>::max();
+  bool is_compaction_moved_ = false;
 
   PVManager(const fs::path &file_path, utils::Version version, uint32_t priority = 0,
       uint32_t cluster_size = kDefaultClusterSize)
@@ -235,24 +578,272 @@ class PVManager : public IStorage<CharType> {
   }
 
   void close() {
+    waitAsyncReads();
     if (!inverted_index_) {
       return;
     }
     try {
-      if (inverted_index_->is_changed()) {
-        const auto serialized_index = inverted_index_->template Serialize<OffsetType>(version_);
-        if (offset_traits<OffsetType>::IsExistValue(inverted_index_offset_)) {
-          entries_manager_.DeleteEntry(inverted_index_offset_);
-        }
-        inverted_index_offset_ = entries_manager_.CreateNewEntryValue(serialized_index);
-      }
-      entries_manager_.SaveStartEntries(inverted_index_offset_);
+      saveIndex();
     }
     catch (...) {
       // in future relize there should be some code to save trie while OOM (it could be throwed by Serialize method)
     }
   }
 
+  // changes are appended to the index log if it is possible, otherwise the whole index is saved. Replaced entries
+  // of the index, values deleted after the previous sync and old places of moved values are deleted only after the
+  // header refers to the new index, so the saved index is always valid
+  void saveIndex() {
+    std::vector<OffsetType> replaced_entries;
+    if (is_checkpoint_needed_ || (inverted_index_->is_changed() && !appendIndexLog())) {
+      replaced_entries = writeIndexCheckpoint();
+    }
+    entries_manager_.SaveStartEntries(inverted_index_offset_);
+
+    replaced_entries.insert(std::end(replaced_entries), std::cbegin(unsynced_deletes_), std::cend(unsynced_deletes_));
+    unsynced_deletes_.clear();
+    unsynced_entries_.clear();
+
+    if (replaced_entries.empty() && !entries_manager_.HasMovedEntries()) {
+      return;
+    }
+    entries_manager_.FreeMovedEntries();
+    for (const auto entry_offset : replaced_entries) {
+      entries_manager_.DeleteEntry(entry_offset);
+    }
+    entries_manager_.SaveStartEntries(inverted_index_offset_);
+  }
+
+  bool appendIndexLog() {
+    if (version_ < kIndexLogVersion) {
+      return false;
+    }
+    else if (inverted_index_->changes().empty()) {
+      inverted_index_->ClearChanges();
+      return true;
+    }
+
+    const auto serialized_log = IndexLogType::Serialize(inverted_index_->changes(), inverted_index_offset_, version_);
+    if (static_cast<double>(log_size_ + serialized_log.size()) >
+        index_sync_policy_.checkpoint_ratio_ * static_cast<double>(checkpoint_size_)) {
+      return false;
+    }
+
+    inverted_index_offset_ = entries_manager_.CreateNewEntryValue(serialized_log);
+    log_offsets_.push_back(inverted_index_offset_);
+    log_size_ += serialized_log.size();
+    inverted_index_->ClearChanges();
+    return true;
+  }
+
+  // returns entries of the replaced checkpoint and its log
+  std::vector<OffsetType> writeIndexCheckpoint() {
+    // the flat index could be mapped from the replaced checkpoint
+    inverted_index_->Materialize();
+    const bool is_flat_index = !(version_ < kFlatIndexVersion);
+    const auto serialized_index = is_flat_index ? inverted_index_->SerializeFlat(version_) :
+        inverted_index_->template Serialize<OffsetType>(version_);
+
+    std::vector<OffsetType> replaced_entries = std::move(log_offsets_);
+    if (offset_traits<OffsetType>::IsExistValue(checkpoint_offset_)) {
+      replaced_entries.push_back(checkpoint_offset_);
+    }
+    // the flat index is placed in one extent, so it could be mapped by the next Load
+    checkpoint_offset_ = is_flat_index ? entries_manager_.CreateNewExtentEntry(serialized_index) :
+        entries_manager_.CreateNewEntryValue(serialized_index);
+    checkpoint_size_ = serialized_index.size();
+    inverted_index_offset_ = checkpoint_offset_;
+    log_offsets_.clear();
+    log_size_ = 0;
+    is_checkpoint_needed_ = false;
+    inverted_index_->ClearChanges();
+    return replaced_entries;
+  }
+
+  // entries of the index log are walked from the last one to the checkpoint, then their changes are applied to the
+  // checkpoint from the oldest one
+  void loadIndex(const pv_path_type &pv_path) {
+    std::vector<std::vector<typename InvertedIndexType::change_type>> logs_changes;
+    OffsetType entry_offset = inverted_index_offset_;
+    while (true) {
+      if (!offset_traits<OffsetType>::IsExistValue(entry_offset)) {
+        inverted_index_.reset(new InvertedIndexType());
+        break;
+      }
+
+      const auto [data_owner, data, size] = readIndexEntry(pv_path, entry_offset);
+      if (!IndexLogType::IsIndexLog(data, size)) {
+        inverted_index_ = openFlatIndex(data_owner, data, size);
+        checkpoint_offset_ = entry_offset;
+        checkpoint_size_ = size;
+        break;
+      }
+      else if (std::cend(log_offsets_) != std::find(std::cbegin(log_offsets_), std::cend(log_offsets_),
+          entry_offset)) {
+        throw exception::YASException("Index log parsing: entries of the log are looped",
+            StorageError::kInvertedIndexDeserializationError);
+      }
+
+      log_offsets_.push_back(entry_offset);
+      log_size_ += size;
+      logs_changes.emplace_back();
+      entry_offset = static_cast<OffsetType>(IndexLogType::Deserialize(data, size, version_, logs_changes.back()));
+    }
+
+    std::reverse(std::begin(log_offsets_), std::end(log_offsets_));
+    std::for_each(std::crbegin(logs_changes), std::crend(logs_changes), [this](const auto &changes) {
+      inverted_index_->ApplyChanges(changes);
+    });
+  }
+
+  // the checkpoint in the flat format isn't deserialized: it is mapped from the device if the device allows it,
+  // otherwise entries are readed as one blob. Returns the owner of data, data and its size
+  std::tuple<std::shared_ptr<const void>, const uint8_t*, size_t> readIndexEntry(const pv_path_type &pv_path,
+      OffsetType entry_offset) {
+    if constexpr (Device::kMappable) {
+      if (const auto data_range = entries_manager_.GetExtentDataRange(entry_offset)) {
+        auto region = std::make_shared<devices::MappedRegion>(pv_path, data_range->first, data_range->second);
+        const auto *data = region->data();
+        const auto size = static_cast<size_t>(region->size());
+        return { std::move(region), data, size };
+      }
+    }
+
+    auto serialized_entry = std::make_shared<ByteVector>(std::get<ByteVector>(
+        entries_manager_.GetEntryContent(entry_offset)));
+    const auto *data = serialized_entry->data();
+    const auto size = serialized_entry->size();
+    return { std::move(serialized_entry), data, size };
+  }
+
+  std::unique_ptr<InvertedIndexType> openFlatIndex(std::shared_ptr<const void> data_owner, const uint8_t *data,
+      size_t size) {
+    using FlatIndexType = typename InvertedIndexType::flat_index_type;
+    return InvertedIndexType::Open(FlatIndexType(std::move(data_owner), data, size, version_));
+  }
+
+  // since kIndexLogVersion the index saved by the last sync could refer to the deleted value, so its space isn't
+  // reused (and it isn't marked as free) until the next sync, otherwise PV left by the crash of the process could
+  // read the data of another value. Values put after the last sync aren't saved anywhere and are deleted at once
+  void deleteValueEntry(OffsetType entry_offset) {
+    if (version_ < kIndexLogVersion || 0 != unsynced_entries_.erase(entry_offset)) {
+      entries_manager_.DeleteEntry(entry_offset);
+    }
+    else {
+      unsynced_deletes_.push_back(entry_offset);
+    }
+  }
+
+  void deleteExpiredEntry(key_type key) {
+    WriteLockType lock(manager_guard_mutex_);
+    waitAsyncReads();
+
+    // the key could be changed by another thread after the read lock has been released
+    const auto entry_offset = inverted_index_->Get(key);
+    if (index_helper::leaf_type_traits<OffsetType>::IsExistValue(entry_offset) && isEntryExpired(entry_offset)) {
+      deleteValueEntry(entry_offset);
+      inverted_index_->Delete(key);
+    }
+  }
+
+  // should be called under the write lock, so new async reads couldn't be started
+  void waitAsyncReads() {
+    if (0 == async_reads_count_) {
+      return;
+    }
+
+    std::unique_lock<std::mutex> lock(async_reads_mutex_);
+    async_reads_condition_.wait(lock, [this]() { return 0 == async_reads_count_; });
+  }
+
+  void completeAsyncRead() {
+    // notify under the lock because the manager could be destroyed right after the wait is over
+    std::lock_guard<std::mutex> lock(async_reads_mutex_);
+    --async_reads_count_;
+    async_reads_condition_.notify_all();
+  }
+
+  void notifyExtender() {
+    if (!is_extender_running_) {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(extender_mutex_);
+    is_extend_requested_ = true;
+    extender_condition_.notify_one();
+  }
+
+  void stopExtender() {
+    if (!extender_thread_.joinable()) {
+      return;
+    }
+
+    is_extender_running_ = false;
+    {
+      std::lock_guard<std::mutex> lock(extender_mutex_);
+      is_extender_stopped_ = true;
+      extender_condition_.notify_one();
+    }
+    extender_thread_.join();
+  }
+
+  void extendInBackground() noexcept {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(extender_mutex_);
+        extender_condition_.wait(lock, [this]() { return is_extender_stopped_ || is_extend_requested_; });
+        if (is_extender_stopped_) {
+          return;
+        }
+        is_extend_requested_ = false;
+      }
+
+      try {
+        WriteLockType lock(manager_guard_mutex_);
+        waitAsyncReads();
+        entries_manager_.ReserveAhead();
+      }
+      catch (...) {
+        // the foreground allocation would grow the device itself and report the error
+      }
+    }
+  }
+
+  void stopIndexSyncer() {
+    if (!index_syncer_thread_.joinable()) {
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(index_syncer_mutex_);
+      is_index_syncer_stopped_ = true;
+      index_syncer_condition_.notify_one();
+    }
+    index_syncer_thread_.join();
+  }
+
+  void syncIndexInBackground(std::chrono::milliseconds sync_interval) noexcept {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(index_syncer_mutex_);
+        if (index_syncer_condition_.wait_for(lock, sync_interval, [this]() { return is_index_syncer_stopped_; })) {
+          return;
+        }
+      }
+
+      try {
+        WriteLockType lock(manager_guard_mutex_);
+        waitAsyncReads();
+        if (inverted_index_->is_changed() || is_checkpoint_needed_) {
+          saveIndex();
+        }
+      }
+      catch (...) {
+        // the index is saved again by the next sync or on close
+      }
+    }
+  }
+
   bool isEntryExpired(OffsetType offset) {
     auto expired_date = entries_manager_.GetEntryExpiredDate(offset);
     return expired_date.has_value() ? expired_date.value().IsExpired() : false;
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define YAS_BIT_UTILS_SSE2
+#endif
+
+namespace yas {
+namespace bit_utils {
+
+// returns the index of the lowest set bit, value shouldn't be zero
+inline uint32_t CountTrailingZeros(uint64_t value) noexcept {
+#ifdef _MSC_VER
+  unsigned long index = 0;
+  _BitScanForward64(&index, value);
+  return static_cast<uint32_t>(index);
+#elif defined(__GNUC__)
+  return static_cast<uint32_t>(__builtin_ctzll(value));
+#else
+  uint32_t index = 0;
+  while (!(value & 1)) {
+    value >>= 1;
+    ++index;
+  }
+  return index;
+#endif
+}
+
+// returns the index of the highest set bit, value shouldn't be zero
+inline uint32_t HighestSetBit(uint64_t value) noexcept {
+#ifdef _MSC_VER
+  unsigned long index = 0;
+  _BitScanReverse64(&index, value);
+  return static_cast<uint32_t>(index);
+#elif defined(__GNUC__)
+  return static_cast<uint32_t>(63 - __builtin_clzll(value));
+#else
+  uint32_t index = 0;
+  while (value >>= 1) {
+    ++index;
+  }
+  return index;
+#endif
+}
+
+inline uint32_t PopCount(uint64_t value) noexcept {
+#ifdef _MSC_VER
+  return static_cast<uint32_t>(__popcnt64(value));
+#elif defined(__GNUC__)
+  return static_cast<uint32_t>(__builtin_popcountll(value));
+#else
+  uint32_t count = 0;
+  for (; value; value &= value - 1) {
+    ++count;
+  }
+  return count;
+#endif
+}
+
+// returns the position of byte among the first count bytes or count if there is no such byte. All 16 bytes are
+// compared at once, so the array should be 16 bytes long even if count is less
+inline uint32_t FindByte16(const uint8_t *bytes, uint32_t count, uint8_t byte) noexcept {
+#ifdef YAS_BIT_UTILS_SSE2
+  const auto matches = _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(byte)),
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes)));
+  const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(matches)) & ((1u << count) - 1);
+  return mask ? CountTrailingZeros(mask) : count;
+#else
+  for (uint32_t position = 0; position < count; ++position) {
+    if (bytes[position] == byte) {
+      return position;
+    }
+  }
+  return count;
+#endif
+}
+
+} // namespace bit_utils
+} // namespace yas
@@ -0,0 +1,105 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace yas {
+namespace devices {
+
+// The pool of equal-sized aligned buffers (f.e. bounce buffers for O_DIRECT IO). Released buffers are kept for
+// reuse up to max_free_buffers_count, so the steady state doesn't have any allocations.
+class AlignedBufferPool {
+ public:
+  // returns the buffer to the pool on destruction
+  class Buffer {
+   public:
+    Buffer(AlignedBufferPool *pool, uint8_t *data) noexcept
+        : pool_(pool),
+          data_(data) {
+    }
+
+    ~Buffer() {
+      if (nullptr != data_) {
+        pool_->release(data_);
+      }
+    }
+
+    Buffer(Buffer &&other) noexcept
+        : pool_(other.pool_),
+          data_(other.data_) {
+      other.data_ = nullptr;
+    }
+
+    uint8_t *data() const noexcept { return data_; }
+
+    Buffer(const Buffer&) = delete;
+    Buffer& operator=(const Buffer&) = delete;
+    Buffer& operator=(Buffer&&) = delete;
+
+   private:
+    AlignedBufferPool *pool_;
+    uint8_t *data_;
+  };
+
+  AlignedBufferPool(size_t buffer_size, size_t alignment, size_t max_free_buffers_count = 4)
+      : buffer_size_(buffer_size),
+        alignment_(alignment),
+        max_free_buffers_count_(max_free_buffers_count) {
+    free_buffers_.reserve(max_free_buffers_count_);
+  }
+
+  ~AlignedBufferPool() {
+    for (auto buffer : free_buffers_) {
+      deallocate(buffer);
+    }
+  }
+
+  Buffer Acquire() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!free_buffers_.empty()) {
+        auto buffer = free_buffers_.back();
+        free_buffers_.pop_back();
+        return Buffer(this, buffer);
+      }
+    }
+
+    return Buffer(this, static_cast<uint8_t*>(::operator new(buffer_size_, std::align_val_t(alignment_))));
+  }
+
+  size_t buffer_size() const noexcept { return buffer_size_; }
+
+  AlignedBufferPool(const AlignedBufferPool&) = delete;
+  AlignedBufferPool(AlignedBufferPool&&) = delete;
+  AlignedBufferPool& operator=(const AlignedBufferPool&) = delete;
+  AlignedBufferPool& operator=(AlignedBufferPool&&) = delete;
+
+ private:
+  const size_t buffer_size_;
+  const size_t alignment_;
+  const size_t max_free_buffers_count_;
+  std::vector<uint8_t*> free_buffers_;
+  std::mutex mutex_;
+
+  void release(uint8_t *buffer) noexcept {
+    try {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (free_buffers_.size() < max_free_buffers_count_) {
+        free_buffers_.push_back(buffer);
+        return;
+      }
+    }
+    catch (...) {
+      // the buffer is just deallocated
+    }
+    deallocate(buffer);
+  }
+
+  void deallocate(uint8_t *buffer) const noexcept {
+    ::operator delete(buffer, std::align_val_t(alignment_));
+  }
+};
+
+} // namespace devices
+} // namespace yas
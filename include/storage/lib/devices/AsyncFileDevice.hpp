@@ -0,0 +1,302 @@
+#pragma once
+#include "PosixFileDevice.hpp"
+#include "IOUringQueue.hpp"
+#include "ThreadPoolIOQueue.hpp"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace yas {
+namespace devices {
+
+// This device extends PosixFileDevice with asynchronous reads. Reads are submitted by batches to io_uring (or to
+// the pool of reader threads if io_uring isn't available) and their callbacks are called from the one completion
+// thread, so a callback could submit the next reads (f.e. to walk through a chain of complex type chunks)
+// without blocking any thread. Available only on POSIX systems.
+template <typename OffsetType>
+class AsyncFileDevice {
+ public:
+  using path_type = fs::path;
+  // the parameter is true if all requested bytes have been readed
+  using read_callback_type = std::function<void(bool)>;
+
+  static constexpr bool kConcurrentRead = true;
+  // parts of the file could be mapped directly (see MappedRegion)
+  static constexpr bool kMappable = true;
+
+  struct AsyncRead {
+    OffsetType position_;
+    uint8_t *data_;
+    uint32_t size_;
+    read_callback_type callback_;
+  };
+
+  // path should be optimized by compiler through copy elision
+  explicit AsyncFileDevice(path_type path, bool is_io_uring_allowed = true)
+      : device_(std::move(path)),
+        is_io_uring_allowed_(is_io_uring_allowed) {
+    Open();
+  }
+
+  ~AsyncFileDevice() {
+    Close();
+  }
+
+  AsyncFileDevice(const AsyncFileDevice &other)
+      : device_(other.device_),
+        is_io_uring_allowed_(other.is_io_uring_allowed_) {
+    Open();
+  }
+
+  template <typename Iterator>
+  void Read(OffsetType position, Iterator begin, Iterator end) {
+    device_.Read(position, begin, end);
+  }
+
+  template <typename Iterator>
+  OffsetType Write(OffsetType position, const Iterator begin, const Iterator end) {
+    return device_.Write(position, begin, end);
+  }
+
+  void ReadV(const std::vector<ReadSegment<OffsetType>> &segments) {
+    device_.ReadV(segments);
+  }
+
+  OffsetType WriteV(const std::vector<WriteSegment<OffsetType>> &segments) {
+    return device_.WriteV(segments);
+  }
+
+  void Reserve(OffsetType size) {
+    device_.Reserve(size);
+  }
+
+  void Truncate(OffsetType size) {
+    device_.Truncate(size);
+  }
+
+  ///  \brief submits the batch of reads, the callback of each read would be called from the completion thread
+  ///         (also the callback could be called from this method with false if the read can't be submitted, f.e.
+  ///         the device is being closed)
+  void SubmitReads(std::vector<AsyncRead> reads) {
+    std::vector<read_callback_type> failed_callbacks;
+    {
+      std::lock_guard<std::mutex> lock(submit_mutex_);
+      for (auto &read : reads) {
+        if (is_stopped_) {
+          failed_callbacks.push_back(std::move(read.callback_));
+          continue;
+        }
+
+        auto pending_read = std::make_unique<AsyncRead>(std::move(read));
+        const AsyncReadDescriptor descriptor{ pending_read->position_, pending_read->data_, pending_read->size_,
+            reinterpret_cast<uint64_t>(pending_read.get()) };
+        {
+          // the completion thread takes care of it
+          std::lock_guard<std::mutex> pending_lock(pending_reads_mutex_);
+          pending_reads_.emplace(descriptor.user_data_, std::move(pending_read));
+        }
+        if (!push(descriptor)) {
+          failed_callbacks.push_back(std::move(takePendingRead(descriptor.user_data_)->callback_));
+        }
+      }
+      // queues are released by Close
+      if (!is_stopped_) {
+        submit();
+      }
+    }
+
+    for (auto &callback : failed_callbacks) {
+      callback(false);
+    }
+  }
+
+  bool IsIOUringUsed() const noexcept {
+    return io_uring_queue_ && io_uring_queue_->IsAvailable();
+  }
+
+  OffsetType Size() const {
+    return device_.Size();
+  }
+
+  bool IsOpen() const noexcept {
+    return device_.IsOpen() && completion_thread_.joinable();
+  }
+
+  // reads submitted before are completed (their callbacks are called) before the device is closed
+  bool Close() noexcept {
+    if (completion_thread_.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(submit_mutex_);
+        is_stopped_ = true;
+        IsIOUringUsed() ? io_uring_queue_->PushWakeUp() : thread_pool_queue_->PushWakeUp();
+        submit();
+      }
+      completion_thread_.join();
+    }
+    io_uring_queue_.reset();
+    thread_pool_queue_.reset();
+    return device_.Close();
+  }
+
+  static int32_t RecommendedClusterSize(int32_t cluster_size) noexcept {
+    return PosixFileDevice<OffsetType>::RecommendedClusterSize(cluster_size);
+  }
+
+  static bool Exists(const path_type &pv_path) {
+    return PosixFileDevice<OffsetType>::Exists(pv_path);
+  }
+
+  static void CreateEmpty(const path_type &pv_path) {
+    PosixFileDevice<OffsetType>::CreateEmpty(pv_path);
+  }
+
+  static path_type Canonical(const path_type &pv_path) {
+    return PosixFileDevice<OffsetType>::Canonical(pv_path);
+  }
+
+  AsyncFileDevice operator=(const AsyncFileDevice&) = delete;
+  AsyncFileDevice operator=(AsyncFileDevice&&) = delete;
+  AsyncFileDevice(AsyncFileDevice&&) = delete;
+
+ private:
+  static constexpr uint32_t kIOUringEntriesCount = 256;
+  static constexpr uint32_t kFallbackThreadsCount = 4;
+  // the completion thread waits longer after each failed completion, the queue is considered broken after this count
+  // of consecutive failures (and all pending reads are failed)
+  static constexpr uint32_t kMaxCompleteErrorsCount = 8;
+  static constexpr std::chrono::milliseconds kCompleteErrorDelay{ 1 };
+
+  PosixFileDevice<OffsetType> device_;
+  bool is_io_uring_allowed_;
+  std::unique_ptr<IOUringQueue> io_uring_queue_;
+  std::unique_ptr<ThreadPoolIOQueue> thread_pool_queue_;
+  std::thread completion_thread_;
+  std::mutex submit_mutex_;
+  std::atomic<bool> is_stopped_ = false;
+  // reads submitted to the queue by their user data
+  std::unordered_map<uint64_t, std::unique_ptr<AsyncRead>> pending_reads_;
+  std::mutex pending_reads_mutex_;
+
+  void Open() {
+    if (!device_.IsOpen()) {
+      return;
+    }
+
+    if (is_io_uring_allowed_) {
+      io_uring_queue_ = std::make_unique<IOUringQueue>(kIOUringEntriesCount);
+    }
+    if (!IsIOUringUsed()) {
+      io_uring_queue_.reset();
+      thread_pool_queue_ = std::make_unique<ThreadPoolIOQueue>(kFallbackThreadsCount);
+    }
+    completion_thread_ = std::thread([this]() { processCompletions(); });
+  }
+
+  bool push(const AsyncReadDescriptor &descriptor) noexcept {
+    try {
+      if (!IsIOUringUsed()) {
+        return thread_pool_queue_->Push(device_.Descriptor(), descriptor);
+      }
+      if (io_uring_queue_->Push(device_.Descriptor(), descriptor)) {
+        return true;
+      }
+      // the submission queue is full - pass it to the kernel and try again
+      io_uring_queue_->Submit();
+      return io_uring_queue_->Push(device_.Descriptor(), descriptor);
+    }
+    catch (...) {
+      return false;
+    }
+  }
+
+  void submit() noexcept {
+    try {
+      IsIOUringUsed() ? io_uring_queue_->Submit() : thread_pool_queue_->Submit();
+    }
+    catch (...) {
+      // pushed requests would be submitted by the next submit call
+    }
+  }
+
+  std::unique_ptr<AsyncRead> takePendingRead(uint64_t user_data) {
+    std::lock_guard<std::mutex> lock(pending_reads_mutex_);
+    const auto pending_read_it = pending_reads_.find(user_data);
+    if (std::end(pending_reads_) == pending_read_it) {
+      return nullptr;
+    }
+    auto pending_read = std::move(pending_read_it->second);
+    pending_reads_.erase(pending_read_it);
+    return pending_read;
+  }
+
+  bool hasPendingReads() {
+    std::lock_guard<std::mutex> lock(pending_reads_mutex_);
+    return !pending_reads_.empty();
+  }
+
+  static void callCallback(const AsyncRead &read, bool is_readed) noexcept {
+    try {
+      read.callback_(is_readed);
+    }
+    catch (...) {
+      // callbacks shouldn't break the completion thread
+    }
+  }
+
+  // after the stop the thread works until all pending reads are completed
+  void processCompletions() noexcept {
+    std::vector<AsyncReadCompletion> completions;
+    uint32_t errors_count = 0;
+    while (!is_stopped_ || hasPendingReads()) {
+      completions.clear();
+      try {
+        IsIOUringUsed() ? io_uring_queue_->Complete(completions, true) :
+            thread_pool_queue_->Complete(completions, true);
+        errors_count = 0;
+      }
+      catch (...) {
+        if (++errors_count == kMaxCompleteErrorsCount) {
+          failPendingReads();
+          return;
+        }
+        std::this_thread::sleep_for(kCompleteErrorDelay * (1 << errors_count));
+        continue;
+      }
+
+      for (const auto &completion : completions) {
+        if (kWakeUpUserData == completion.user_data_) {
+          continue;
+        }
+
+        if (const auto pending_read = takePendingRead(completion.user_data_)) {
+          callCallback(*pending_read, completion.result_ == static_cast<int64_t>(pending_read->size_));
+        }
+      }
+    }
+  }
+
+  // new reads aren't accepted anymore, the pending ones get false
+  void failPendingReads() noexcept {
+    {
+      std::lock_guard<std::mutex> lock(submit_mutex_);
+      is_stopped_ = true;
+    }
+
+    std::unordered_map<uint64_t, std::unique_ptr<AsyncRead>> pending_reads;
+    {
+      std::lock_guard<std::mutex> lock(pending_reads_mutex_);
+      pending_reads.swap(pending_reads_);
+    }
+    for (const auto &[user_data, pending_read] : pending_reads) {
+      callCallback(*pending_read, false);
+    }
+  }
+};
+
+} // namespace devices
+} // namespace yas
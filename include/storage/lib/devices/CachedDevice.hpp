@@ -0,0 +1,296 @@
+#pragma once
+#include "../common/common.h"
+#include "../exceptions/YASException.hpp"
+#include "io_segments.h"
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace yas {
+namespace devices {
+
+// This adapter keeps the recently used pages of any other device in memory, so repeated reads of the same entry
+// headers (that PVEntriesManager does a lot) don't reach the underlying device. Pages are evicted by the CLOCK
+// algorithm when the memory budget is exhausted, dirty pages are written back during eviction and Close.
+// Note that cached reads change the cache state, so they can't be processed simultaneously.
+template <typename Device, uint32_t kPageSize = 0x1000>
+class CachedDevice {
+ public:
+  using path_type = typename Device::path_type;
+  using offset_type = decltype(std::declval<Device>().Size());
+
+  static constexpr bool kConcurrentRead = false;
+  // the file is the same as the file of the underlying device, dirty pages are written back on Close
+  static constexpr bool kMappable = Device::kMappable;
+  static constexpr size_t kDefaultMemoryBudget = 0x400000;
+
+  // path should be optimized by compiler through copy elision
+  explicit CachedDevice(path_type path, size_t memory_budget = kDefaultMemoryBudget)
+      : device_(std::move(path)) {
+    this->memory_budget(memory_budget);
+    if (device_.IsOpen()) {
+      device_size_ = device_.Size();
+      size_ = device_size_;
+    }
+  }
+
+  ~CachedDevice() {
+    Close();
+  }
+
+  template <typename Iterator>
+  void Read(offset_type position, Iterator begin, Iterator end) {
+    const auto read_size = static_cast<offset_type>(std::distance(begin, end));
+    if (position > size_ || read_size > size_ - position) {
+      throw(exception::YASException("Cached device read error: read after the device end",
+          storage::StorageError::kDeviceReadError));
+    }
+
+    while (begin != end) {
+      const auto &page = getPage(position / kPageSize, true);
+      const auto page_offset = position % kPageSize;
+      const auto chunk_size = std::min<offset_type>(kPageSize - page_offset, std::distance(begin, end));
+
+      auto page_begin = std::cbegin(page.data_);
+      std::advance(page_begin, page_offset);
+      auto page_end = page_begin;
+      std::advance(page_end, chunk_size);
+      begin = std::copy(page_begin, page_end, begin);
+      position += chunk_size;
+    }
+  }
+
+  template <typename Iterator>
+  offset_type Write(offset_type position, Iterator begin, const Iterator end) {
+    const auto write_size = static_cast<offset_type>(std::distance(begin, end));
+    while (begin != end) {
+      const auto page_offset = position % kPageSize;
+      const auto chunk_size = std::min<offset_type>(kPageSize - page_offset, std::distance(begin, end));
+
+      // the page that is fully overwritten doesn't have to be loaded from the device
+      auto &page = getPage(position / kPageSize, chunk_size != kPageSize);
+      auto chunk_end = begin;
+      std::advance(chunk_end, chunk_size);
+      auto page_begin = std::begin(page.data_);
+      std::advance(page_begin, page_offset);
+      std::copy(begin, chunk_end, page_begin);
+      page.is_dirty_ = true;
+
+      begin = chunk_end;
+      position += chunk_size;
+      size_ = std::max(size_, position);
+    }
+
+    return write_size;
+  }
+
+  ///  \brief writes all dirty pages to the underlying device
+  void Flush() {
+    // pages are written in ascending order because some devices don't allow writes after their end
+    std::vector<size_t> dirty_slots;
+    for (size_t slot_id = 0; slot_id < pages_.size(); ++slot_id) {
+      if (pages_[slot_id].is_dirty_) {
+        dirty_slots.push_back(slot_id);
+      }
+    }
+    std::sort(std::begin(dirty_slots), std::end(dirty_slots), [this](size_t first, size_t second) {
+      return pages_[first].page_id_ < pages_[second].page_id_;
+    });
+
+    for (const auto slot_id : dirty_slots) {
+      flushPage(pages_[slot_id]);
+    }
+  }
+
+  ///  \brief makes the underlying device at least size bytes long (cached pages after its end are still flushed)
+  void Reserve(offset_type size) {
+    device_.Reserve(size);
+    device_size_ = std::max(device_size_, size);
+    size_ = std::max(size_, size);
+  }
+
+  ///  \brief makes the underlying device at most size bytes long, cached pages after the new end are dropped
+  void Truncate(offset_type size) {
+    if (size >= size_) {
+      return;
+    }
+
+    // pages are flushed at first, so the underlying device doesn't get gaps before the new end
+    Flush();
+    const auto is_dropped = [size](const Page &page) { return page.page_id_ * kPageSize >= size; };
+    pages_.erase(std::remove_if(std::begin(pages_), std::end(pages_), is_dropped), std::end(pages_));
+    page_slots_.clear();
+    for (size_t slot_id = 0; slot_id < pages_.size(); ++slot_id) {
+      auto &page = pages_[slot_id];
+      page_slots_[page.page_id_] = slot_id;
+      // the tail of the last page could be read again after the device grows
+      const offset_type page_begin = page.page_id_ * kPageSize;
+      if (page_begin + kPageSize > size) {
+        auto tail_begin = std::begin(page.data_);
+        std::advance(tail_begin, size - page_begin);
+        std::fill(tail_begin, std::end(page.data_), 0);
+      }
+    }
+    clock_hand_ = 0;
+
+    device_.Truncate(size);
+    device_size_ = std::min(device_size_, size);
+    size_ = size;
+  }
+
+  offset_type Size() const noexcept {
+    return size_;
+  }
+
+  void ReadV(const std::vector<ReadSegment<offset_type>> &segments) {
+    ReadSegments(*this, segments);
+  }
+
+  offset_type WriteV(const std::vector<WriteSegment<offset_type>> &segments) {
+    return WriteSegments(*this, segments);
+  }
+
+  bool IsOpen() const noexcept {
+    return device_.IsOpen();
+  }
+
+  bool Close() noexcept {
+    if (!device_.IsOpen()) {
+      return true;
+    }
+
+    bool is_success = true;
+    try {
+      Flush();
+    }
+    catch (...) {
+      is_success = false;
+    }
+    return device_.Close() && is_success;
+  }
+
+  uint64_t hits_count() const noexcept { return hits_count_; }
+  uint64_t misses_count() const noexcept { return misses_count_; }
+  size_t memory_budget() const noexcept { return pages_limit_ * kPageSize; }
+
+  // if the budget is decreased all pages are flushed and dropped
+  void memory_budget(size_t memory_budget) {
+    const auto pages_limit = std::max<size_t>(1, memory_budget / kPageSize);
+    if (pages_limit < pages_.size()) {
+      Flush();
+      pages_.clear();
+      page_slots_.clear();
+      clock_hand_ = 0;
+    }
+    pages_limit_ = pages_limit;
+  }
+
+  static int32_t RecommendedClusterSize(int32_t cluster_size) noexcept {
+    return Device::RecommendedClusterSize(cluster_size);
+  }
+
+  static bool Exists(const path_type &pv_path) {
+    return Device::Exists(pv_path);
+  }
+
+  static void CreateEmpty(const path_type &pv_path) {
+    Device::CreateEmpty(pv_path);
+  }
+
+  static path_type Canonical(const path_type &pv_path) {
+    return Device::Canonical(pv_path);
+  }
+
+  // the copy would share dirty pages with the original device
+  CachedDevice(const CachedDevice&) = delete;
+  CachedDevice(CachedDevice&&) = delete;
+  CachedDevice operator=(const CachedDevice&) = delete;
+  CachedDevice operator=(CachedDevice&&) = delete;
+
+ private:
+  struct Page {
+    offset_type page_id_;
+    ByteVector data_;
+    bool is_dirty_;
+    bool is_referenced_;
+  };
+
+  Device device_;
+  std::vector<Page> pages_;
+  std::unordered_map<offset_type, size_t> page_slots_;
+  size_t pages_limit_ = 1;
+  size_t clock_hand_ = 0;
+  offset_type device_size_ = 0;     // the size of the underlying device
+  offset_type size_ = 0;            // the logical size including not yet flushed pages
+  uint64_t hits_count_ = 0;
+  uint64_t misses_count_ = 0;
+
+  Page &getPage(offset_type page_id, bool is_load_needed) {
+    if (auto slot = page_slots_.find(page_id); slot != std::end(page_slots_)) {
+      ++hits_count_;
+      auto &page = pages_[slot->second];
+      page.is_referenced_ = true;
+      return page;
+    }
+
+    ++misses_count_;
+    const auto slot_id = getFreeSlot();
+    auto &page = pages_[slot_id];
+    page.page_id_ = page_id;
+    page.is_dirty_ = false;
+    page.is_referenced_ = true;
+    std::fill(std::begin(page.data_), std::end(page.data_), 0);
+
+    const offset_type page_begin = page_id * kPageSize;
+    if (is_load_needed && page_begin < device_size_) {
+      const auto load_size = std::min<offset_type>(kPageSize, device_size_ - page_begin);
+      auto load_end = std::begin(page.data_);
+      std::advance(load_end, load_size);
+      device_.Read(page_begin, std::begin(page.data_), load_end);
+    }
+
+    page_slots_[page_id] = slot_id;
+    return page;
+  }
+
+  size_t getFreeSlot() {
+    if (pages_.size() < pages_limit_) {
+      pages_.push_back({ 0, ByteVector(kPageSize), false, false });
+      return pages_.size() - 1;
+    }
+
+    // CLOCK: the hand gives the second chance to each referenced page
+    while (pages_[clock_hand_].is_referenced_) {
+      pages_[clock_hand_].is_referenced_ = false;
+      clock_hand_ = (clock_hand_ + 1) % pages_.size();
+    }
+
+    const auto slot_id = clock_hand_;
+    clock_hand_ = (clock_hand_ + 1) % pages_.size();
+    auto &page = pages_[slot_id];
+    if (page.is_dirty_ && page.page_id_ * kPageSize > device_size_) {
+      // there would be a gap in the underlying device - write all preceding pages first
+      Flush();
+    }
+    else if (page.is_dirty_) {
+      flushPage(page);
+    }
+    page_slots_.erase(page.page_id_);
+    return slot_id;
+  }
+
+  void flushPage(Page &page) {
+    const offset_type page_begin = page.page_id_ * kPageSize;
+    const auto flush_size = std::min<offset_type>(kPageSize, size_ - page_begin);
+    auto flush_end = std::cbegin(page.data_);
+    std::advance(flush_end, flush_size);
+    device_.Write(page_begin, std::cbegin(page.data_), flush_end);
+    device_size_ = std::max(device_size_, page_begin + flush_size);
+    page.is_dirty_ = false;
+  }
+};
+
+} // namespace devices
+} // namespace yas
@@ -0,0 +1,280 @@
+#pragma once
+#include "../common/filesystem.h"
+#include "../common/common.h"
+#include "../exceptions/YASException.hpp"
+#include "io_segments.h"
+#include "AlignedBufferPool.hpp"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace yas {
+namespace devices {
+
+// This device bypasses the kernel page cache by O_DIRECT, so the memory used by PV is limited only by the cache
+// layer that is chosen by user (f.e. CachedDevice). O_DIRECT requires block-aligned positions, sizes and buffers,
+// so all IO goes through aligned bounce buffers from the pool and partially written edge blocks are read before
+// they are written. If the file system doesn't support O_DIRECT (f.e. tmpfs) the file is opened in usual mode with
+// the same aligned IO. Available only on Linux.
+template <typename OffsetType>
+class DirectFileDevice {
+ public:
+  using path_type = fs::path;
+
+  // reads use positional IO and buffers from the thread-safe pool
+  static constexpr bool kConcurrentRead = true;
+  // the file isn't mapped: the mapping would bring it back to the page cache, and mapped pages aren't guaranteed to
+  // be coherent with direct writes, so the saved index is read through the aligned pool too
+  static constexpr bool kMappable = false;
+
+  // the logical block size that is suitable for the most of devices
+  static constexpr uint32_t kBlockSize = 0x1000;
+
+  // path should be optimized by compiler through copy elision
+  explicit DirectFileDevice(path_type path)
+      : path_(std::move(path)),
+        buffer_pool_(kBufferSize, kBlockSize) {
+    Open();
+  }
+
+  ~DirectFileDevice() {
+    Close();
+  }
+
+  DirectFileDevice(const DirectFileDevice &other)
+      : path_(other.path_),
+        buffer_pool_(kBufferSize, kBlockSize) {
+    Open();
+  }
+
+  template <typename Iterator>
+  void Read(OffsetType position, Iterator begin, Iterator end) {
+    if (!IsOpen()) {
+      throw(exception::YASException("Direct device read error: the device hasn't been opened during read",
+          storage::StorageError::kDeviceReadError));
+    }
+
+    auto read_size = static_cast<OffsetType>(std::distance(begin, end));
+    if (position > size_ || read_size > size_ - position) {
+      throw(exception::YASException("Direct device read error: read after the file end",
+          storage::StorageError::kDeviceReadError));
+    }
+
+    auto buffer = buffer_pool_.Acquire();
+    while (read_size > 0) {
+      const auto window_begin = alignDown(position);
+      const auto chunk_size = std::min<OffsetType>(read_size, kBufferSize - (position - window_begin));
+      const auto window_size = alignUp(position + chunk_size) - window_begin;
+      readWindow(window_begin, window_size, buffer.data());
+
+      begin = std::copy_n(buffer.data() + (position - window_begin), chunk_size, begin);
+      position += chunk_size;
+      read_size -= chunk_size;
+    }
+  }
+
+  template <typename Iterator>
+  OffsetType Write(OffsetType position, Iterator begin, const Iterator end) {
+    if (!IsOpen()) {
+      throw(exception::YASException("Direct device write error: the device hasn't been opened during write",
+          storage::StorageError::kDeviceWriteError));
+    }
+
+    const auto write_size = static_cast<OffsetType>(std::distance(begin, end));
+    auto remain_size = write_size;
+    auto buffer = buffer_pool_.Acquire();
+    while (remain_size > 0) {
+      const auto window_begin = alignDown(position);
+      const auto chunk_size = std::min<OffsetType>(remain_size, kBufferSize - (position - window_begin));
+      const auto window_end = alignUp(position + chunk_size);
+
+      // edge blocks that are written partially should keep their content
+      if (position != window_begin) {
+        readWindow(window_begin, kBlockSize, buffer.data());
+      }
+      const auto tail_block = alignDown(position + chunk_size);
+      if (tail_block != position + chunk_size && (tail_block != window_begin || position == window_begin)) {
+        readWindow(tail_block, kBlockSize, buffer.data() + (tail_block - window_begin));
+      }
+
+      auto chunk_end = begin;
+      std::advance(chunk_end, chunk_size);
+      std::copy(begin, chunk_end, buffer.data() + (position - window_begin));
+      writeWindow(window_begin, window_end - window_begin, buffer.data());
+
+      begin = chunk_end;
+      position += chunk_size;
+      remain_size -= chunk_size;
+      size_ = std::max<OffsetType>(size_, position);
+    }
+
+    return write_size;
+  }
+
+  void ReadV(const std::vector<ReadSegment<OffsetType>> &segments) {
+    ReadSegments(*this, segments);
+  }
+
+  OffsetType WriteV(const std::vector<WriteSegment<OffsetType>> &segments) {
+    return WriteSegments(*this, segments);
+  }
+
+  ///  \brief makes the file at least size bytes long, the new space is reserved by fallocate without writing it
+  ///         (or the file is just truncated if the file system doesn't support it)
+  void Reserve(OffsetType size) {
+    const OffsetType file_size = size_;
+    if (size <= file_size) {
+      return;
+    }
+
+    if (0 != ::fallocate(file_descriptor_, 0, static_cast<off_t>(file_size), static_cast<off_t>(size - file_size)) &&
+        0 != ::ftruncate(file_descriptor_, static_cast<off_t>(size))) {
+      throw(exception::YASException("Direct device expand error: the file can't be expanded",
+          storage::StorageError::kDeviceExpandError));
+    }
+    size_ = std::max<OffsetType>(size_, size);
+  }
+
+  ///  \brief makes the file at most size bytes long (f.e. to give the free space at the PV end back)
+  void Truncate(OffsetType size) {
+    if (size >= size_) {
+      return;
+    }
+
+    if (0 != ::ftruncate(file_descriptor_, static_cast<off_t>(size))) {
+      throw(exception::YASException("Direct device truncate error: the file can't be truncated",
+          storage::StorageError::kDeviceWriteError));
+    }
+    size_ = size;
+  }
+
+  bool IsOpen() const noexcept {
+    return -1 != file_descriptor_;
+  }
+
+  // true if the page cache is really bypassed
+  bool IsDirect() const noexcept {
+    return is_direct_;
+  }
+
+  OffsetType Size() const noexcept {
+    return size_;
+  }
+
+  bool Close() noexcept {
+    if (!IsOpen()) {
+      return true;
+    }
+
+    // the last block is always written entirely, so the file should be truncated to its logical size
+    bool is_success = (0 == ::ftruncate(file_descriptor_, static_cast<off_t>(size_.load())));
+    is_success &= (0 == ::close(file_descriptor_));
+    file_descriptor_ = -1;
+    return is_success;
+  }
+
+  ///  \brief returns the cluster size that keeps clusters multiple of the device block
+  static int32_t RecommendedClusterSize(int32_t cluster_size) noexcept {
+    return static_cast<int32_t>((cluster_size + kBlockSize - 1) / kBlockSize * kBlockSize);
+  }
+
+  static bool Exists(const path_type &pv_path) {
+    return fs::exists(pv_path);
+  }
+
+  static void CreateEmpty(const path_type &pv_path) {
+    std::ofstream out(pv_path, std::ios_base::out);
+  }
+
+  static path_type Canonical(const path_type &pv_path) {
+    return fs::canonical(pv_path);
+  }
+
+  DirectFileDevice operator=(const DirectFileDevice&) = delete;
+  DirectFileDevice operator=(DirectFileDevice&&) = delete;
+  DirectFileDevice(DirectFileDevice&&) = delete;
+
+ private:
+  // the maximum size of one IO request
+  static constexpr OffsetType kBufferSize = 16 * kBlockSize;
+
+  fs::path path_;
+  AlignedBufferPool buffer_pool_;
+  int file_descriptor_ = -1;
+  bool is_direct_ = false;
+  std::atomic<OffsetType> size_ = 0;      // the logical size of the file (maximum written position)
+
+  void Open() {
+    file_descriptor_ = ::open(path_.c_str(), O_RDWR | O_DIRECT);
+    is_direct_ = IsOpen();
+    if (!IsOpen() && EINVAL == errno) {
+      file_descriptor_ = ::open(path_.c_str(), O_RDWR);
+    }
+    if (!IsOpen()) {
+      return;
+    }
+
+    struct stat file_stat;
+    if (0 != ::fstat(file_descriptor_, &file_stat)) {
+      Close();
+      return;
+    }
+    size_ = static_cast<OffsetType>(file_stat.st_size);
+  }
+
+  static OffsetType alignDown(OffsetType position) noexcept {
+    return position / kBlockSize * kBlockSize;
+  }
+
+  static OffsetType alignUp(OffsetType position) noexcept {
+    return (position + kBlockSize - 1) / kBlockSize * kBlockSize;
+  }
+
+  // the part of the window after the file end is filled by zeroes
+  void readWindow(OffsetType position, OffsetType size, uint8_t *data) {
+    OffsetType readed_size = 0;
+    while (readed_size < size) {
+      const auto readed = ::pread(file_descriptor_, data + readed_size, size - readed_size,
+          static_cast<off_t>(position + readed_size));
+      if (readed < 0 && EINTR == errno) {
+        continue;
+      }
+      else if (readed < 0) {
+        throw(exception::YASException("Direct device read error: something bad happened during device read",
+            storage::StorageError::kDeviceReadError));
+      }
+      else if (0 == readed) {
+        break;
+      }
+      readed_size += static_cast<OffsetType>(readed);
+    }
+    std::memset(data + readed_size, 0, size - readed_size);
+  }
+
+  void writeWindow(OffsetType position, OffsetType size, const uint8_t *data) {
+    OffsetType written_size = 0;
+    while (written_size < size) {
+      const auto written = ::pwrite(file_descriptor_, data + written_size, size - written_size,
+          static_cast<off_t>(position + written_size));
+      if (written < 0 && EINTR == errno) {
+        continue;
+      }
+      else if (written <= 0) {
+        throw(exception::YASException("Direct device write error: something bad happened during device write",
+            storage::StorageError::kDeviceWriteError));
+      }
+      written_size += static_cast<OffsetType>(written);
+    }
+  }
+};
+
+} // namespace devices
+} // namespace yas
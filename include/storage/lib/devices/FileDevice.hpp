@@ -2,7 +2,11 @@
 #include "../common/filesystem.h"
 #include "../common/common.h"
 #include "../exceptions/YASException.hpp"
+#include "io_segments.h"
+#include "MappedRegion.hpp"
 #include <fstream>
+#include <system_error>
+#include <vector>
 
 namespace yas {
 namespace devices {
@@ -12,6 +16,11 @@ class FileDevice {
  public:
   using path_type = fs::path;
 
+  // the get cursor is shared between all reads
+  static constexpr bool kConcurrentRead = false;
+  // parts of the file could be mapped directly where the OS supports it (see MappedRegion)
+  static constexpr bool kMappable = MappedRegion::kIsSupported;
+
   // path should be optimized by compiler through copy elision
   explicit FileDevice(path_type path)
       : path_(std::move(path)) {
@@ -71,16 +80,62 @@ class FileDevice {
     return write_size;
   }
 
+  void ReadV(const std::vector<ReadSegment<OffsetType>> &segments) {
+    ReadSegments(*this, segments);
+  }
+
+  OffsetType WriteV(const std::vector<WriteSegment<OffsetType>> &segments) {
+    return WriteSegments(*this, segments);
+  }
+
+  ///  \brief makes the file at least size bytes long, the new space is zeroed by the file system
+  void Reserve(OffsetType size) {
+    if (size <= Size()) {
+      return;
+    }
+
+    std::error_code error_code;
+    fs::resize_file(path_, size, error_code);
+    if (error_code) {
+      throw(exception::YASException("Raw device expand error: the file can't be expanded",
+          storage::StorageError::kDeviceExpandError));
+    }
+  }
+
+  ///  \brief makes the file at most size bytes long (f.e. to give the free space at the PV end back)
+  void Truncate(OffsetType size) {
+    if (size >= Size()) {
+      return;
+    }
+
+    std::error_code error_code;
+    fs::resize_file(path_, size, error_code);
+    if (error_code) {
+      throw(exception::YASException("Raw device truncate error: the file can't be truncated",
+          storage::StorageError::kDeviceWriteError));
+    }
+  }
+
   bool IsOpen() const noexcept {
     return device_.is_open() && device_.good();
   }
 
+  // the stream buffering is disabled, so all writes are already in the file
+  OffsetType Size() const {
+    return static_cast<OffsetType>(fs::file_size(path_));
+  }
+
   bool Close() noexcept {
     device_.flush();
     device_.close();
     return !device_.fail();
   }
 
+  ///  \brief returns the cluster size that suits the device best (any size is suitable for this device)
+  static int32_t RecommendedClusterSize(int32_t cluster_size) noexcept {
+    return cluster_size;
+  }
+
   static bool Exists(const path_type &pv_path) {
     return fs::exists(pv_path);
   }
@@ -0,0 +1,215 @@
+#pragma once
+#include "async_io_headers.h"
+#include "../exceptions/YASException.hpp"
+#include <algorithm>
+#include <vector>
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#define YAS_IO_URING_SUPPORTED
+#endif
+
+namespace yas {
+namespace devices {
+
+#ifdef YAS_IO_URING_SUPPORTED
+
+// Thin wrapper over the raw io_uring interface (without liburing to keep the library header-only). Push and Submit
+// should be called from one thread at a time and Complete - only from one (completion) thread. If the kernel
+// doesn't support io_uring (or it is prohibited f.e. by seccomp) IsAvailable returns false.
+class IOUringQueue {
+ public:
+  explicit IOUringQueue(uint32_t entries_count) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof params);
+    ring_descriptor_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries_count, &params));
+    if (ring_descriptor_ < 0) {
+      return;
+    }
+
+    // IORING_OP_READ appeared in 5.6 kernel together with IORING_FEAT_FAST_POLL
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_FAST_POLL)) {
+      release();
+      return;
+    }
+
+    ring_size_ = std::max<size_t>(params.sq_off.array + params.sq_entries * sizeof(uint32_t),
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    ring_ = ::mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_descriptor_,
+        IORING_OFF_SQ_RING);
+    if (MAP_FAILED == ring_) {
+      ring_ = nullptr;
+      release();
+      return;
+    }
+
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqes = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_descriptor_,
+        IORING_OFF_SQES);
+    if (MAP_FAILED == sqes) {
+      release();
+      return;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    auto ring = static_cast<uint8_t*>(ring_);
+    sq_head_ = reinterpret_cast<uint32_t*>(ring + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<uint32_t*>(ring + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<uint32_t*>(ring + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<uint32_t*>(ring + params.sq_off.array);
+    sq_entries_ = params.sq_entries;
+    cq_head_ = reinterpret_cast<uint32_t*>(ring + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<uint32_t*>(ring + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<uint32_t*>(ring + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(ring + params.cq_off.cqes);
+  }
+
+  ~IOUringQueue() {
+    release();
+  }
+
+  bool IsAvailable() const noexcept {
+    return nullptr != sqes_;
+  }
+
+  // returns false if the submission queue is full - Submit should be called first
+  bool Push(int file_descriptor, const AsyncReadDescriptor &descriptor) noexcept {
+    auto sqe = nextSqe();
+    if (nullptr == sqe) {
+      return false;
+    }
+
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = file_descriptor;
+    sqe->addr = reinterpret_cast<uint64_t>(descriptor.data_);
+    sqe->len = descriptor.size_;
+    sqe->off = descriptor.position_;
+    sqe->user_data = descriptor.user_data_;
+    commitSqe();
+    return true;
+  }
+
+  bool PushWakeUp() noexcept {
+    auto sqe = nextSqe();
+    if (nullptr == sqe) {
+      return false;
+    }
+
+    sqe->opcode = IORING_OP_NOP;
+    sqe->user_data = kWakeUpUserData;
+    commitSqe();
+    return true;
+  }
+
+  void Submit() {
+    while (0 != pushed_count_) {
+      const auto submitted = ::syscall(__NR_io_uring_enter, ring_descriptor_, pushed_count_, 0, 0, nullptr, 0);
+      if (submitted < 0 && EINTR == errno) {
+        continue;
+      }
+      else if (submitted < 0) {
+        throw(exception::YASException("io_uring error: requests can't be submitted",
+            storage::StorageError::kDeviceReadError));
+      }
+      pushed_count_ -= static_cast<uint32_t>(submitted);
+    }
+  }
+
+  // extracts all available completions, if wait is true - waits for at least one of them
+  void Complete(std::vector<AsyncReadCompletion> &completions, bool wait) {
+    auto head = *cq_head_;
+    if (wait && head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+      const auto result = ::syscall(__NR_io_uring_enter, ring_descriptor_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+      if (result < 0 && EINTR != errno) {
+        throw(exception::YASException("io_uring error: completions can't be received",
+            storage::StorageError::kDeviceReadError));
+      }
+    }
+
+    const auto tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+      const auto &cqe = cqes_[head & cq_mask_];
+      completions.push_back({ cqe.user_data, cqe.res });
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+  }
+
+  IOUringQueue(const IOUringQueue&) = delete;
+  IOUringQueue(IOUringQueue&&) = delete;
+  IOUringQueue& operator=(const IOUringQueue&) = delete;
+  IOUringQueue& operator=(IOUringQueue&&) = delete;
+
+ private:
+  int ring_descriptor_ = -1;
+  void *ring_ = nullptr;
+  size_t ring_size_ = 0;
+  io_uring_sqe *sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+
+  uint32_t *sq_head_ = nullptr;
+  uint32_t *sq_tail_ = nullptr;
+  uint32_t *sq_array_ = nullptr;
+  uint32_t sq_mask_ = 0;
+  uint32_t sq_entries_ = 0;
+  uint32_t *cq_head_ = nullptr;
+  uint32_t *cq_tail_ = nullptr;
+  uint32_t cq_mask_ = 0;
+  io_uring_cqe *cqes_ = nullptr;
+  uint32_t pushed_count_ = 0;
+
+  io_uring_sqe *nextSqe() noexcept {
+    const auto tail = *sq_tail_;
+    if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_) {
+      return nullptr;
+    }
+
+    auto sqe = &sqes_[tail & sq_mask_];
+    std::memset(sqe, 0, sizeof *sqe);
+    return sqe;
+  }
+
+  void commitSqe() noexcept {
+    const auto tail = *sq_tail_;
+    sq_array_[tail & sq_mask_] = tail & sq_mask_;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    ++pushed_count_;
+  }
+
+  void release() noexcept {
+    if (nullptr != sqes_) {
+      ::munmap(sqes_, sqes_size_);
+      sqes_ = nullptr;
+    }
+    if (nullptr != ring_) {
+      ::munmap(ring_, ring_size_);
+      ring_ = nullptr;
+    }
+    if (ring_descriptor_ >= 0) {
+      ::close(ring_descriptor_);
+      ring_descriptor_ = -1;
+    }
+  }
+};
+
+#else
+
+// io_uring isn't supported on this platform
+class IOUringQueue {
+ public:
+  explicit IOUringQueue(uint32_t) {}
+
+  bool IsAvailable() const noexcept { return false; }
+  bool Push(int, const AsyncReadDescriptor &) noexcept { return false; }
+  bool PushWakeUp() noexcept { return false; }
+  void Submit() {}
+  void Complete(std::vector<AsyncReadCompletion> &, bool) {}
+};
+
+#endif
+
+} // namespace devices
+} // namespace yas
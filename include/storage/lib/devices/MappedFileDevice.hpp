@@ -0,0 +1,228 @@
+#pragma once
+#include "../common/filesystem.h"
+#include "../common/common.h"
+#include "../exceptions/YASException.hpp"
+#include "io_segments.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+namespace yas {
+namespace devices {
+
+// This device maps the whole PV to the address space of the process, so every read and write becomes a plain
+// memory copy instead of a seek and a syscall. The file is grown (and remapped) in kMappingGranularity steps
+// when a write goes beyond the mapped area and truncated back to its logical size on Close.
+// Available only on POSIX systems.
+template <typename OffsetType>
+class MappedFileDevice {
+ public:
+  using path_type = fs::path;
+
+  // reads are just memory copies and the mapping is changed only by writes
+  static constexpr bool kConcurrentRead = true;
+  // other parts of the file could be mapped separately (see MappedRegion)
+  static constexpr bool kMappable = true;
+
+  // path should be optimized by compiler through copy elision
+  explicit MappedFileDevice(path_type path)
+      : path_(std::move(path)) {
+    Open();
+  }
+
+  ~MappedFileDevice() {
+    Close();
+  }
+
+  MappedFileDevice(const MappedFileDevice &other)
+      : path_(other.path_) {
+    Open();
+  }
+
+  template <typename Iterator>
+  void Read(OffsetType position, Iterator begin, Iterator end) {
+    if (!IsOpen()) {
+      throw(exception::YASException("Mapped device read error: the device hasn't been opened during read",
+          storage::StorageError::kDeviceReadError));
+    }
+
+    const auto read_size = static_cast<OffsetType>(std::distance(begin, end));
+    if (position > size_ || read_size > size_ - position) {
+      throw(exception::YASException("Mapped device read error: read after the file end",
+          storage::StorageError::kDeviceReadError));
+    }
+
+    std::copy_n(mapping_ + position, read_size, begin);
+  }
+
+  template <typename Iterator>
+  OffsetType Write(OffsetType position, const Iterator begin, const Iterator end) {
+    if (!IsOpen()) {
+      throw(exception::YASException("Mapped device write error: the device hasn't been opened during write",
+          storage::StorageError::kDeviceWriteError));
+    }
+
+    const auto write_size = static_cast<OffsetType>(std::distance(begin, end));
+    reserve(position + write_size);
+    std::copy(begin, end, mapping_ + position);
+    size_ = std::max(size_, position + write_size);
+
+    return write_size;
+  }
+
+  void ReadV(const std::vector<ReadSegment<OffsetType>> &segments) {
+    ReadSegments(*this, segments);
+  }
+
+  OffsetType WriteV(const std::vector<WriteSegment<OffsetType>> &segments) {
+    return WriteSegments(*this, segments);
+  }
+
+  ///  \brief makes the file at least size bytes long (the new space is mapped without writing it)
+  void Reserve(OffsetType size) {
+    if (!IsOpen()) {
+      throw(exception::YASException("Mapped device expand error: the device hasn't been opened during expand",
+          storage::StorageError::kDeviceExpandError));
+    }
+
+    reserve(size);
+    size_ = std::max(size_, size);
+  }
+
+  ///  \brief makes the file at most size bytes long, the mapping is kept and the file is truncated on Close
+  void Truncate(OffsetType size) {
+    size_ = std::min(size_, size);
+  }
+
+  bool IsOpen() const noexcept {
+    return -1 != file_descriptor_;
+  }
+
+  OffsetType Size() const noexcept {
+    return size_;
+  }
+
+  bool Close() noexcept {
+    if (!IsOpen()) {
+      return true;
+    }
+
+    bool is_success = true;
+    if (nullptr != mapping_) {
+      is_success &= (0 == ::munmap(mapping_, mapped_size_));
+      mapping_ = nullptr;
+    }
+    // drop the preallocated but unused tail of the file
+    is_success &= (0 == ::ftruncate(file_descriptor_, static_cast<off_t>(size_)));
+    is_success &= (0 == ::close(file_descriptor_));
+    file_descriptor_ = -1;
+    return is_success;
+  }
+
+  ///  \brief returns the cluster size that suits the device best (any size is suitable for this device)
+  static int32_t RecommendedClusterSize(int32_t cluster_size) noexcept {
+    return cluster_size;
+  }
+
+  static bool Exists(const path_type &pv_path) {
+    return fs::exists(pv_path);
+  }
+
+  static void CreateEmpty(const path_type &pv_path) {
+    std::ofstream out(pv_path, std::ios_base::out);
+  }
+
+  static path_type Canonical(const path_type &pv_path) {
+    return fs::canonical(pv_path);
+  }
+
+  MappedFileDevice operator=(const MappedFileDevice&) = delete;
+  MappedFileDevice operator=(MappedFileDevice&&) = delete;
+  MappedFileDevice(MappedFileDevice&&) = delete;
+
+ private:
+  // remapping is quite expensive, so the file is expanded at least by this value
+  static constexpr OffsetType kMappingGranularity = 0x100000;
+
+  fs::path path_;
+  int file_descriptor_ = -1;
+  uint8_t *mapping_ = nullptr;
+  OffsetType mapped_size_ = 0;      // the current size of the file on the disk
+  OffsetType size_ = 0;             // the logical size of the file (maximum written position)
+
+  void Open() {
+    file_descriptor_ = ::open(path_.c_str(), O_RDWR);
+    if (!IsOpen()) {
+      return;
+    }
+
+    struct stat file_stat;
+    if (0 != ::fstat(file_descriptor_, &file_stat)) {
+      Close();
+      return;
+    }
+
+    size_ = static_cast<OffsetType>(file_stat.st_size);
+    if (0 == size_) {
+      // zero-length mappings aren't allowed - the first write will create the mapping
+      return;
+    }
+
+    void *mapping = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor_, 0);
+    if (MAP_FAILED == mapping) {
+      Close();
+      return;
+    }
+    mapping_ = static_cast<uint8_t*>(mapping);
+    mapped_size_ = size_;
+  }
+
+  void reserve(OffsetType required_size) {
+    if (required_size <= mapped_size_) {
+      return;
+    }
+
+    // grow by half of the current size to make the amortized remapping cost constant
+    OffsetType new_mapped_size = std::max<OffsetType>(required_size, mapped_size_ + mapped_size_ / 2);
+    new_mapped_size = (new_mapped_size + kMappingGranularity - 1) / kMappingGranularity * kMappingGranularity;
+    // the space is allocated before it is mapped, otherwise the full disk is reported by SIGBUS on the write to the
+    // mapping instead of the error here
+    if (0 != ::posix_fallocate(file_descriptor_, static_cast<off_t>(mapped_size_),
+        static_cast<off_t>(new_mapped_size - mapped_size_))) {
+      throw(exception::YASException("Mapped device write error: the file can't be expanded",
+          storage::StorageError::kDeviceWriteError));
+    }
+
+    void *new_mapping = MAP_FAILED;
+#ifdef __linux__
+    if (nullptr != mapping_) {
+      new_mapping = ::mremap(mapping_, mapped_size_, new_mapped_size, MREMAP_MAYMOVE);
+    }
+    else {
+      new_mapping = ::mmap(nullptr, new_mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor_, 0);
+    }
+#else
+    if (nullptr != mapping_) {
+      ::munmap(mapping_, mapped_size_);
+      mapping_ = nullptr;
+      mapped_size_ = 0;
+    }
+    new_mapping = ::mmap(nullptr, new_mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor_, 0);
+#endif
+    if (MAP_FAILED == new_mapping) {
+      throw(exception::YASException("Mapped device expand error: the file can't be remapped",
+          storage::StorageError::kDeviceExpandError));
+    }
+
+    mapping_ = static_cast<uint8_t*>(new_mapping);
+    mapped_size_ = new_mapped_size;
+  }
+};
+
+} // namespace devices
+} // namespace yas
@@ -0,0 +1,86 @@
+#pragma once
+#include "../common/filesystem.h"
+#include "../exceptions/YASException.hpp"
+#include <cstdint>
+#include <utility>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace yas {
+namespace devices {
+
+// The read-only mapping of the part of the file, pages are read by the OS only on the first access to them. The part
+// shouldn't be written while it is mapped, but other parts of the file could be written and the file could grow.
+// Available only on POSIX systems (kIsSupported).
+class MappedRegion {
+ public:
+#ifndef _WIN32
+  static constexpr bool kIsSupported = true;
+#else
+  static constexpr bool kIsSupported = false;
+#endif
+
+  MappedRegion(const fs::path &path, uint64_t offset, uint64_t size) {
+#ifndef _WIN32
+    const int file_descriptor = ::open(path.c_str(), O_RDONLY);
+    if (-1 == file_descriptor) {
+      throw(exception::YASException("Mapped region error: the file can't be opened",
+          storage::StorageError::kDeviceReadError));
+    }
+
+    // the mapping starts at the page boundary
+    const uint64_t page_size = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+    const uint64_t mapping_offset = offset / page_size * page_size;
+    mapping_size_ = static_cast<size_t>(offset - mapping_offset + size);
+    void *mapping = ::mmap(nullptr, mapping_size_, PROT_READ, MAP_SHARED, file_descriptor,
+        static_cast<off_t>(mapping_offset));
+    // the mapping keeps its own reference to the file
+    ::close(file_descriptor);
+    if (MAP_FAILED == mapping) {
+      throw(exception::YASException("Mapped region error: the file can't be mapped",
+          storage::StorageError::kDeviceReadError));
+    }
+
+    mapping_ = mapping;
+    data_ = static_cast<const uint8_t*>(mapping) + (offset - mapping_offset);
+    size_ = size;
+#else
+    throw(exception::YASException("Mapped region error: mapping isn't supported",
+        storage::StorageError::kDeviceReadError));
+#endif
+  }
+
+  ~MappedRegion() {
+#ifndef _WIN32
+    if (nullptr != mapping_) {
+      ::munmap(mapping_, mapping_size_);
+    }
+#endif
+  }
+
+  MappedRegion(MappedRegion &&other) noexcept
+      : mapping_(std::exchange(other.mapping_, nullptr)),
+        mapping_size_(std::exchange(other.mapping_size_, 0)),
+        data_(std::exchange(other.data_, nullptr)),
+        size_(std::exchange(other.size_, 0))
+  {}
+
+  const uint8_t* data() const noexcept { return data_; }
+  uint64_t size() const noexcept { return size_; }
+
+  MappedRegion(const MappedRegion&) = delete;
+  MappedRegion& operator=(const MappedRegion&) = delete;
+  MappedRegion& operator=(MappedRegion&&) = delete;
+
+ private:
+  void *mapping_ = nullptr;
+  size_t mapping_size_ = 0;
+  const uint8_t *data_ = nullptr;
+  uint64_t size_ = 0;
+};
+
+} // namespace devices
+} // namespace yas
@@ -0,0 +1,289 @@
+#pragma once
+#include "../common/filesystem.h"
+#include "../common/common.h"
+#include "../exceptions/YASException.hpp"
+#include "io_segments.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+namespace yas {
+namespace devices {
+
+// This device works with PV through positional pread/pwrite calls on a raw file descriptor. There isn't any
+// cursor state, so it saves a seek on each access and reads from several threads could go simultaneously.
+// Available only on POSIX systems.
+template <typename OffsetType>
+class PosixFileDevice {
+ public:
+  using path_type = fs::path;
+
+  // reads don't change any device state
+  static constexpr bool kConcurrentRead = true;
+  // parts of the file could be mapped directly (see MappedRegion)
+  static constexpr bool kMappable = true;
+
+  // path should be optimized by compiler through copy elision
+  explicit PosixFileDevice(path_type path)
+      : path_(std::move(path)) {
+    Open();
+  }
+
+  ~PosixFileDevice() {
+    Close();
+  }
+
+  PosixFileDevice(const PosixFileDevice &other)
+      : path_(other.path_) {
+    Open();
+  }
+
+  template <typename Iterator>
+  void Read(OffsetType position, Iterator begin, Iterator end) {
+    if (!IsOpen()) {
+      throw(exception::YASException("Posix device read error: the device hasn't been opened during read",
+          storage::StorageError::kDeviceReadError));
+    }
+
+    auto data = reinterpret_cast<char*>(&(*begin));
+    auto read_size = static_cast<size_t>(std::distance(begin, end));
+    while (read_size > 0) {
+      const auto readed = ::pread(file_descriptor_, data, read_size, static_cast<off_t>(position));
+      if (readed < 0 && EINTR == errno) {
+        continue;
+      }
+      else if (readed < 0) {
+        throw(exception::YASException("Posix device read error: something bad happened during device read",
+            storage::StorageError::kDeviceReadError));
+      }
+      else if (0 == readed) {
+        throw(exception::YASException("Posix device read error: read after the file end",
+            storage::StorageError::kDeviceReadError));
+      }
+
+      data += readed;
+      read_size -= static_cast<size_t>(readed);
+      position += static_cast<OffsetType>(readed);
+    }
+  }
+
+  template <typename Iterator>
+  OffsetType Write(OffsetType position, const Iterator begin, const Iterator end) {
+    if (!IsOpen()) {
+      throw(exception::YASException("Posix device write error: the device hasn't been opened during write",
+          storage::StorageError::kDeviceWriteError));
+    }
+
+    auto data = reinterpret_cast<const char*>(&(*begin));
+    const auto write_size = static_cast<size_t>(std::distance(begin, end));
+    auto remain_size = write_size;
+    while (remain_size > 0) {
+      const auto written = ::pwrite(file_descriptor_, data, remain_size, static_cast<off_t>(position));
+      if (written < 0 && EINTR == errno) {
+        continue;
+      }
+      else if (written <= 0) {
+        throw(exception::YASException("Posix device write error: something bad happened during device write",
+            storage::StorageError::kDeviceWriteError));
+      }
+
+      data += written;
+      remain_size -= static_cast<size_t>(written);
+      position += static_cast<OffsetType>(written);
+    }
+
+    return static_cast<OffsetType>(write_size);
+  }
+
+  ///  \brief reads all segments, adjacent segments are merged into one preadv call
+  void ReadV(const std::vector<ReadSegment<OffsetType>> &segments) {
+    if (!IsOpen()) {
+      throw(exception::YASException("Posix device read error: the device hasn't been opened during read",
+          storage::StorageError::kDeviceReadError));
+    }
+
+    transferSegments<true>(segments);
+  }
+
+  ///  \brief writes all segments, adjacent segments are merged into one pwritev call
+  OffsetType WriteV(const std::vector<WriteSegment<OffsetType>> &segments) {
+    if (!IsOpen()) {
+      throw(exception::YASException("Posix device write error: the device hasn't been opened during write",
+          storage::StorageError::kDeviceWriteError));
+    }
+
+    return transferSegments<false>(segments);
+  }
+
+  ///  \brief makes the file at least size bytes long, the new space is reserved by fallocate without writing it
+  ///         (or the file is just truncated if the file system doesn't support it)
+  void Reserve(OffsetType size) {
+    const auto file_size = Size();
+    if (size <= file_size) {
+      return;
+    }
+
+#ifdef __linux__
+    if (0 == ::fallocate(file_descriptor_, 0, static_cast<off_t>(file_size), static_cast<off_t>(size - file_size))) {
+      return;
+    }
+#endif
+    if (0 != ::ftruncate(file_descriptor_, static_cast<off_t>(size))) {
+      throw(exception::YASException("Posix device expand error: the file can't be expanded",
+          storage::StorageError::kDeviceExpandError));
+    }
+  }
+
+  ///  \brief makes the file at most size bytes long (f.e. to give the free space at the PV end back)
+  void Truncate(OffsetType size) {
+    if (size >= Size()) {
+      return;
+    }
+
+    if (0 != ::ftruncate(file_descriptor_, static_cast<off_t>(size))) {
+      throw(exception::YASException("Posix device truncate error: the file can't be truncated",
+          storage::StorageError::kDeviceWriteError));
+    }
+  }
+
+  bool IsOpen() const noexcept {
+    return -1 != file_descriptor_;
+  }
+
+  OffsetType Size() const {
+    struct stat file_stat;
+    if (0 != ::fstat(file_descriptor_, &file_stat)) {
+      throw(exception::YASException("Posix device error: the file size can't be obtained",
+          storage::StorageError::kDeviceGeneralError));
+    }
+    return static_cast<OffsetType>(file_stat.st_size);
+  }
+
+  // the raw descriptor for devices built on top of this one (f.e. to submit asynchronous reads)
+  int Descriptor() const noexcept {
+    return file_descriptor_;
+  }
+
+  bool Close() noexcept {
+    if (!IsOpen()) {
+      return true;
+    }
+
+    const bool is_success = (0 == ::close(file_descriptor_));
+    file_descriptor_ = -1;
+    return is_success;
+  }
+
+  ///  \brief returns the cluster size that suits the device best (any size is suitable for this device)
+  static int32_t RecommendedClusterSize(int32_t cluster_size) noexcept {
+    return cluster_size;
+  }
+
+  static bool Exists(const path_type &pv_path) {
+    return fs::exists(pv_path);
+  }
+
+  static void CreateEmpty(const path_type &pv_path) {
+    std::ofstream out(pv_path, std::ios_base::out);
+  }
+
+  static path_type Canonical(const path_type &pv_path) {
+    return fs::canonical(pv_path);
+  }
+
+  PosixFileDevice operator=(const PosixFileDevice&) = delete;
+  PosixFileDevice operator=(PosixFileDevice&&) = delete;
+  PosixFileDevice(PosixFileDevice&&) = delete;
+
+ private:
+  // IOV_MAX on Linux and macOS
+  static constexpr size_t kMaxIOVecsCount = 1024;
+
+  fs::path path_;
+  int file_descriptor_ = -1;
+
+  void Open() {
+    file_descriptor_ = ::open(path_.c_str(), O_RDWR);
+  }
+
+  // segments are processed by runs of adjacent segments, each run is one preadv/pwritev call (if it isn't
+  // interrupted or partially completed)
+  template <bool kIsRead, typename Segments>
+  OffsetType transferSegments(const Segments &segments) {
+    std::vector<iovec> iovecs;
+    iovecs.reserve(std::min(segments.size(), kMaxIOVecsCount));
+
+    OffsetType transferred_size = 0;
+    for (size_t segment_id = 0; segment_id < segments.size();) {
+      const auto run_position = segments[segment_id].position_;
+      auto run_end = run_position;
+      iovecs.clear();
+      for (; segment_id < segments.size() && iovecs.size() < kMaxIOVecsCount &&
+          segments[segment_id].position_ == run_end; ++segment_id) {
+        const auto &segment = segments[segment_id];
+        iovecs.push_back({ const_cast<uint8_t*>(segment.data_), segment.size_ });
+        run_end += static_cast<OffsetType>(segment.size_);
+      }
+
+      transferRun<kIsRead>(run_position, iovecs);
+      transferred_size += run_end - run_position;
+    }
+
+    return transferred_size;
+  }
+
+  template <bool kIsRead>
+  void transferRun(OffsetType position, std::vector<iovec> &iovecs) {
+    auto iovec_begin = iovecs.data();
+    const auto iovec_end = iovecs.data() + iovecs.size();
+    while (iovec_begin != iovec_end) {
+      ssize_t transferred = 0;
+      if constexpr (kIsRead) {
+        transferred = ::preadv(file_descriptor_, iovec_begin, static_cast<int>(iovec_end - iovec_begin),
+            static_cast<off_t>(position));
+      }
+      else {
+        transferred = ::pwritev(file_descriptor_, iovec_begin, static_cast<int>(iovec_end - iovec_begin),
+            static_cast<off_t>(position));
+      }
+
+      if (transferred < 0 && EINTR == errno) {
+        continue;
+      }
+      else if (kIsRead && transferred < 0) {
+        throw(exception::YASException("Posix device read error: something bad happened during device read",
+            storage::StorageError::kDeviceReadError));
+      }
+      else if (kIsRead && 0 == transferred && 0 != iovec_begin->iov_len) {
+        throw(exception::YASException("Posix device read error: read after the file end",
+            storage::StorageError::kDeviceReadError));
+      }
+      else if (!kIsRead && (transferred < 0 || (0 == transferred && 0 != iovec_begin->iov_len))) {
+        throw(exception::YASException("Posix device write error: something bad happened during device write",
+            storage::StorageError::kDeviceWriteError));
+      }
+
+      // skip completed buffers and move the beginning of the partially completed one
+      position += static_cast<OffsetType>(transferred);
+      auto remain_size = static_cast<size_t>(transferred);
+      while (iovec_begin != iovec_end && remain_size >= iovec_begin->iov_len) {
+        remain_size -= iovec_begin->iov_len;
+        ++iovec_begin;
+      }
+      if (remain_size > 0) {
+        iovec_begin->iov_base = static_cast<uint8_t*>(iovec_begin->iov_base) + remain_size;
+        iovec_begin->iov_len -= remain_size;
+      }
+    }
+  }
+};
+
+} // namespace devices
+} // namespace yas
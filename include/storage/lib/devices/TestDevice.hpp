@@ -2,9 +2,11 @@
 #include "../common/filesystem.h"
 #include "../common/common.h"
 #include "../exceptions/YASException.hpp"
+#include "io_segments.h"
 #include <algorithm>
 #include <cstdint>
 #include <fstream>
+#include <vector>
 
 namespace yas {
 namespace devices {
@@ -13,7 +15,12 @@ namespace devices {
 template <typename OffsetType>
 class TestDevice {
  public:
-  explicit TestDevice(fs::path path)
+  using path_type = fs::path;
+
+  static constexpr bool kConcurrentRead = false;
+  static constexpr bool kMappable = false;
+
+  explicit TestDevice(fs::path)
   {}
 
   ~TestDevice() = default;
@@ -75,10 +82,34 @@ class TestDevice {
     return data_size;
   }
 
+  void ReadV(const std::vector<ReadSegment<OffsetType>> &segments) {
+    ReadSegments(*this, segments);
+  }
+
+  OffsetType WriteV(const std::vector<WriteSegment<OffsetType>> &segments) {
+    return WriteSegments(*this, segments);
+  }
+
+  void Reserve(OffsetType size) {
+    if (size > storage_.size()) {
+      storage_.resize(size);
+    }
+  }
+
+  void Truncate(OffsetType size) {
+    if (size < storage_.size()) {
+      storage_.resize(size);
+    }
+  }
+
   bool IsOpen() const noexcept {
     return true;
   }
 
+  OffsetType Size() const noexcept {
+    return storage_.size();
+  }
+
   bool Close() noexcept {
     return true;
   }
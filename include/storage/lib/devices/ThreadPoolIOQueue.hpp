@@ -0,0 +1,129 @@
+#pragma once
+#include "async_io_headers.h"
+#include <unistd.h>
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace yas {
+namespace devices {
+
+// The fallback for IOUringQueue with the same interface: requests are processed by blocking preads from the pool
+// of worker threads and their results are collected to the completion queue.
+class ThreadPoolIOQueue {
+ public:
+  explicit ThreadPoolIOQueue(uint32_t threads_count) {
+    for (uint32_t thread_id = 0; thread_id < threads_count; ++thread_id) {
+      workers_.emplace_back([this]() { processRequests(); });
+    }
+  }
+
+  ~ThreadPoolIOQueue() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_stopped_ = true;
+    }
+    requests_condition_.notify_all();
+    for (auto &worker : workers_) {
+      worker.join();
+    }
+  }
+
+  bool IsAvailable() const noexcept {
+    return !workers_.empty();
+  }
+
+  bool Push(int file_descriptor, const AsyncReadDescriptor &descriptor) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    requests_.push_back({ file_descriptor, descriptor });
+    return true;
+  }
+
+  bool PushWakeUp() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    completions_.push_back({ kWakeUpUserData, 0 });
+    completions_condition_.notify_one();
+    return true;
+  }
+
+  void Submit() {
+    requests_condition_.notify_all();
+  }
+
+  // extracts all available completions, if wait is true - waits for at least one of them
+  void Complete(std::vector<AsyncReadCompletion> &completions, bool wait) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (wait) {
+      completions_condition_.wait(lock, [this]() { return !completions_.empty(); });
+    }
+
+    completions.insert(std::end(completions), std::cbegin(completions_), std::cend(completions_));
+    completions_.clear();
+  }
+
+  ThreadPoolIOQueue(const ThreadPoolIOQueue&) = delete;
+  ThreadPoolIOQueue(ThreadPoolIOQueue&&) = delete;
+  ThreadPoolIOQueue& operator=(const ThreadPoolIOQueue&) = delete;
+  ThreadPoolIOQueue& operator=(ThreadPoolIOQueue&&) = delete;
+
+ private:
+  struct Request {
+    int file_descriptor_;
+    AsyncReadDescriptor descriptor_;
+  };
+
+  std::vector<std::thread> workers_;
+  std::deque<Request> requests_;
+  std::deque<AsyncReadCompletion> completions_;
+  std::mutex mutex_;
+  std::condition_variable requests_condition_;
+  std::condition_variable completions_condition_;
+  bool is_stopped_ = false;
+
+  void processRequests() {
+    while (true) {
+      Request request;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        requests_condition_.wait(lock, [this]() { return is_stopped_ || !requests_.empty(); });
+        if (requests_.empty()) {
+          return;
+        }
+        request = requests_.front();
+        requests_.pop_front();
+      }
+
+      const auto result = read(request);
+      std::lock_guard<std::mutex> lock(mutex_);
+      completions_.push_back({ request.descriptor_.user_data_, result });
+      completions_condition_.notify_one();
+    }
+  }
+
+  static int64_t read(const Request &request) noexcept {
+    const auto &descriptor = request.descriptor_;
+    uint32_t readed_size = 0;
+    while (readed_size < descriptor.size_) {
+      const auto readed = ::pread(request.file_descriptor_, descriptor.data_ + readed_size,
+          descriptor.size_ - readed_size, static_cast<off_t>(descriptor.position_ + readed_size));
+      if (readed < 0 && EINTR == errno) {
+        continue;
+      }
+      else if (readed < 0) {
+        return -errno;
+      }
+      else if (0 == readed) {
+        break;
+      }
+      readed_size += static_cast<uint32_t>(readed);
+    }
+
+    return readed_size;
+  }
+};
+
+} // namespace devices
+} // namespace yas
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+
+namespace yas {
+namespace devices {
+
+// one read request that is passed to an asynchronous IO queue
+struct AsyncReadDescriptor {
+  uint64_t position_;
+  uint8_t *data_;
+  uint32_t size_;
+  uint64_t user_data_;
+};
+
+// the result of a request: count of readed bytes or negative errno value
+struct AsyncReadCompletion {
+  uint64_t user_data_;
+  int64_t result_;
+};
+
+// completion with this user data is used only to wake up the completion thread
+constexpr uint64_t kWakeUpUserData = 0;
+
+} // namespace devices
+} // namespace yas
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace yas {
+namespace devices {
+
+// the part of the vectored read: size_ bytes from the device position are placed to data_
+template <typename OffsetType>
+struct ReadSegment {
+  OffsetType position_;
+  uint8_t *data_;
+  size_t size_;
+};
+
+// the part of the vectored write: size_ bytes from data_ are placed to the device position
+template <typename OffsetType>
+struct WriteSegment {
+  OffsetType position_;
+  const uint8_t *data_;
+  size_t size_;
+};
+
+// ReadV/WriteV of devices without native vectored IO: segments are read (written) one by one by the plain
+// Read/Write of the device, so they behave the same as the sequence of these calls
+template <typename Device, typename Segments>
+void ReadSegments(Device &device, const Segments &segments) {
+  for (const auto &segment : segments) {
+    device.Read(segment.position_, segment.data_, segment.data_ + segment.size_);
+  }
+}
+
+template <typename Device, typename Segments>
+auto WriteSegments(Device &device, const Segments &segments) {
+  decltype(device.Write(segments.front().position_, segments.front().data_, segments.front().data_)) written = 0;
+  for (const auto &segment : segments) {
+    written += device.Write(segment.position_, segment.data_, segment.data_ + segment.size_);
+  }
+  return written;
+}
+
+} // namespace devices
+} // namespace yas
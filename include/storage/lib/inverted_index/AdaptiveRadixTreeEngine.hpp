@@ -0,0 +1,501 @@
+#pragma once
+#include "leaf_type_traits.hpp"
+#include "../common/bit_utils.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace yas {
+namespace index_helper {
+
+// adaptive radix tree: inner nodes grow from 4 to 16, 48 and 256 children and the chain of nodes with one child is
+// compressed into the prefix of the next node, so long hierarchical keys take a few nodes instead of a node per char.
+// It has the same interface as AhoCorasickEngine and could replace it in InvertedIndexHelper. Routes are chosen by
+// bytes, so only byte chars are supported
+template <typename CharType, typename LeafType>
+class AdaptiveRadixTreeEngine {
+ public:
+  static_assert(std::is_trivially_copyable_v<LeafType>, "LeafType should be POD");
+  static_assert(1 == sizeof(CharType), "AdaptiveRadixTreeEngine supports only byte chars");
+
+  using char_type = CharType;
+  using leaf_type = LeafType;
+  using key_type = std::basic_string_view<CharType>;
+
+  AdaptiveRadixTreeEngine()
+      : root_(createNode(NodeKind::kNode4, {}))
+  {}
+
+  ~AdaptiveRadixTreeEngine() noexcept {
+    destroyTree();
+  }
+
+  AdaptiveRadixTreeEngine(AdaptiveRadixTreeEngine &&other) noexcept
+      : root_(std::exchange(other.root_, nullptr)),
+        memory_usage_(std::exchange(other.memory_usage_, 0))
+  {}
+
+  AdaptiveRadixTreeEngine& operator=(AdaptiveRadixTreeEngine &&other) noexcept {
+    if (this != &other) {
+      destroyTree();
+      root_ = std::exchange(other.root_, nullptr);
+      memory_usage_ = std::exchange(other.memory_usage_, 0);
+    }
+    return *this;
+  }
+
+  bool Insert(key_type key, LeafType &leaf) {
+    Node **slot = &root_;
+    size_t depth = 0;
+
+    while (true) {
+      const auto node = *slot;
+      const auto prefix = getPrefix(node);
+      const auto matched = matchPrefix(prefix, key.substr(depth));
+      if (matched < prefix.size()) {
+        // the key leaves the compressed path, so the path is split by the new node
+        splitPrefix(*slot, matched, key.substr(depth), leaf);
+        return true;
+      }
+
+      depth += matched;
+      if (key.size() == depth) {
+        node->leaf_ = leaf;
+        return true;
+      }
+
+      const auto route = static_cast<uint8_t>(key[depth]);
+      const auto child_slot = findChild(node, route);
+      if (nullptr == child_slot) {
+        reserveChild(*slot);
+        const auto child = createNode(NodeKind::kLeaf, key.substr(depth + 1));
+        child->leaf_ = leaf;
+        addChild(*slot, route, child);
+        return true;
+      }
+
+      slot = child_slot;
+      ++depth;
+    }
+  }
+
+  LeafType Get(key_type key) noexcept {
+    const auto node = followKey(key).first;
+    return (nullptr == node) ? leaf_type_traits<LeafType>::NonExistValue() : node->leaf_;
+  }
+
+  const LeafType Get(key_type key) const noexcept {
+    const auto node = followKey(key).first;
+    return (nullptr == node) ? leaf_type_traits<LeafType>::NonExistValue() : node->leaf_;
+  }
+
+  // like AhoCorasickEngine it only clears the leaf, the path stays in the tree
+  bool Delete(key_type key) noexcept {
+    const auto [node, matched] = followKey(key);
+    if (matched < key.size()) {
+      return false;
+    }
+
+    if (nullptr != node) {
+      node->leaf_ = leaf_type_traits<LeafType>::NonExistValue();
+    }
+    return true;
+  }
+
+  bool HasKey(key_type key) const noexcept {
+    const auto node = followKey(key).first;
+    return (nullptr == node) ? false : leaf_type_traits<LeafType>::IsExistValue(node->leaf_);
+  }
+
+  int64_t FindMaxSubKey(key_type key) const noexcept {
+    return static_cast<int64_t>(followKey(key).second);
+  }
+
+  // calls visitor for each existing leaf, the order of leaves isn't specified
+  template <typename Visitor>
+  void VisitLeaves(Visitor &&visitor) const {
+    visitNodes([&visitor](const Node *node) {
+      if (leaf_type_traits<LeafType>::IsExistValue(node->leaf_)) {
+        visitor(node->leaf_);
+      }
+    });
+  }
+
+  // the same, but visitor receives leaves by reference and could change them
+  template <typename Visitor>
+  void VisitLeaves(Visitor &&visitor) {
+    visitNodes([&visitor](Node *node) {
+      if (leaf_type_traits<LeafType>::IsExistValue(node->leaf_)) {
+        visitor(node->leaf_);
+      }
+    });
+  }
+
+  // bytes allocated for nodes and their prefixes
+  size_t MemoryUsage() const noexcept { return memory_usage_; }
+
+  AdaptiveRadixTreeEngine(const AdaptiveRadixTreeEngine&) = delete;
+  AdaptiveRadixTreeEngine& operator=(const AdaptiveRadixTreeEngine&) = delete;
+
+ private:
+  template <typename T1, typename T2, typename T3, typename T4> friend class AhoCorasickSerializationHelper;
+  template <typename T1, typename T2> friend class FlatTrieIndex;
+
+  enum class NodeKind : uint8_t { kLeaf, kNode4, kNode16, kNode48, kNode256 };
+
+  // the prefix is placed right after the node of its kind in the same allocation, nodes without children (the most
+  // of them) have no room for routes
+  struct Node {
+    LeafType leaf_;
+    uint32_t prefix_size_;
+    uint32_t prefix_capacity_;
+    uint16_t children_count_;
+    NodeKind kind_;
+  };
+
+  struct Node4 : Node {
+    uint8_t routes_[4];
+    Node *children_[4];
+  };
+
+  // routes are compared all at once by bit_utils::FindByte16
+  struct Node16 : Node {
+    uint8_t routes_[16];
+    Node *children_[16];
+  };
+
+  // child_ids_ keeps the index of the child plus one, zero means there is no route
+  struct Node48 : Node {
+    uint8_t child_ids_[256];
+    Node *children_[48];
+  };
+
+  struct Node256 : Node {
+    Node *children_[256];
+  };
+
+  // the char trie equal to the tree for the serialization: the node of the char trie is the tree node and the count
+  // of passed chars of its prefix
+  struct NodeRef {
+    const Node *node_;
+    uint32_t prefix_position_;
+  };
+
+  Node *root_;
+  size_t memory_usage_ = 0;
+
+  static constexpr size_t getNodeSize(NodeKind kind) noexcept {
+    switch (kind) {
+      case NodeKind::kNode4:
+        return sizeof(Node4);
+      case NodeKind::kNode16:
+        return sizeof(Node16);
+      case NodeKind::kNode48:
+        return sizeof(Node48);
+      case NodeKind::kNode256:
+        return sizeof(Node256);
+      default:
+        return sizeof(Node);
+    }
+  }
+
+  static constexpr uint16_t getNodeCapacity(NodeKind kind) noexcept {
+    switch (kind) {
+      case NodeKind::kNode4:
+        return 4;
+      case NodeKind::kNode16:
+        return 16;
+      case NodeKind::kNode48:
+        return 48;
+      case NodeKind::kNode256:
+        return 256;
+      default:
+        return 0;
+    }
+  }
+
+  static CharType *getPrefixData(Node *node) noexcept {
+    return reinterpret_cast<CharType*>(reinterpret_cast<uint8_t*>(node) + getNodeSize(node->kind_));
+  }
+
+  static key_type getPrefix(const Node *node) noexcept {
+    return { getPrefixData(const_cast<Node*>(node)), node->prefix_size_ };
+  }
+
+  static size_t matchPrefix(key_type prefix, key_type key) noexcept {
+    const auto compared_size = std::min(prefix.size(), key.size());
+    return std::mismatch(std::cbegin(prefix), std::cbegin(prefix) + compared_size, std::cbegin(key)).first -
+        std::cbegin(prefix);
+  }
+
+  Node *createNode(NodeKind kind, key_type prefix) {
+    const auto node_size = getNodeSize(kind) + prefix.size();
+    const auto memory = ::operator new(node_size);
+    // value initialization zeroes routes and children
+    Node *node = nullptr;
+    switch (kind) {
+      case NodeKind::kNode4:
+        node = new (memory) Node4();
+        break;
+      case NodeKind::kNode16:
+        node = new (memory) Node16();
+        break;
+      case NodeKind::kNode48:
+        node = new (memory) Node48();
+        break;
+      case NodeKind::kNode256:
+        node = new (memory) Node256();
+        break;
+      default:
+        node = new (memory) Node();
+        break;
+    }
+
+    node->leaf_ = leaf_type_traits<LeafType>::NonExistValue();
+    node->prefix_size_ = static_cast<uint32_t>(prefix.size());
+    node->prefix_capacity_ = static_cast<uint32_t>(prefix.size());
+    node->kind_ = kind;
+    std::copy(std::cbegin(prefix), std::cend(prefix), getPrefixData(node));
+    memory_usage_ += node_size;
+    return node;
+  }
+
+  // all kinds of nodes are trivially destructible
+  void freeNode(Node *node) noexcept {
+    memory_usage_ -= getNodeSize(node->kind_) + node->prefix_capacity_;
+    ::operator delete(node);
+  }
+
+  void destroyTree() noexcept {
+    if (nullptr == root_) {
+      return;
+    }
+
+    std::vector<Node*> nodes{ root_ };
+    while (!nodes.empty()) {
+      const auto node = nodes.back();
+      nodes.pop_back();
+      visitChildren(node, [&nodes](uint8_t, Node *child) { nodes.push_back(child); });
+      freeNode(node);
+    }
+    root_ = nullptr;
+  }
+
+  static Node **findChild(Node *node, uint8_t route) noexcept {
+    switch (node->kind_) {
+      case NodeKind::kNode4: {
+        const auto node4 = static_cast<Node4*>(node);
+        for (uint16_t child_id = 0; child_id < node->children_count_; ++child_id) {
+          if (node4->routes_[child_id] == route) {
+            return &node4->children_[child_id];
+          }
+        }
+        return nullptr;
+      }
+      case NodeKind::kNode16: {
+        const auto node16 = static_cast<Node16*>(node);
+        const auto child_id = bit_utils::FindByte16(node16->routes_, node->children_count_, route);
+        return (child_id < node->children_count_) ? &node16->children_[child_id] : nullptr;
+      }
+      case NodeKind::kNode48: {
+        const auto node48 = static_cast<Node48*>(node);
+        const auto child_id = node48->child_ids_[route];
+        return child_id ? &node48->children_[child_id - 1] : nullptr;
+      }
+      case NodeKind::kNode256: {
+        const auto node256 = static_cast<Node256*>(node);
+        return (nullptr != node256->children_[route]) ? &node256->children_[route] : nullptr;
+      }
+      default:
+        return nullptr;
+    }
+  }
+
+  // calls visitor with the route byte and the child for each child of the node
+  template <typename NodeType, typename Visitor>
+  static void visitChildren(NodeType *node, Visitor &&visitor) {
+    switch (node->kind_) {
+      case NodeKind::kNode4:
+      case NodeKind::kNode16: {
+        const auto routes = (NodeKind::kNode4 == node->kind_) ? static_cast<const Node4*>(node)->routes_ :
+            static_cast<const Node16*>(node)->routes_;
+        const auto children = (NodeKind::kNode4 == node->kind_) ? static_cast<const Node4*>(node)->children_ :
+            static_cast<const Node16*>(node)->children_;
+        for (uint16_t child_id = 0; child_id < node->children_count_; ++child_id) {
+          visitor(routes[child_id], children[child_id]);
+        }
+        break;
+      }
+      case NodeKind::kNode48: {
+        const auto node48 = static_cast<const Node48*>(node);
+        for (uint32_t route = 0; route < 256; ++route) {
+          if (node48->child_ids_[route]) {
+            visitor(static_cast<uint8_t>(route), node48->children_[node48->child_ids_[route] - 1]);
+          }
+        }
+        break;
+      }
+      case NodeKind::kNode256: {
+        const auto node256 = static_cast<const Node256*>(node);
+        for (uint32_t route = 0; route < 256; ++route) {
+          if (nullptr != node256->children_[route]) {
+            visitor(static_cast<uint8_t>(route), node256->children_[route]);
+          }
+        }
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  template <typename Visitor>
+  void visitNodes(Visitor &&visitor) const {
+    if (nullptr == root_) {
+      return;
+    }
+
+    std::vector<Node*> nodes{ root_ };
+    while (!nodes.empty()) {
+      const auto node = nodes.back();
+      nodes.pop_back();
+      visitor(node);
+      visitChildren(node, [&nodes](uint8_t, Node *child) { nodes.push_back(child); });
+    }
+  }
+
+  // replaces the full node by the node of the next kind, so one more child could be added without allocations
+  void reserveChild(Node *&slot) {
+    const auto node = slot;
+    if (node->children_count_ < getNodeCapacity(node->kind_)) {
+      return;
+    }
+
+    const auto next_kind = static_cast<NodeKind>(static_cast<uint8_t>(node->kind_) + 1);
+    const auto grown_node = createNode(next_kind, getPrefix(node));
+    grown_node->leaf_ = node->leaf_;
+    visitChildren(node, [&grown_node](uint8_t route, Node *child) { addChild(grown_node, route, child); });
+    slot = grown_node;
+    freeNode(node);
+  }
+
+  // the caller reserves the place for the child
+  static void addChild(Node *node, uint8_t route, Node *child) noexcept {
+    switch (node->kind_) {
+      case NodeKind::kNode4: {
+        const auto node4 = static_cast<Node4*>(node);
+        node4->routes_[node->children_count_] = route;
+        node4->children_[node->children_count_] = child;
+        break;
+      }
+      case NodeKind::kNode16: {
+        const auto node16 = static_cast<Node16*>(node);
+        node16->routes_[node->children_count_] = route;
+        node16->children_[node->children_count_] = child;
+        break;
+      }
+      case NodeKind::kNode48: {
+        // children are never removed, so the next free place is after the last child
+        const auto node48 = static_cast<Node48*>(node);
+        node48->children_[node->children_count_] = child;
+        node48->child_ids_[route] = static_cast<uint8_t>(node->children_count_ + 1);
+        break;
+      }
+      case NodeKind::kNode256:
+        static_cast<Node256*>(node)->children_[route] = child;
+        break;
+      default:
+        return;
+    }
+    ++node->children_count_;
+  }
+
+  // the prefix of the node matches only matched chars of the key, the new node gets them and the node keeps the rest
+  // of its prefix after the route char
+  void splitPrefix(Node *&slot, size_t matched, key_type key, LeafType &leaf) {
+    const auto node = slot;
+    const auto prefix = getPrefix(node);
+    const auto parent = createNode(NodeKind::kNode4, prefix.substr(0, matched));
+    Node *leaf_node = nullptr;
+    if (matched < key.size()) {
+      try {
+        leaf_node = createNode(NodeKind::kLeaf, key.substr(matched + 1));
+      }
+      catch (...) {
+        freeNode(parent);
+        throw;
+      }
+      leaf_node->leaf_ = leaf;
+    }
+    else {
+      parent->leaf_ = leaf;
+    }
+
+    const auto node_route = static_cast<uint8_t>(prefix[matched]);
+    const auto prefix_data = getPrefixData(node);
+    std::memmove(prefix_data, prefix_data + matched + 1, (prefix.size() - matched - 1) * sizeof(CharType));
+    node->prefix_size_ -= static_cast<uint32_t>(matched + 1);
+
+    addChild(parent, node_route, node);
+    if (nullptr != leaf_node) {
+      addChild(parent, static_cast<uint8_t>(key[matched]), leaf_node);
+    }
+    slot = parent;
+  }
+
+  // returns the node where the key ends (nullptr if the key ends inside the prefix or isn't in the tree) and the
+  // count of the key chars that are in the tree
+  std::pair<Node*, size_t> followKey(key_type key) const noexcept {
+    Node *node = root_;
+    size_t depth = 0;
+
+    while (nullptr != node) {
+      const auto prefix = getPrefix(node);
+      const auto matched = matchPrefix(prefix, key.substr(depth));
+      depth += matched;
+      if (matched < prefix.size()) {
+        break;
+      }
+      if (key.size() == depth) {
+        return { node, depth };
+      }
+
+      const auto child_slot = findChild(node, static_cast<uint8_t>(key[depth]));
+      if (nullptr == child_slot) {
+        break;
+      }
+      node = *child_slot;
+      ++depth;
+    }
+    return { nullptr, depth };
+  }
+
+  bool hasRoot() const noexcept { return nullptr != root_; }
+
+  NodeRef getRootNode() const noexcept { return { root_, 0 }; }
+
+  LeafType getNodeLeaf(NodeRef node) const noexcept {
+    return (node.node_->prefix_size_ == node.prefix_position_) ? node.node_->leaf_ :
+        leaf_type_traits<LeafType>::NonExistValue();
+  }
+
+  template <typename Visitor>
+  void visitRoutes(NodeRef node, Visitor &&visitor) const {
+    if (node.prefix_position_ < node.node_->prefix_size_) {
+      visitor(getPrefix(node.node_)[node.prefix_position_], NodeRef{ node.node_, node.prefix_position_ + 1 });
+      return;
+    }
+
+    visitChildren(node.node_, [&visitor](uint8_t route, const Node *child) {
+      visitor(static_cast<CharType>(route), NodeRef{ child, 0 });
+    });
+  }
+};
+
+} // namespace index_helper
+} // namespace yas
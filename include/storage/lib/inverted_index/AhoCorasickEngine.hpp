@@ -1,12 +1,22 @@
 #pragma once
 #include "leaf_type_traits.hpp"
+#include "../common/bit_utils.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
 #include <string_view>
-#include <unordered_map>
-#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace yas {
 namespace index_helper {
 
+// nodes of the trie are placed next to each other in one arena and refer to their children by indexes, so the
+// traversal doesn't chase pointers of separately allocated nodes. Nodes keep a few routes inline (sorted by char),
+// the nodes with more routes move them to the small sorted array of kSmallRoutesCount routes and then to the table
+// (256-way for byte chars)
 template <typename CharType, typename LeafType>
 class AhoCorasickEngine {
  public:
@@ -17,7 +27,7 @@ class AhoCorasickEngine {
   using key_type = std::basic_string_view<CharType>;
 
   AhoCorasickEngine()
-      : trie_(new Node())
+      : nodes_(1)
   {}
 
   ~AhoCorasickEngine() noexcept = default;
@@ -25,56 +35,54 @@ class AhoCorasickEngine {
   AhoCorasickEngine& operator=(AhoCorasickEngine&&) noexcept = default;
 
   bool Insert(key_type key, LeafType &leaf) {
-    auto current = trie_.get();
+    auto current = kRootIndex;
 
     for (auto &&ch : key) {
       auto next = getNextNode(ch, current);
-      if (nullptr == next) {
-        current->routes_[ch].reset(new Node());
-        current = current->routes_[ch].get();
-        continue;
+      if (kNoNode == next) {
+        next = addRoute(ch, current);
       }
       current = next;
     }
-    current->leaf_= leaf;
+    nodes_[current].leaf_ = leaf;
     return true;
   }
 
   LeafType Get(key_type key) noexcept {
     const auto node = getPathNode(key);
-    return (nullptr == node) ? leaf_type_traits<LeafType>::NonExistValue() : node->leaf_;
+    return (kNoNode == node) ? leaf_type_traits<LeafType>::NonExistValue() : nodes_[node].leaf_;
   }
 
   const LeafType Get(key_type key) const noexcept {
     const auto node = getPathNode(key);
-    return (nullptr == node) ? leaf_type_traits<LeafType>::NonExistValue() : node->leaf_;
+    return (kNoNode == node) ? leaf_type_traits<LeafType>::NonExistValue() : nodes_[node].leaf_;
   }
 
   bool Delete(key_type key) noexcept {
     // TODO : delete node path
     const auto node = getPathNode(key);
-    if (nullptr == node) {
+    if (kNoNode == node) {
       return false;
     }
 
-    node->leaf_ = leaf_type_traits<LeafType>::NonExistValue();
+    nodes_[node].leaf_ = leaf_type_traits<LeafType>::NonExistValue();
     return true;
   }
 
   bool HasKey(key_type key) const noexcept {
     const auto node = getPathNode(key);
-    return (nullptr == node) ? false : leaf_type_traits<LeafType>::NonExistValue() != node->leaf_;
+    return (kNoNode == node) ? false : leaf_type_traits<LeafType>::NonExistValue() != nodes_[node].leaf_;
   }
 
   int64_t FindMaxSubKey(key_type key) const noexcept {
     // to make class more generic on future this method could be replaced with a method
     // that could apply visitors to nodes
-    auto current = trie_.get();
+    auto current = getRootNode();
     int64_t max_path = 0;
 
     for (const auto &ch : key) {
       current = getNextNode(ch, current);
-      if (nullptr == current) {
+      if (kNoNode == current) {
         return max_path;
       }
       ++max_path;
@@ -82,39 +90,258 @@ class AhoCorasickEngine {
     return max_path;
   }
 
+  // calls visitor for each existing leaf, the order of leaves isn't specified
+  template <typename Visitor>
+  void VisitLeaves(Visitor &&visitor) const {
+    for (const auto &node : nodes_) {
+      if (leaf_type_traits<LeafType>::IsExistValue(node.leaf_)) {
+        visitor(node.leaf_);
+      }
+    }
+  }
+
+  // the same, but visitor receives leaves by reference and could change them
+  template <typename Visitor>
+  void VisitLeaves(Visitor &&visitor) {
+    for (auto &node : nodes_) {
+      if (leaf_type_traits<LeafType>::IsExistValue(node.leaf_)) {
+        visitor(node.leaf_);
+      }
+    }
+  }
+
+  // bytes reserved by the node arena and the route arrays
+  size_t MemoryUsage() const noexcept {
+    size_t memory_usage = nodes_.capacity() * sizeof(Node) + small_routes_.capacity() * sizeof(SmallRoutes) +
+        tables_.capacity() * sizeof(RouteTable);
+    if constexpr (!kIsByteChar) {
+      for (const auto &table : tables_) {
+        memory_usage += table.capacity() * sizeof(typename RouteTable::value_type);
+      }
+    }
+    return memory_usage;
+  }
+
   AhoCorasickEngine(const AhoCorasickEngine&) = delete;
   AhoCorasickEngine& operator=(const AhoCorasickEngine&) = delete;
 
 private:
-  template <typename T1, typename T2, typename T3> friend class AhoCorasickSerializationHelper;
+  template <typename T1, typename T2, typename T3, typename T4> friend class AhoCorasickSerializationHelper;
+  template <typename T1, typename T2> friend class FlatTrieIndex;
+
+  using NodeIndex = uint32_t;
+  using NodeRef = NodeIndex;
+  static constexpr NodeIndex kRootIndex = 0;
+  static constexpr NodeIndex kNoNode = std::numeric_limits<NodeIndex>::max();
+  // most nodes of path keys have one or two children, nodes of digits or letters have up to a few dozens
+  static constexpr uint8_t kInlineRoutesCount = 4;
+  static constexpr uint8_t kSmallRoutesCount = 16;
+  static constexpr bool kIsByteChar = (1 == sizeof(CharType));
+  // chars of one byte index the table directly, wider chars are looked up in the sorted array
+  using RouteTable = std::conditional_t<kIsByteChar, std::array<NodeIndex, 256>,
+      std::vector<std::pair<CharType, NodeIndex>>>;
+
+  enum class RoutesKind : uint8_t { kInline, kSmall, kTable };
+
+  struct SmallRoutes {
+    CharType chars_[kSmallRoutesCount] = {};
+    NodeIndex children_[kSmallRoutesCount] = {};
+    uint8_t routes_count_ = 0;
+  };
 
-  // TODO : for better perfomance and cache-friendly nodes should placed next to each other
-  // in this case traversal would almost free (could used the same allocator as in std::deque)
   struct Node {
     Node() : leaf_(leaf_type_traits<LeafType>::NonExistValue()) {}
-    std::unordered_map<CharType, std::unique_ptr<Node>> routes_;
     LeafType leaf_;
+    // routes of other kinds are in small_routes_ or tables_ by the index in children_[0]
+    NodeIndex children_[kInlineRoutesCount] = {};
+    CharType chars_[kInlineRoutesCount] = {};
+    uint8_t routes_count_ = 0;
+    RoutesKind routes_kind_ = RoutesKind::kInline;
   };
 
-  std::unique_ptr<Node> trie_;
+  std::vector<Node> nodes_;
+  std::vector<SmallRoutes> small_routes_;
+  std::vector<RouteTable> tables_;
+
+  // the moved out engine has no nodes at all
+  bool hasRoot() const noexcept { return !nodes_.empty(); }
+
+  NodeIndex getRootNode() const noexcept {
+    return hasRoot() ? kRootIndex : kNoNode;
+  }
+
+  LeafType getNodeLeaf(NodeIndex node) const noexcept { return nodes_[node].leaf_; }
+
+  NodeIndex getNextNode(CharType ch, NodeIndex current) const noexcept {
+    if (kNoNode == current) {
+      return kNoNode;
+    }
+
+    // reading of vectors doesn't modify them, so it could be called from several readers simultaneously
+    const auto &node = nodes_[current];
+    if (RoutesKind::kInline == node.routes_kind_) {
+      return findRoute(node.chars_, node.children_, node.routes_count_, ch);
+    }
+    else if (RoutesKind::kSmall == node.routes_kind_) {
+      const auto &routes = small_routes_[node.children_[0]];
+      if constexpr (kIsByteChar) {
+        // all routes are compared by one vector compare instead of the loop
+        const auto route_id = bit_utils::FindByte16(reinterpret_cast<const uint8_t*>(routes.chars_),
+            routes.routes_count_, static_cast<uint8_t>(ch));
+        return (route_id < routes.routes_count_) ? routes.children_[route_id] : kNoNode;
+      }
+      else {
+        return findRoute(routes.chars_, routes.children_, routes.routes_count_, ch);
+      }
+    }
+
+    const auto &table = tables_[node.children_[0]];
+    if constexpr (kIsByteChar) {
+      return table[static_cast<uint8_t>(ch)];
+    }
+    else {
+      const auto route = std::lower_bound(std::cbegin(table), std::cend(table), ch,
+          [](const auto &lhs, CharType rhs) { return lhs.first < rhs; });
+      return (std::cend(table) == route || route->first != ch) ? kNoNode : route->second;
+    }
+  }
+
+  static NodeIndex findRoute(const CharType *chars, const NodeIndex *children, uint8_t routes_count,
+      CharType ch) noexcept {
+    for (uint8_t route_id = 0; route_id < routes_count && chars[route_id] <= ch; ++route_id) {
+      if (chars[route_id] == ch) {
+        return children[route_id];
+      }
+    }
+    // the next node hasn't been created yet
+    return kNoNode;
+  }
+
+  // keeps routes sorted, the caller checks that there is a place for the route
+  static void insertRoute(CharType *chars, NodeIndex *children, uint8_t &routes_count, CharType ch,
+      NodeIndex child) noexcept {
+    auto position = routes_count;
+    for (; position > 0 && chars[position - 1] > ch; --position) {
+      chars[position] = chars[position - 1];
+      children[position] = children[position - 1];
+    }
+    chars[position] = ch;
+    children[position] = child;
+    ++routes_count;
+  }
 
-  Node [[nodiscard]] *getNextNode(CharType ch, Node *current) const noexcept {
-    // std::unordered_map::find with standart comparator is exception safe
-    if (nullptr == current || std::cend(current->routes_) == current->routes_.find(ch)) {
-      // the next node hasn't been created yet
-      return nullptr;
+  // the caller checks that there is no route by ch yet, returns the new child node
+  NodeIndex addRoute(CharType ch, NodeIndex current) {
+    // routes are moved to the bigger array before the child is created, so the failed allocation doesn't leave
+    // the unreachable node
+    if (RoutesKind::kInline == nodes_[current].routes_kind_ && kInlineRoutesCount == nodes_[current].routes_count_) {
+      moveRoutesToSmall(current);
+    }
+    else if (RoutesKind::kSmall == nodes_[current].routes_kind_ &&
+        kSmallRoutesCount == small_routes_[nodes_[current].children_[0]].routes_count_) {
+      moveRoutesToTable(current);
+    }
+
+    const auto child = static_cast<NodeIndex>(nodes_.size());
+    nodes_.emplace_back();
+    auto &node = nodes_[current];
+    if (RoutesKind::kInline == node.routes_kind_) {
+      insertRoute(node.chars_, node.children_, node.routes_count_, ch, child);
+      return child;
+    }
+    else if (RoutesKind::kSmall == node.routes_kind_) {
+      auto &routes = small_routes_[node.children_[0]];
+      insertRoute(routes.chars_, routes.children_, routes.routes_count_, ch, child);
+      return child;
     }
 
-    return current->routes_[ch].get();
-  } 
+    auto &table = tables_[node.children_[0]];
+    if constexpr (kIsByteChar) {
+      table[static_cast<uint8_t>(ch)] = child;
+    }
+    else {
+      const auto route = std::lower_bound(std::begin(table), std::end(table), ch,
+          [](const auto &lhs, CharType rhs) { return lhs.first < rhs; });
+      table.emplace(route, ch, child);
+    }
+    return child;
+  }
+
+  void moveRoutesToSmall(NodeIndex current) {
+    SmallRoutes routes;
+    auto &node = nodes_[current];
+    std::copy_n(node.chars_, node.routes_count_, routes.chars_);
+    std::copy_n(node.children_, node.routes_count_, routes.children_);
+    routes.routes_count_ = node.routes_count_;
+
+    small_routes_.push_back(routes);
+    node.children_[0] = static_cast<NodeIndex>(small_routes_.size() - 1);
+    node.routes_count_ = 0;
+    node.routes_kind_ = RoutesKind::kSmall;
+  }
+
+  // the small array stays in small_routes_ unused, nodes never lose their routes
+  void moveRoutesToTable(NodeIndex current) {
+    RouteTable table;
+    auto &node = nodes_[current];
+    const auto &routes = small_routes_[node.children_[0]];
+    if constexpr (kIsByteChar) {
+      table.fill(kNoNode);
+      for (uint8_t route_id = 0; route_id < routes.routes_count_; ++route_id) {
+        table[static_cast<uint8_t>(routes.chars_[route_id])] = routes.children_[route_id];
+      }
+    }
+    else {
+      for (uint8_t route_id = 0; route_id < routes.routes_count_; ++route_id) {
+        table.emplace_back(routes.chars_[route_id], routes.children_[route_id]);
+      }
+    }
+
+    tables_.push_back(std::move(table));
+    node.children_[0] = static_cast<NodeIndex>(tables_.size() - 1);
+    node.routes_kind_ = RoutesKind::kTable;
+  }
+
+  // calls visitor with the char and the child node of each route
+  template <typename Visitor>
+  void visitRoutes(NodeIndex current, Visitor &&visitor) const {
+    const auto &node = nodes_[current];
+    if (RoutesKind::kInline == node.routes_kind_) {
+      for (uint8_t route_id = 0; route_id < node.routes_count_; ++route_id) {
+        visitor(node.chars_[route_id], node.children_[route_id]);
+      }
+      return;
+    }
+    else if (RoutesKind::kSmall == node.routes_kind_) {
+      const auto &routes = small_routes_[node.children_[0]];
+      for (uint8_t route_id = 0; route_id < routes.routes_count_; ++route_id) {
+        visitor(routes.chars_[route_id], routes.children_[route_id]);
+      }
+      return;
+    }
+
+    const auto &table = tables_[node.children_[0]];
+    if constexpr (kIsByteChar) {
+      for (size_t ch = 0; ch < table.size(); ++ch) {
+        if (kNoNode != table[ch]) {
+          visitor(static_cast<CharType>(ch), table[ch]);
+        }
+      }
+    }
+    else {
+      for (const auto &[ch, child] : table) {
+        visitor(ch, child);
+      }
+    }
+  }
 
-  Node *getPathNode(key_type key) const noexcept {
-    auto current = trie_.get();
+  NodeIndex getPathNode(key_type key) const noexcept {
+    auto current = getRootNode();
 
     for (const auto &ch : key) {
       current = getNextNode(ch, current);
-      if (nullptr == current) {
-        return nullptr;
+      if (kNoNode == current) {
+        return kNoNode;
       }
     }
     return current;
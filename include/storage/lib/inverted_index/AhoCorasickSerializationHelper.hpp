@@ -6,16 +6,23 @@
 #include "../common/common.h"
 #include "id_type_traits.hpp"
 #include <cstdint>
+#include <string>
+#include <tuple>
 #include <vector>
 #include <algorithm>
 
 namespace yas {
 namespace index_helper {
 
-template <typename CharType, typename LeafType, typename IdType>
+// the serialized format is the char trie of AhoCorasickEngine, other engines (f.e. AdaptiveRadixTreeEngine) are
+// walked as the equal char trie and filled by keys of the deserialized trie, so the index saved by one engine could be
+// loaded by another
+template <typename CharType, typename LeafType, typename IdType,
+    typename Engine = AhoCorasickEngine<CharType, LeafType>>
 class AhoCorasickSerializationHelper {
-  using Engine = AhoCorasickEngine<CharType, LeafType>;
-  using CharNode = typename Engine::Node;
+  using TrieEngine = AhoCorasickEngine<CharType, LeafType>;
+  using NodeIndex = typename TrieEngine::NodeIndex;
+  using NodeRef = typename Engine::NodeRef;
 
  public:
   static_assert(std::is_integral_v<IdType>, "IdType should be an integral type");
@@ -31,12 +38,12 @@ class AhoCorasickSerializationHelper {
     NodeDescriptorStorage current_level_nodes;
     NodeDescriptorStorage next_level_nodes;
     
-    if (!engine.trie_) {
+    if (!engine.hasRoot()) {
       // nothing to serialize
       return {};
     }
 
-    current_level_nodes.emplace_back(0, engine.trie_.get(), 0, std::char_traits<CharType>::to_char_type('/'));
+    current_level_nodes.emplace_back(0, engine.getRootNode(), 0, std::char_traits<CharType>::to_char_type('/'));
 
     IdType current_node_id = 1;     // root node has been already counted 
     IdType current_leaf_id = 0;
@@ -47,18 +54,18 @@ class AhoCorasickSerializationHelper {
     while (!current_level_nodes.empty()) {
       for (const auto &node_descriptor : current_level_nodes) {
         auto leaf_id = id_type_traits<IdType>::NonExistValue();
-        if (leaf_type_traits<LeafType>::IsExistValue(node_descriptor.node_->leaf_)) {
+        const auto leaf = engine.getNodeLeaf(node_descriptor.node_);
+        if (leaf_type_traits<LeafType>::IsExistValue(leaf)) {
           leaf_id = current_leaf_id;
-          serialized_leafs.push_back(serialize(node_descriptor.node_->leaf_, node_descriptor.node_id_));
+          serialized_leafs.push_back(serialize(leaf, node_descriptor.node_id_));
           ++current_leaf_id;
         }
         serialized_nodes.push_back(serialize(node_descriptor, depth_level, leaf_id));
 
-        next_level_nodes.reserve(node_descriptor.node_->routes_.size());
-        for(auto &route : node_descriptor.node_->routes_) {
-          next_level_nodes.emplace_back(current_node_id, route.second.get(), node_descriptor.node_id_, route.first);
+        engine.visitRoutes(node_descriptor.node_, [&](CharType ch, NodeRef child) {
+          next_level_nodes.emplace_back(current_node_id, child, node_descriptor.node_id_, ch);
           ++current_node_id;
-        }
+        });
 
       }
       ++depth_level;
@@ -89,13 +96,13 @@ class AhoCorasickSerializationHelper {
 
     // at first completely construct the trie on function level
     // and only then modify engine for exception safety
-    auto root = std::make_unique<CharNode>();
+    TrieEngine trie;
 
     NodeDeserializationDescriptorStorage previous_level_nodes;
     NodeDeserializationDescriptorStorage current_level_nodes;
 
     auto aligned_node_id = node_descriptor.node_id_;
-    previous_level_nodes.emplace(aligned_node_id, deserialize(node_descriptor, root.get()));
+    previous_level_nodes.emplace(aligned_node_id, deserialize(node_descriptor, TrieEngine::kRootIndex));
 
     // root extracted -> depth_level should be 1
     IdType depth_level = 1;
@@ -114,8 +121,11 @@ class AhoCorasickSerializationHelper {
       }
 
       const auto parent = parent_element->second;
-      parent.node_->routes_[node_descriptor.parent_node_ch_].reset(new CharNode());
-      const auto route = parent.node_->routes_[node_descriptor.parent_node_ch_].get();
+      if (TrieEngine::kNoNode != trie.getNextNode(node_descriptor.parent_node_ch_, parent.node_)) {
+        throw (exception::YASException("Corrupt data: node has several routes by the same char",
+            storage::StorageError::kInvertedIndexDeserializationError));
+      }
+      const auto route = trie.addRoute(node_descriptor.parent_node_ch_, parent.node_);
       aligned_node_id = node_descriptor.node_id_;
       current_level_nodes.emplace(aligned_node_id, deserialize(node_descriptor, route));
 
@@ -125,11 +135,16 @@ class AhoCorasickSerializationHelper {
           throw (exception::YASException("Corrupt data: node's leaf can't be found",
               storage::StorageError::kInvertedIndexDeserializationError));
         }
-        route->leaf_ = leaf_element->second;
+        trie.nodes_[route].leaf_ = leaf_element->second;
       }
     }
 
-    engine.trie_.swap(root);
+    if constexpr (std::is_same_v<Engine, TrieEngine>) {
+      engine = std::move(trie);
+    }
+    else {
+      engine = insertTrieKeys(trie);
+    }
   }
 
   AhoCorasickSerializationHelper(const AhoCorasickSerializationHelper&) = delete;
@@ -140,12 +155,14 @@ class AhoCorasickSerializationHelper {
  private:
   using NodeSerializationDescriptor = aho_corasick_serialization_headers::NodeSerializationDescriptorT<IdType, CharType>;
   using LeafSerializationDescriptor = aho_corasick_serialization_headers::LeafSerializationDescriptorT<IdType, LeafType>;
-  using NodeDescriptor              = aho_corasick_serialization_headers::NodeDescriptorT<IdType, CharType, CharNode, CharType>;
+  using NodeDescriptor              = aho_corasick_serialization_headers::NodeDescriptorT<IdType, CharType, NodeRef, CharType>;
+  using TrieNodeDescriptor          =
+      aho_corasick_serialization_headers::NodeDescriptorT<IdType, CharType, NodeIndex, CharType>;
   using SerializationDataHeader     = aho_corasick_serialization_headers::SerializationDataHeaderT<IdType>;
   using NodeSerializationDescriptorStorage = std::vector<NodeSerializationDescriptor>;
   using LeafSerializationDescriptorStorage = std::vector<LeafSerializationDescriptor>;
   using NodeDescriptorStorage              = std::vector<NodeDescriptor>;
-  using NodeDeserializationDescriptorStorage = std::unordered_map<IdType, NodeDescriptor>;
+  using NodeDeserializationDescriptorStorage = std::unordered_map<IdType, TrieNodeDescriptor>;
   using LeafDeserializationDescriptorStorage = std::unordered_map<IdType, LeafType>;
 
   utils::Version version_; 
@@ -158,10 +175,37 @@ class AhoCorasickSerializationHelper {
     return { node_id, std::move(leaf) };
   }
 
-  constexpr NodeDescriptor deserialize(const NodeSerializationDescriptor &node_descriptor, CharNode *node) const noexcept {
+  constexpr TrieNodeDescriptor deserialize(const NodeSerializationDescriptor &node_descriptor,
+      NodeIndex node) const noexcept {
     return { node_descriptor.node_id_, node, node_descriptor.parent_node_id_, node_descriptor.parent_node_ch_ };
   }
 
+  static Engine insertTrieKeys(const TrieEngine &trie) {
+    Engine engine;
+    std::basic_string<CharType> key;
+    // routes of the depth-first search: the next node, its char and the length of the key before the char
+    std::vector<std::tuple<NodeIndex, CharType, size_t>> routes;
+    const auto push_routes = [&trie, &routes](NodeIndex node, size_t key_size) {
+      trie.visitRoutes(node, [&routes, key_size](CharType ch, NodeIndex child) {
+        routes.emplace_back(child, ch, key_size);
+      });
+    };
+
+    push_routes(trie.getRootNode(), 0);
+    while (!routes.empty()) {
+      const auto [node, ch, key_size] = routes.back();
+      routes.pop_back();
+      key.resize(key_size);
+      key.push_back(ch);
+      auto leaf = trie.getNodeLeaf(node);
+      if (leaf_type_traits<LeafType>::IsExistValue(leaf)) {
+        engine.Insert(key, leaf);
+      }
+      push_routes(node, key.size());
+    }
+    return engine;
+  }
+
   ByteVector constructResultSerializedBuffer(LeafSerializationDescriptorStorage &serialized_leafs, 
       NodeSerializationDescriptorStorage &serialized_nodes) const {
     ByteVector result(sizeof(SerializationDataHeader) +
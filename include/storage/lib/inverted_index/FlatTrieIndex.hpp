@@ -0,0 +1,365 @@
+#pragma once
+#include "AhoCorasickEngine.hpp"
+#include "leaf_type_traits.hpp"
+#include "../common/bit_utils.h"
+#include "../common/common.h"
+#include "../common/macros.h"
+#include "../exceptions/YASException.hpp"
+#include "../utils/Version.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace yas {
+namespace index_helper {
+namespace flat_trie_headers {
+
+STRUCT_PACK(
+struct FlatTrieHeader {
+  char signature_[4] = { 'Y', 'F', 'T', 'I' };
+  uint32_t nodes_count_ = 0;
+  utils::Version version_;
+  uint8_t char_size_ = 0;
+  uint8_t leaf_size_ = 0;
+});
+
+STRUCT_PACK(
+template <typename LeafType>
+struct FlatTrieNodeT {
+  LeafType leaf_;
+  uint32_t first_child_;
+  uint32_t children_count_;
+});
+
+} // namespace flat_trie_headers
+
+// the serialized char trie that is queried in place: nodes are placed in the breadth-first order, so children of each
+// node are contiguous and sorted by their chars, chars of routes to nodes are kept in the separate array after nodes.
+// Nothing is built on open and only pages of visited nodes are touched (f.e. when the data is mapped from the device).
+// The data isn't trusted: routes outside of the data are treated as missing ones.
+template <typename CharType, typename LeafType>
+class FlatTrieIndex {
+  using Header = flat_trie_headers::FlatTrieHeader;
+  using Node = flat_trie_headers::FlatTrieNodeT<LeafType>;
+  using NodeIndex = uint32_t;
+  using TrieEngine = AhoCorasickEngine<CharType, LeafType>;
+
+ public:
+  static_assert(std::is_trivially_copyable_v<CharType>, "CharType should be POD");
+  static_assert(std::is_trivially_copyable_v<LeafType>, "LeafType should be POD");
+
+  using char_type = CharType;
+  using leaf_type = LeafType;
+  using key_type = std::basic_string_view<CharType>;
+
+  // the data is kept by owner (f.e. the mapped region) while any copy of the index exists
+  FlatTrieIndex(std::shared_ptr<const void> owner, const uint8_t *data, size_t size, utils::Version version)
+      : owner_(std::move(owner)) {
+    load(data, size, version);
+  }
+
+  FlatTrieIndex(ByteVector data, utils::Version version)
+      : FlatTrieIndex(std::make_shared<const ByteVector>(std::move(data)), version)
+  {}
+
+  ~FlatTrieIndex() = default;
+  FlatTrieIndex(const FlatTrieIndex&) = default;
+  FlatTrieIndex(FlatTrieIndex&&) noexcept = default;
+  FlatTrieIndex& operator=(const FlatTrieIndex&) = default;
+  FlatTrieIndex& operator=(FlatTrieIndex&&) noexcept = default;
+
+  LeafType Get(key_type key) const noexcept {
+    const auto node = getPathNode(key);
+    return (kNoNode == node) ? leaf_type_traits<LeafType>::NonExistValue() : getNode(node).leaf_;
+  }
+
+  bool HasKey(key_type key) const noexcept {
+    return leaf_type_traits<LeafType>::IsExistValue(Get(key));
+  }
+
+  int64_t FindMaxSubKey(key_type key) const noexcept {
+    auto current = getRootNode();
+    int64_t max_path = 0;
+
+    for (const auto &ch : key) {
+      current = getNextNode(ch, current);
+      if (kNoNode == current) {
+        return max_path;
+      }
+      ++max_path;
+    }
+    return max_path;
+  }
+
+  // calls visitor for each existing leaf in the breadth-first order of their nodes
+  template <typename Visitor>
+  void VisitLeaves(Visitor &&visitor) const {
+    for (NodeIndex node_id = 0; node_id < nodes_count_; ++node_id) {
+      const auto leaf = getNode(node_id).leaf_;
+      if (leaf_type_traits<LeafType>::IsExistValue(leaf)) {
+        visitor(leaf);
+      }
+    }
+  }
+
+  // calls visitor with the key and the leaf of each existing leaf in the depth-first order, can throw YASException if
+  // routes of the data are corrupted
+  template <typename Visitor>
+  void VisitKeys(Visitor &&visitor) const {
+    std::basic_string<CharType> key;
+    // routes of the depth-first search: the next node and the length of the key before its char
+    std::vector<std::pair<NodeIndex, size_t>> routes;
+    const auto push_routes = [this, &routes](NodeIndex node_id, size_t key_size) {
+      const auto node = getNode(node_id);
+      if (!hasValidChildren(node_id, node)) {
+        throw exception::YASException("Corrupt data: flat trie node children are out of the data",
+            storage::StorageError::kInvertedIndexDeserializationError);
+      }
+      for (NodeIndex child = node.first_child_; child < node.first_child_ + node.children_count_; ++child) {
+        routes.emplace_back(child, key_size);
+      }
+    };
+
+    if (nodes_count_) {
+      push_routes(0, 0);
+    }
+    while (!routes.empty()) {
+      const auto [node_id, key_size] = routes.back();
+      routes.pop_back();
+      key.resize(key_size);
+      key.push_back(getChar(node_id));
+      auto leaf = getNode(node_id).leaf_;
+      if (leaf_type_traits<LeafType>::IsExistValue(leaf)) {
+        visitor(key_type(key), leaf);
+      }
+      push_routes(node_id, key.size());
+    }
+  }
+
+  // the size of the data, the mapped data takes memory only for pages that have been visited
+  size_t MemoryUsage() const noexcept {
+    return sizeof(Header) + static_cast<size_t>(nodes_count_) * (sizeof(Node) + sizeof(CharType));
+  }
+
+  template <typename Engine>
+  static ByteVector Serialize(const Engine &engine, utils::Version version) {
+    using NodeRef = typename Engine::NodeRef;
+    std::vector<Node> nodes;
+    std::vector<CharType> chars;
+    std::vector<NodeRef> node_refs;
+    std::vector<std::pair<CharType, NodeRef>> routes;
+
+    const auto push_node = [&engine, &nodes, &chars, &node_refs](CharType ch, NodeRef node) {
+      if (node_refs.size() >= kNoNode) {
+        throw exception::YASException("Flat trie serialization: too many nodes",
+            storage::StorageError::kInvertedIndexSerializationError);
+      }
+      nodes.push_back({ engine.getNodeLeaf(node), 0, 0 });
+      chars.push_back(ch);
+      node_refs.push_back(node);
+    };
+
+    if (engine.hasRoot()) {
+      push_node(std::char_traits<CharType>::to_char_type('/'), engine.getRootNode());
+    }
+
+    // breadth-first search, children of each node are placed right after children of previous nodes
+    for (size_t node_id = 0; node_id < node_refs.size(); ++node_id) {
+      routes.clear();
+      engine.visitRoutes(node_refs[node_id], [&routes](CharType ch, NodeRef child) {
+        routes.emplace_back(ch, child);
+      });
+      std::sort(std::begin(routes), std::end(routes), [](const auto &lhs, const auto &rhs) {
+        return lhs.first < rhs.first;
+      });
+
+      nodes[node_id].first_child_ = static_cast<NodeIndex>(node_refs.size());
+      nodes[node_id].children_count_ = static_cast<uint32_t>(routes.size());
+      for (const auto &[ch, child] : routes) {
+        push_node(ch, child);
+      }
+    }
+
+    Header header;
+    header.nodes_count_ = static_cast<uint32_t>(nodes.size());
+    header.version_ = version;
+    header.char_size_ = sizeof(CharType);
+    header.leaf_size_ = sizeof(LeafType);
+
+    ByteVector result(sizeof(Header) + nodes.size() * sizeof(Node) + chars.size() * sizeof(CharType));
+    auto *current_cursor = result.data();
+    std::memcpy(current_cursor, &header, sizeof(Header));
+    current_cursor += sizeof(Header);
+    if (!nodes.empty()) {
+      std::memcpy(current_cursor, nodes.data(), nodes.size() * sizeof(Node));
+      current_cursor += nodes.size() * sizeof(Node);
+      std::memcpy(current_cursor, chars.data(), chars.size() * sizeof(CharType));
+    }
+    return result;
+  }
+
+  // builds the changeable engine with the same keys, can throw YASException if routes of the data are corrupted
+  template <typename Engine>
+  Engine ToEngine() const {
+    Engine engine;
+    if constexpr (std::is_same_v<Engine, TrieEngine>) {
+      // nodes are added in the same breadth-first order, so the arena of the engine gets the same layout
+      std::vector<typename TrieEngine::NodeIndex> engine_nodes(nodes_count_, TrieEngine::kNoNode);
+      if (nodes_count_) {
+        engine_nodes[0] = TrieEngine::kRootIndex;
+      }
+      for (NodeIndex node_id = 0; node_id < nodes_count_; ++node_id) {
+        const auto node = getNode(node_id);
+        const auto engine_node = engine_nodes[node_id];
+        if (TrieEngine::kNoNode == engine_node) {
+          throw exception::YASException("Corrupt data: flat trie node hasn't got a parent",
+              storage::StorageError::kInvertedIndexDeserializationError);
+        }
+        engine.nodes_[engine_node].leaf_ = node.leaf_;
+        if (!hasValidChildren(node_id, node)) {
+          throw exception::YASException("Corrupt data: flat trie node children are out of the data",
+              storage::StorageError::kInvertedIndexDeserializationError);
+        }
+
+        for (NodeIndex child = node.first_child_; child < node.first_child_ + node.children_count_; ++child) {
+          const auto ch = getChar(child);
+          if (TrieEngine::kNoNode != engine_nodes[child] ||
+              TrieEngine::kNoNode != engine.getNextNode(ch, engine_node)) {
+            throw exception::YASException("Corrupt data: flat trie node has several routes by the same char",
+                storage::StorageError::kInvertedIndexDeserializationError);
+          }
+          engine_nodes[child] = engine.addRoute(ch, engine_node);
+        }
+      }
+    }
+    else {
+      VisitKeys([&engine](key_type key, LeafType leaf) { engine.Insert(key, leaf); });
+    }
+    return engine;
+  }
+
+ private:
+  static constexpr NodeIndex kNoNode = std::numeric_limits<NodeIndex>::max();
+  static constexpr bool kIsByteChar = (1 == sizeof(CharType));
+  static constexpr uint32_t kVectorCompareSize = 16;
+
+  std::shared_ptr<const void> owner_;
+  const uint8_t *nodes_ = nullptr;
+  const uint8_t *chars_ = nullptr;
+  uint32_t nodes_count_ = 0;
+
+  FlatTrieIndex(std::shared_ptr<const ByteVector> data, utils::Version version)
+      : FlatTrieIndex(data, data->data(), data->size(), version)
+  {}
+
+  void load(const uint8_t *data, size_t size, utils::Version version) {
+    const Header default_header;
+    Header header;
+    if (size < sizeof(Header)) {
+      throw exception::YASException("Invalid data size: data size less than size of the flat trie header",
+          storage::StorageError::kInvertedIndexDeserializationError);
+    }
+    std::memcpy(&header, data, sizeof(Header));
+
+    if (0 != std::memcmp(default_header.signature_, header.signature_, sizeof default_header.signature_)) {
+      throw exception::YASException("Corrupted header: flat trie signature mismatch",
+          storage::StorageError::kInvertedIndexDeserializationError);
+    }
+    else if (version < header.version_) {
+      throw exception::YASException("Corrupted header: header version unsupported",
+          storage::StorageError::kInvertedIndexDeserializationVersionUnsupportedError);
+    }
+    else if (sizeof(CharType) != header.char_size_ || sizeof(LeafType) != header.leaf_size_) {
+      throw exception::YASException("Corrupted header: size of CharType or LeafType mismatch",
+          storage::StorageError::kInvertedIndexDeserializationError);
+    }
+    else if (size - sizeof(Header) != static_cast<uint64_t>(header.nodes_count_) * (sizeof(Node) + sizeof(CharType))) {
+      throw exception::YASException("Invalid data size: there is a mismatch with size of data and nodes count",
+          storage::StorageError::kInvertedIndexDeserializationError);
+    }
+
+    nodes_count_ = header.nodes_count_;
+    nodes_ = data + sizeof(Header);
+    chars_ = nodes_ + static_cast<size_t>(nodes_count_) * sizeof(Node);
+  }
+
+  // fields could be unaligned in the data, so they are copied
+  Node getNode(NodeIndex node_id) const noexcept {
+    Node node;
+    std::memcpy(&node, nodes_ + static_cast<size_t>(node_id) * sizeof(Node), sizeof(Node));
+    return node;
+  }
+
+  CharType getChar(NodeIndex node_id) const noexcept {
+    CharType ch;
+    std::memcpy(&ch, chars_ + static_cast<size_t>(node_id) * sizeof(CharType), sizeof(CharType));
+    return ch;
+  }
+
+  // children are always placed after their parent, so walks over the corrupted data can't loop
+  bool hasValidChildren(NodeIndex node_id, const Node &node) const noexcept {
+    return !node.children_count_ || (node.first_child_ > node_id &&
+        static_cast<uint64_t>(node.first_child_) + node.children_count_ <= nodes_count_);
+  }
+
+  NodeIndex getRootNode() const noexcept {
+    return nodes_count_ ? 0 : kNoNode;
+  }
+
+  NodeIndex getNextNode(CharType ch, NodeIndex current) const noexcept {
+    if (kNoNode == current) {
+      return kNoNode;
+    }
+
+    const auto node = getNode(current);
+    if (!node.children_count_ || !hasValidChildren(current, node)) {
+      return kNoNode;
+    }
+
+    const NodeIndex first_child = node.first_child_;
+    if constexpr (kIsByteChar) {
+      // the vector compare reads all 16 chars, so it is used only when all of them are inside the data
+      if (node.children_count_ <= kVectorCompareSize &&
+          static_cast<uint64_t>(first_child) + kVectorCompareSize <= nodes_count_) {
+        const auto route_id = bit_utils::FindByte16(chars_ + first_child, node.children_count_,
+            static_cast<uint8_t>(ch));
+        return (route_id < node.children_count_) ? first_child + route_id : kNoNode;
+      }
+    }
+
+    // binary search by sorted chars of children
+    NodeIndex low = first_child;
+    NodeIndex high = first_child + node.children_count_;
+    while (low < high) {
+      const auto middle = low + (high - low) / 2;
+      if (getChar(middle) < ch) {
+        low = middle + 1;
+      }
+      else {
+        high = middle;
+      }
+    }
+    return (low < first_child + node.children_count_ && getChar(low) == ch) ? low : kNoNode;
+  }
+
+  NodeIndex getPathNode(key_type key) const noexcept {
+    auto current = getRootNode();
+    for (const auto &ch : key) {
+      current = getNextNode(ch, current);
+      if (kNoNode == current) {
+        return kNoNode;
+      }
+    }
+    return current;
+  }
+};
+
+} // namespace index_helper
+} // namespace yas
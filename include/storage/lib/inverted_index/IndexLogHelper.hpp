@@ -0,0 +1,130 @@
+#pragma once
+#include "leaf_type_traits.hpp"
+#include "../common/common.h"
+#include "../common/macros.h"
+#include "../exceptions/YASException.hpp"
+#include "../utils/Version.hpp"
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace yas {
+namespace index_helper {
+namespace index_log_headers {
+
+STRUCT_PACK(
+struct IndexLogHeader {
+  char signature_[4] = { 'Y', 'I', 'L', 'G' };
+  uint64_t previous_offset_ = 0;
+  uint32_t changes_count_ = 0;
+  utils::Version version_;
+  uint8_t char_size_ = 0;
+  uint8_t leaf_size_ = 0;
+});
+
+// chars of the key follow the change
+STRUCT_PACK(
+template <typename LeafType>
+struct IndexChangeT {
+  LeafType leaf_;
+  uint32_t key_size_;
+});
+
+} // namespace index_log_headers
+
+// one entry of the index log: changes of keys made since the previous entry (or the checkpoint of the whole index)
+// and the offset of the previous entry, so entries are linked from the last one to the checkpoint. Deleted keys have
+// NonExistValue leaves.
+template <typename CharType, typename LeafType>
+class IndexLogHelper {
+  using Header = index_log_headers::IndexLogHeader;
+  using Change = index_log_headers::IndexChangeT<LeafType>;
+
+ public:
+  static_assert(std::is_trivially_copyable_v<CharType>, "CharType should be POD");
+  static_assert(std::is_trivially_copyable_v<LeafType>, "LeafType should be POD");
+
+  using change_type = std::pair<std::basic_string<CharType>, LeafType>;
+
+  static bool IsIndexLog(const uint8_t *data, size_t size) noexcept {
+    const Header default_header;
+    return size >= sizeof(Header) &&
+        0 == std::memcmp(default_header.signature_, data, sizeof default_header.signature_);
+  }
+
+  static ByteVector Serialize(const std::vector<change_type> &changes, uint64_t previous_offset,
+      utils::Version version) {
+    size_t data_size = sizeof(Header);
+    for (const auto &change : changes) {
+      data_size += sizeof(Change) + change.first.size() * sizeof(CharType);
+    }
+
+    Header header;
+    header.previous_offset_ = previous_offset;
+    header.changes_count_ = static_cast<uint32_t>(changes.size());
+    header.version_ = version;
+    header.char_size_ = sizeof(CharType);
+    header.leaf_size_ = sizeof(LeafType);
+
+    ByteVector result(data_size);
+    auto *current_cursor = result.data();
+    std::memcpy(current_cursor, &header, sizeof(Header));
+    current_cursor += sizeof(Header);
+    for (const auto &[key, leaf] : changes) {
+      const Change change{ leaf, static_cast<uint32_t>(key.size()) };
+      std::memcpy(current_cursor, &change, sizeof(Change));
+      current_cursor += sizeof(Change);
+      std::memcpy(current_cursor, key.data(), key.size() * sizeof(CharType));
+      current_cursor += key.size() * sizeof(CharType);
+    }
+    return result;
+  }
+
+  // appends changes of the entry to changes and returns the offset of the previous entry
+  static uint64_t Deserialize(const uint8_t *data, size_t size, utils::Version version,
+      std::vector<change_type> &changes) {
+    if (!IsIndexLog(data, size)) {
+      throw exception::YASException("Corrupted header: index log signature mismatch",
+          storage::StorageError::kInvertedIndexDeserializationError);
+    }
+
+    Header header;
+    std::memcpy(&header, data, sizeof(Header));
+    if (version < header.version_) {
+      throw exception::YASException("Corrupted header: header version unsupported",
+          storage::StorageError::kInvertedIndexDeserializationVersionUnsupportedError);
+    }
+    else if (sizeof(CharType) != header.char_size_ || sizeof(LeafType) != header.leaf_size_) {
+      throw exception::YASException("Corrupted header: size of CharType or LeafType mismatch",
+          storage::StorageError::kInvertedIndexDeserializationError);
+    }
+
+    size_t current_cursor = sizeof(Header);
+    for (uint32_t change_id = 0; change_id < header.changes_count_; ++change_id) {
+      Change change;
+      if (size - current_cursor < sizeof(Change)) {
+        throw exception::YASException("Invalid data size: changes count doesn't correspond to header",
+            storage::StorageError::kInvertedIndexDeserializationError);
+      }
+      std::memcpy(&change, data + current_cursor, sizeof(Change));
+      current_cursor += sizeof(Change);
+
+      if ((size - current_cursor) / sizeof(CharType) < change.key_size_) {
+        throw exception::YASException("Invalid data size: key size is bigger than the rest of data",
+            storage::StorageError::kInvertedIndexDeserializationError);
+      }
+      std::basic_string<CharType> key(change.key_size_, CharType());
+      std::memcpy(&key[0], data + current_cursor, change.key_size_ * sizeof(CharType));
+      current_cursor += change.key_size_ * sizeof(CharType);
+      changes.emplace_back(std::move(key), LeafType(change.leaf_));
+    }
+    return header.previous_offset_;
+  }
+};
+
+} // namespace index_helper
+} // namespace yas
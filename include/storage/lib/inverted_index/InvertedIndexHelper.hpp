@@ -1,18 +1,35 @@
 #pragma once
+#include "AdaptiveRadixTreeEngine.hpp"
 #include "AhoCorasickEngine.hpp"
 #include "AhoCorasickSerializationHelper.hpp"
+#include "FlatTrieIndex.hpp"
+#include "IndexLogHelper.hpp"
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <map>
 #include <memory>
+#include <optional>
+#include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 namespace yas {
 namespace index_helper {
 
-template <typename CharType, typename LeafType>
+// Engine is AhoCorasickEngine (the char trie) or AdaptiveRadixTreeEngine (less memory for long keys), both of them are
+// serialized to the same format. The index opened from the flat format (see FlatTrieIndex) is queried in place, its
+// changes are kept aside until the engine is built from it (f.e. when leaves are updated)
+template <typename CharType, typename LeafType, typename Engine = AhoCorasickEngine<CharType, LeafType>>
 class InvertedIndexHelper {
 public:
+  using engine_type = Engine;
   using char_type = CharType;
   using leaf_type = LeafType;
   using key_type = std::basic_string_view<CharType>;
+  using flat_index_type = FlatTrieIndex<CharType, LeafType>;
+  using change_type = typename IndexLogHelper<CharType, LeafType>::change_type;
 
   InvertedIndexHelper() = default;
   ~InvertedIndexHelper() = default;
@@ -25,71 +42,229 @@ public:
     }
 
     is_changed_ = true;
-    return engine_.Insert(key, leaf);
-  }
-
-  LeafType Get(key_type key) noexcept {
-    if (key.empty()) {
-      return leaf_type_traits<LeafType>::NonExistValue();
-    }
-    return engine_.Get(key);
+    logChange(key, leaf);
+    return insert(key, leaf);
   }
 
   const LeafType Get(key_type key) const noexcept {
     if (key.empty()) {
       return leaf_type_traits<LeafType>::NonExistValue();
     }
-    return engine_.Get(key);
+    else if (!flat_index_) {
+      return engine_.Get(key);
+    }
+
+    const auto flat_change = flat_changes_.find(key);
+    return (std::cend(flat_changes_) != flat_change) ? flat_change->second : flat_index_->Get(key);
   }
 
-  bool Delete(key_type key) noexcept {
+  bool Delete(key_type key) {
     if (key.empty()) {
       return false;
     }
 
     is_changed_ = true;
-    return engine_.Delete(key);
+    if (!erase(key)) {
+      return false;
+    }
+    logChange(key, leaf_type_traits<LeafType>::NonExistValue());
+    return true;
   }
 
   bool HasKey(key_type key) const noexcept {
-    if (key.empty()) {
-      return false;
-    }
-    return engine_.HasKey(key);
+    return leaf_type_traits<LeafType>::IsExistValue(Get(key));
   }
 
   int64_t FindMaxSubKey(key_type key) const noexcept {
     if (key.empty()) {
       return 0;
     }
-    return engine_.FindMaxSubKey(key);
+    else if (!flat_index_) {
+      return engine_.FindMaxSubKey(key);
+    }
+
+    // the longest common prefix with changed keys is reached by one of neighbours of the key in the sorted order
+    int64_t max_path = flat_index_->FindMaxSubKey(key);
+    const auto next_change = flat_changes_.lower_bound(key);
+    if (std::cend(flat_changes_) != next_change) {
+      max_path = std::max(max_path, getCommonPrefixSize(next_change->first, key));
+    }
+    if (std::cbegin(flat_changes_) != next_change) {
+      max_path = std::max(max_path, getCommonPrefixSize(std::prev(next_change)->first, key));
+    }
+    return max_path;
+  }
+
+  template <typename Visitor>
+  void VisitLeaves(Visitor &&visitor) const {
+    if (!flat_index_) {
+      engine_.VisitLeaves(std::forward<Visitor>(visitor));
+      return;
+    }
+    else if (flat_changes_.empty()) {
+      flat_index_->VisitLeaves(std::forward<Visitor>(visitor));
+      return;
+    }
+
+    flat_index_->VisitKeys([this, &visitor](key_type key, LeafType leaf) {
+      if (std::cend(flat_changes_) == flat_changes_.find(key)) {
+        visitor(leaf);
+      }
+    });
+    for (const auto &[key, leaf] : flat_changes_) {
+      if (leaf_type_traits<LeafType>::IsExistValue(leaf)) {
+        visitor(leaf);
+      }
+    }
+  }
+
+  // visitor receives leaves by reference, so it could replace them (f.e. when entries are moved)
+  template <typename Visitor>
+  void UpdateLeaves(Visitor &&visitor) {
+    Materialize();
+    is_changed_ = true;
+    engine_.VisitLeaves(std::forward<Visitor>(visitor));
+  }
+
+  // builds the engine from the flat index and its changes (and releases the flat index data, f.e. the mapped region).
+  // Can throw YASException if the flat index is corrupted.
+  void Materialize() {
+    if (!flat_index_) {
+      return;
+    }
+    engine_ = getMergedEngine();
+    flat_changes_.clear();
+    flat_index_.reset();
+  }
+
+  // applies changes (f.e. of the index log) without logging them again
+  void ApplyChanges(const std::vector<change_type> &changes) {
+    for (const auto &[key, leaf] : changes) {
+      if (key.empty()) {
+        continue;
+      }
+      else if (leaf_type_traits<LeafType>::IsExistValue(leaf)) {
+        insert(key, leaf);
+      }
+      else {
+        erase(key);
+      }
+    }
+  }
+
+  // changes are logged only if it is switched on (f.e. for the index log of PV), they are kept until ClearChanges
+  void log_changes(bool is_logging_changes) { is_logging_changes_ = is_logging_changes; }
+  const std::vector<change_type>& changes() const noexcept { return changes_; }
+
+  // called when the index has been saved
+  void ClearChanges() noexcept {
+    changes_.clear();
+    is_changed_ = false;
   }
 
   constexpr bool is_changed() const { return is_changed_; }
+  bool is_flat() const noexcept { return flat_index_.has_value(); }
+
+  size_t MemoryUsage() const noexcept {
+    if (!flat_index_) {
+      return engine_.MemoryUsage();
+    }
+    return flat_index_->MemoryUsage() + flat_changes_.size() * sizeof(typename FlatChanges::value_type);
+  }
 
   template<typename IdType>
   ByteVector Serialize(utils::Version version) const {
-    AhoCorasickSerializationHelper<CharType, LeafType, IdType> serializer(version);
+    AhoCorasickSerializationHelper<CharType, LeafType, IdType, Engine> serializer(version);
+    if (flat_index_) {
+      return serializer.Serialize(getMergedEngine());
+    }
     return serializer.Serialize(engine_);
   }
 
+  ByteVector SerializeFlat(utils::Version version) const {
+    if (flat_index_) {
+      return flat_index_type::Serialize(getMergedEngine(), version);
+    }
+    return flat_index_type::Serialize(engine_, version);
+  }
+
   template<typename IdType, typename Iterator>
   static std::unique_ptr<InvertedIndexHelper> Deserialize(Iterator begin, Iterator end, utils::Version version) {
-    AhoCorasickSerializationHelper<CharType, LeafType, IdType> serializer(version);
-    auto inverted_index = std::make_unique<InvertedIndexHelper<CharType, LeafType>>();
+    AhoCorasickSerializationHelper<CharType, LeafType, IdType, Engine> serializer(version);
+    auto inverted_index = std::make_unique<InvertedIndexHelper>();
     serializer.Deserialize(begin, end, inverted_index->engine_);
     inverted_index->is_changed_ = false;
 
     return inverted_index;
   }
 
+  // nothing is deserialized, the index is answered by flat_index and changes made after opening
+  static std::unique_ptr<InvertedIndexHelper> Open(flat_index_type flat_index) {
+    auto inverted_index = std::make_unique<InvertedIndexHelper>();
+    inverted_index->flat_index_.emplace(std::move(flat_index));
+    return inverted_index;
+  }
+
   InvertedIndexHelper(const InvertedIndexHelper&) = delete;
   InvertedIndexHelper& operator=(const InvertedIndexHelper&) = delete;
 
  private:
-  AhoCorasickEngine<CharType, LeafType> engine_;
-  // true if index has been changed after creating
+  // changed keys of the flat index, deleted keys have NonExistValue leaves
+  using FlatChanges = std::map<std::basic_string<CharType>, LeafType, std::less<>>;
+
+  Engine engine_;
+  std::optional<flat_index_type> flat_index_;
+  FlatChanges flat_changes_;
+  std::vector<change_type> changes_;
+  bool is_logging_changes_ = false;
+  // true if index has been changed after creating (or the last ClearChanges)
   bool is_changed_ = false;
+
+  bool insert(key_type key, LeafType leaf) {
+    if (!flat_index_) {
+      return engine_.Insert(key, leaf);
+    }
+    flat_changes_.insert_or_assign(std::basic_string<CharType>(key), leaf);
+    return true;
+  }
+
+  // the same as engines, it succeeds if the path of the key exists
+  bool erase(key_type key) {
+    if (!flat_index_) {
+      return engine_.Delete(key);
+    }
+    else if (static_cast<size_t>(FindMaxSubKey(key)) != key.size()) {
+      return false;
+    }
+    flat_changes_.insert_or_assign(std::basic_string<CharType>(key), leaf_type_traits<LeafType>::NonExistValue());
+    return true;
+  }
+
+  void logChange(key_type key, LeafType leaf) {
+    if (is_logging_changes_) {
+      changes_.emplace_back(key, leaf);
+    }
+  }
+
+  Engine getMergedEngine() const {
+    auto engine = flat_index_->template ToEngine<Engine>();
+    for (const auto &[key, leaf] : flat_changes_) {
+      if (leaf_type_traits<LeafType>::IsExistValue(leaf)) {
+        auto inserted_leaf = leaf;
+        engine.Insert(key, inserted_leaf);
+      }
+      else {
+        engine.Delete(key);
+      }
+    }
+    return engine;
+  }
+
+  static int64_t getCommonPrefixSize(key_type lhs, key_type rhs) noexcept {
+    const auto prefix_size = std::min(lhs.size(), rhs.size());
+    return std::distance(std::cbegin(lhs),
+        std::mismatch(std::cbegin(lhs), std::cbegin(lhs) + prefix_size, std::cbegin(rhs)).first);
+  }
 };
 
 } // namespace index_helper
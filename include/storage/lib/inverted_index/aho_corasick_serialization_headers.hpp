@@ -49,10 +49,10 @@ struct LeafSerializationDescriptorT {
 });
 
 STRUCT_PACK( 
-template<typename IdType, typename LeafType, typename CharNode, typename CharType>
+template<typename IdType, typename LeafType, typename NodeRef, typename CharType>
 struct NodeDescriptorT {
   constexpr NodeDescriptorT(IdType node_id,
-      CharNode *node,
+      NodeRef node,
       IdType parent_node_id,
       CharType parent_node_ch)
       : node_id_(node_id),
@@ -63,7 +63,7 @@ struct NodeDescriptorT {
 
   NodeDescriptorT() = default;
 
-  CharNode *node_;
+  NodeRef node_;
   IdType node_id_;
   IdType parent_node_id_;
   CharType parent_node_ch_;
@@ -1,22 +1,45 @@
 #pragma once
 #include "pv_layout_headers.h"
 #include "../../settings.h"
+#include "../common/bit_utils.h"
+#include "../common/common.h"
 #include "../common/offset_type_traits.hpp"
+#include "../utils/serialization_utils.h"
+#include "../exceptions/YASException.hpp"
 #include <array>
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
 
 namespace yas {
 namespace freelist_helper {
 
+// how the free entry for the allocation is chosen
+enum class FitPolicy : uint8_t {
+  kBestFit,     // the smallest free entry that fits
+  kFirstFit     // the free entry with the lowest offset that fits, it keeps the PV end free, but takes more memory
+};
+
+// The in-memory index of free PV entries: each bin keeps its entries ordered by size (so the best fit is found
+// without any device reads) and the whole free space is also ordered by offsets, so adjacent free entries are
+// merged when they are pushed. Sizes are the whole sizes of entries including their headers (entries smaller than
+// the smallest header are kept too, they are merged with neighbours later). The index isn't stored in free entries,
+// it is serialized by Serialize on PV close and restored by Deserialize on PV load. Non-empty bins are marked in the
+// bitmask, so the bin with a suitable entry is found by one count of trailing zeros. Limits of bins are set per PV
+// (see DeriveLimits), they are saved in PV by SerializeLimits.
 template <typename OffsetType>
 class FreelistHelper {
-  using FreelistHeaderType = pv_layout_headers::FreelistHeader<OffsetType>;
-
  public:
-  // the last one must be equals to default cluster size 
-  static constexpr std::array<OffsetType, pv_layout_headers::kBinCount> kFreelistLimits = {
-      sizeof(pv_layout_headers::Simple4TypeHeader), 
-      sizeof(pv_layout_headers::Simple8TypeHeader), 
+  using limits_type = std::array<OffsetType, pv_layout_headers::kBinCount>;
+
+  // limits for PV with the default cluster size (the last one is equals to it)
+  static constexpr limits_type kFreelistLimits = {
+      sizeof(pv_layout_headers::Simple4TypeHeader),
+      sizeof(pv_layout_headers::Simple8TypeHeader),
       64,
       100,
       128,
@@ -26,104 +49,396 @@ class FreelistHelper {
       1520,
       2048,
       kDefaultClusterSize };
-   
+  static_assert(pv_layout_headers::kBinCount <= 32, "non-empty bins should fit the bitmask");
+
   FreelistHelper() {
-    for (int32_t bin_id = 0; bin_id < pv_layout_headers::kBinCount; ++bin_id) {
-      bin_descriptors_[bin_id].offset_ = offset_traits<OffsetType>::NonExistValue();
-      bin_descriptors_[bin_id].limit_ = kFreelistLimits[bin_id];
-    }
+    limits(kFreelistLimits);
   }
 
-  explicit FreelistHelper(const FreelistHeaderType &header) {
-    for (int32_t bin_id = 0; bin_id < pv_layout_headers::kBinCount; ++bin_id) {
-      bin_descriptors_[bin_id].offset_ = header.free_bins_[bin_id];
-      bin_descriptors_[bin_id].limit_ = kFreelistLimits[bin_id];
-    }
+  ~FreelistHelper() = default;
+
+  // the historical limits are kept for the default cluster size, for other sizes they are spread between the sizes
+  // of simple headers and the cluster size
+  static limits_type DefaultLimits(int32_t cluster_size) {
+    return kDefaultClusterSize == static_cast<uint32_t>(cluster_size) ? kFreelistLimits :
+        DeriveLimits({}, cluster_size);
   }
 
-  void SetBins(const FreelistHeaderType &header) noexcept {
-    for (int32_t bin_id = 0; bin_id < pv_layout_headers::kBinCount; ++bin_id) {
-      bin_descriptors_[bin_id].offset_ = header.free_bins_[bin_id];
-      bin_descriptors_[bin_id].limit_ = kFreelistLimits[bin_id];
+  // derives limits from counts of entries by their sizes (f.e. of the existing PV): the first limits are sizes of
+  // simple headers and the last one is the cluster size. Others split entries between them into bins with equal
+  // counts of entries, if there are not enough different sizes then the widest bins are split in the middle (by the
+  // geometric mean)
+  static limits_type DeriveLimits(const std::map<OffsetType, uint64_t> &sizes_histogram, int32_t cluster_size) {
+    constexpr OffsetType kSmallLimit = sizeof(pv_layout_headers::Simple8TypeHeader);
+    constexpr uint64_t kMiddleLimitsCount = pv_layout_headers::kBinCount - 3;
+    const OffsetType cluster_limit = roundLimit(static_cast<OffsetType>(cluster_size));
+
+    uint64_t entries_count = 0;
+    for (auto size_it = sizes_histogram.upper_bound(kSmallLimit);
+        std::cend(sizes_histogram) != size_it && size_it->first < cluster_limit; ++size_it) {
+      entries_count += size_it->second;
     }
+
+    std::vector<OffsetType> limits = { sizeof(pv_layout_headers::Simple4TypeHeader), kSmallLimit, cluster_limit };
+    uint64_t accumulated_count = 0;
+    uint64_t quantile_id = 1;
+    for (auto size_it = sizes_histogram.upper_bound(kSmallLimit); quantile_id < kMiddleLimitsCount + 1 &&
+        std::cend(sizes_histogram) != size_it && size_it->first < cluster_limit; ++size_it) {
+      accumulated_count += size_it->second;
+      if (accumulated_count * (kMiddleLimitsCount + 1) < quantile_id * entries_count) {
+        continue;
+      }
+
+      const auto limit = roundLimit(size_it->first);
+      if (limit > *std::prev(std::end(limits), 2) && limit < cluster_limit) {
+        limits.insert(std::prev(std::end(limits)), limit);
+      }
+      while (quantile_id < kMiddleLimitsCount + 1 &&
+          accumulated_count * (kMiddleLimitsCount + 1) >= quantile_id * entries_count) {
+        ++quantile_id;
+      }
+    }
+
+    while (limits.size() < pv_layout_headers::kBinCount) {
+      auto widest_it = std::next(std::begin(limits));
+      for (auto limit_it = std::next(widest_it); std::end(limits) != limit_it; ++limit_it) {
+        if (static_cast<uint64_t>(*limit_it) * *std::prev(widest_it) >
+            static_cast<uint64_t>(*widest_it) * *std::prev(limit_it)) {
+          widest_it = limit_it;
+        }
+      }
+
+      const auto middle_limit = roundLimit(static_cast<OffsetType>(
+          std::sqrt(static_cast<double>(*std::prev(widest_it)) * static_cast<double>(*widest_it))));
+      if (middle_limit <= *std::prev(widest_it) || middle_limit >= *widest_it) {
+        throw exception::YASException("Freelist limits deriving: the cluster is too small",
+            storage::StorageError::kInvalidFreelistLimits);
+      }
+      limits.insert(widest_it, middle_limit);
+    }
+
+    limits_type derived_limits;
+    std::copy(std::cbegin(limits), std::cend(limits), std::begin(derived_limits));
+    return derived_limits;
+  }
+
+  // returns the offset of the free entry that fits entry_size (by the fit policy) or NonExistValue
+  OffsetType PopFreeEntryOffset(OffsetType entry_size) {
+    return PopFreeEntry(entry_size, entry_size).first;
   }
 
-  FreelistHeaderType GetBins() const {
-    FreelistHeaderType header;
-    for (int32_t bin_id = 0; bin_id < pv_layout_headers::kBinCount; ++bin_id) {
-      header.free_bins_[bin_id] = bin_descriptors_[bin_id].offset_;
+  // returns the offset and the size of the free entry that fits entry_size (by the fit policy). If there isn't such
+  // entry then the biggest one is returned if it isn't smaller than minimum_size (f.e. for the chain of clusters),
+  // otherwise the offset is NonExistValue
+  std::pair<OffsetType, OffsetType> PopFreeEntry(OffsetType entry_size, OffsetType minimum_size) {
+    const auto bin_id = getBinIdForSize(entry_size);
+    if (FitPolicy::kFirstFit == fit_policy_) {
+      // any entry of the next bins fits, so only the lowest ones of them are compared. The own bin could keep smaller
+      // entries, it is scanned only up to the lowest entry of the next bins
+      OffsetType found_offset = std::numeric_limits<OffsetType>::max();
+      for (uint32_t next_bins = non_empty_bins_ & ~((2u << bin_id) - 1); 0 != next_bins; next_bins &= next_bins - 1) {
+        const auto &next_bin_offsets = bin_offsets_[bit_utils::CountTrailingZeros(next_bins)];
+        found_offset = std::min(found_offset, std::begin(next_bin_offsets)->first);
+      }
+      for (const auto &[offset, free_size] : bin_offsets_[bin_id]) {
+        if (offset >= found_offset) {
+          break;
+        }
+        else if (free_size >= entry_size) {
+          found_offset = offset;
+          break;
+        }
+      }
+      if (std::numeric_limits<OffsetType>::max() != found_offset) {
+        return popFreeEntry(entries_.find(found_offset));
+      }
     }
+    else {
+      // the own bin could keep smaller entries, but any entry of the next bins fits
+      if (non_empty_bins_ & (1u << bin_id)) {
+        const auto found_entry_it = bins_[bin_id].lower_bound({ entry_size, 0 });
+        if (std::end(bins_[bin_id]) != found_entry_it) {
+          return popFreeEntry(entries_.find(found_entry_it->second));
+        }
+      }
 
-    return header;
+      if (const uint32_t next_bins = non_empty_bins_ & ~((2u << bin_id) - 1); 0 != next_bins) {
+        const auto next_bin_id = bit_utils::CountTrailingZeros(next_bins);
+        return popFreeEntry(entries_.find(std::begin(bins_[next_bin_id])->second));
+      }
+    }
+
+    if (const uint32_t previous_bins = non_empty_bins_ & ((2u << bin_id) - 1);
+        minimum_size < entry_size && 0 != previous_bins) {
+      const auto previous_bin_id = bit_utils::HighestSetBit(previous_bins);
+      const auto biggest_entry_it = std::prev(std::end(bins_[previous_bin_id]));
+      if (biggest_entry_it->first >= minimum_size) {
+        return popFreeEntry(entries_.find(biggest_entry_it->second));
+      }
+    }
+
+    return { offset_traits<OffsetType>::NonExistValue(), 0 };
   }
 
-  ~FreelistHelper() = default;
+  // returns the offset and the size of the lowest free entry that fits entry_size and starts before offset_limit
+  // (f.e. to move the entry closer to the PV beginning), otherwise the offset is NonExistValue
+  std::pair<OffsetType, OffsetType> PopLowerFreeEntry(OffsetType entry_size, OffsetType offset_limit) {
+    for (auto entry_it = std::begin(entries_); std::end(entries_) != entry_it && entry_it->first < offset_limit;
+        ++entry_it) {
+      if (entry_it->second >= entry_size) {
+        return popFreeEntry(entry_it);
+      }
+    }
+    return { offset_traits<OffsetType>::NonExistValue(), 0 };
+  }
 
-  OffsetType PopFreeEntryOffset(OffsetType entry_size) {
-    // very simple strategy
-    bool is_less_cluster_size = entry_size < kDefaultClusterSize;
+  // returns the size of the free entry that ends at device_end or zero if there isn't such entry
+  OffsetType GetTailFreeSize(OffsetType device_end) const noexcept {
+    if (entries_.empty()) {
+      return 0;
+    }
+    const auto &[last_offset, last_size] = *std::crbegin(entries_);
+    return last_offset + last_size == device_end ? last_size : 0;
+  }
 
-    int32_t last_viewed_freed_bin_id = -1;
-    for (int32_t bin_id = 0; bin_id < pv_layout_headers::kBinCount; ++bin_id) {
-      if (entry_size <= bin_descriptors_[bin_id].limit_ 
-          && offset_traits<OffsetType>::IsExistValue(bin_descriptors_[bin_id].offset_)) {
-        const auto offset = bin_descriptors_[bin_id].offset_;
-        bin_descriptors_[bin_id].offset_ = offset_traits<OffsetType>::NonExistValue();
-        return offset;
+  // returns the offset and the size of the free entry that ends at device_end (so the device could be truncated),
+  // otherwise the offset is NonExistValue
+  std::pair<OffsetType, OffsetType> PopTailFreeEntry(OffsetType device_end) {
+    if (!entries_.empty()) {
+      const auto last_entry_it = std::prev(std::end(entries_));
+      if (last_entry_it->first + last_entry_it->second == device_end) {
+        return popFreeEntry(last_entry_it);
       }
-      if (!is_less_cluster_size && offset_traits<OffsetType>::IsExistValue(bin_descriptors_[bin_id].offset_)) {
-        last_viewed_freed_bin_id = bin_id;
+    }
+    return { offset_traits<OffsetType>::NonExistValue(), 0 };
+  }
+
+  // the entry is merged with the adjacent free entries, entries that overlap the already free space are ignored
+  void PushFreeEntry(OffsetType new_offset, OffsetType entry_size) {
+    auto next_entry_it = entries_.lower_bound(new_offset);
+    if (0 == entry_size || (std::end(entries_) != next_entry_it && next_entry_it->first < new_offset + entry_size)) {
+      return;
+    }
+
+    auto previous_entry_it = std::end(entries_);
+    if (std::begin(entries_) != next_entry_it) {
+      previous_entry_it = std::prev(next_entry_it);
+      if (previous_entry_it->first + previous_entry_it->second > new_offset) {
+        return;
       }
     }
 
-    if (!is_less_cluster_size && last_viewed_freed_bin_id > 5) {
-      const auto offset = bin_descriptors_[last_viewed_freed_bin_id].offset_;
-      bin_descriptors_[last_viewed_freed_bin_id].offset_ = offset_traits<OffsetType>::NonExistValue();
-      return offset;
+    if (std::end(entries_) != next_entry_it && next_entry_it->first == new_offset + entry_size) {
+      entry_size += next_entry_it->second;
+      eraseEntry(next_entry_it);
+    }
+    if (std::end(entries_) != previous_entry_it && previous_entry_it->first + previous_entry_it->second == new_offset) {
+      new_offset = previous_entry_it->first;
+      entry_size += previous_entry_it->second;
+      eraseEntry(previous_entry_it);
     }
 
-    return offset_traits<OffsetType>::NonExistValue();
+    entries_.emplace(new_offset, entry_size);
+    addToBin(new_offset, entry_size);
+    free_size_ += entry_size;
   }
 
-  OffsetType PushFreeEntry(OffsetType new_offset, OffsetType entry_size) {
-    const auto bin_id = getBinIdForSize(entry_size);
-    const auto offset = bin_descriptors_[bin_id].offset_;
-    bin_descriptors_[bin_id].offset_ = new_offset;
-    return offset;
+  // checks if offset lies inside some free entry (it could be merged with the previous one)
+  bool HasFreeEntry(OffsetType offset) const {
+    const auto next_entry_it = entries_.upper_bound(offset);
+    if (std::begin(entries_) == next_entry_it) {
+      return false;
+    }
+    const auto &[entry_offset, entry_size] = *std::prev(next_entry_it);
+    return offset - entry_offset < entry_size;
   }
 
-  OffsetType GetFreeEntry(OffsetType entry_size) const {
-    if (entry_size > kDefaultClusterSize) {
-      entry_size = kDefaultClusterSize;
+  void Clear() noexcept {
+    entries_.clear();
+    for (auto &bin : bins_) {
+      bin.clear();
+    }
+    for (auto &bin_offsets : bin_offsets_) {
+      bin_offsets.clear();
     }
+    non_empty_bins_ = 0;
+    free_size_ = 0;
+  }
 
-    const auto bin_id = getBinIdForSize(entry_size);
-    return bin_descriptors_[bin_id].offset_;
+  // entries are saved in the offset order as varints of the gap after the previous entry and of the entry size, so
+  // the index usually takes a few bytes per entry
+  ByteVector Serialize() const {
+    ByteVector serialized_index;
+    serialized_index.reserve(entries_.size() * 4);
+    OffsetType previous_end = 0;
+    for (const auto &[offset, entry_size] : entries_) {
+      serialization_utils::SaveVarint(serialized_index, offset - previous_end);
+      serialization_utils::SaveVarint(serialized_index, entry_size);
+      previous_end = offset + entry_size;
+    }
+
+    return serialized_index;
+  }
+
+  // replaces the index by the serialized one, throws YASException if it is corrupted
+  template <typename Iterator>
+  void Deserialize(Iterator begin, const Iterator end) {
+    Clear();
+    OffsetType previous_end = 0;
+    while (begin != end) {
+      const auto gap = loadVarint(begin, end);
+      const auto entry_size = loadVarint(begin, end);
+      if (0 == entry_size || previous_end + gap < previous_end || previous_end + gap + entry_size < previous_end) {
+        throw exception::YASException("Free space index loading: corrupted entry",
+            storage::StorageError::kCorruptedHeaderError);
+      }
+      PushFreeEntry(previous_end + gap, entry_size);
+      previous_end += gap + entry_size;
+    }
+  }
+
+  // limits are saved as varints
+  ByteVector SerializeLimits() const {
+    ByteVector serialized_limits;
+    for (const auto limit : limits_) {
+      serialization_utils::SaveVarint(serialized_limits, limit);
+    }
+    return serialized_limits;
+  }
+
+  template <typename Iterator>
+  static limits_type DeserializeLimits(Iterator begin, const Iterator end) {
+    limits_type limits;
+    for (auto &limit : limits) {
+      limit = loadVarint(begin, end);
+    }
+    if (begin != end) {
+      throw exception::YASException("Freelist limits loading: corrupted limits",
+          storage::StorageError::kCorruptedHeaderError);
+    }
+    return limits;
+  }
+
+  const limits_type &limits() const noexcept { return limits_; }
+
+  // the new limits should increase and be multiples of 4 (otherwise YASException is thrown), free entries are moved
+  // to the new bins
+  void limits(const limits_type &limits) {
+    for (uint32_t bin_id = 0; bin_id < pv_layout_headers::kBinCount; ++bin_id) {
+      if (0 == limits[bin_id] || 0 != limits[bin_id] % 4 || (0 != bin_id && limits[bin_id] <= limits[bin_id - 1])) {
+        throw exception::YASException("Freelist limits setting: limits should increase and be multiples of 4",
+            storage::StorageError::kInvalidFreelistLimits);
+      }
+    }
+
+    limits_ = limits;
+    bin_ids_.assign(std::min<OffsetType>(limits_.back(), kBinIdsTableLimit) / 4 + 1, 0);
+    uint8_t bin_id = 0;
+    for (size_t quarter = 0; quarter < bin_ids_.size(); ++quarter) {
+      while (limits_[bin_id] < quarter * 4) {
+        ++bin_id;
+      }
+      bin_ids_[quarter] = bin_id;
+    }
+    refillBins();
   }
 
+  FitPolicy fit_policy() const noexcept { return fit_policy_; }
+  // entries of bins are ordered by offsets too for the first fit
+  void fit_policy(FitPolicy fit_policy) {
+    fit_policy_ = fit_policy;
+    refillBins();
+  }
+
+  // overall size of free entries
+  OffsetType free_size() const noexcept { return free_size_; }
+  size_t entries_count() const noexcept { return entries_.size(); }
+  // sizes of free entries by their offsets
+  const std::map<OffsetType, OffsetType> &entries() const noexcept { return entries_; }
+
   FreelistHelper(FreelistHelper&) = delete;
   FreelistHelper(FreelistHelper&&) = delete;
   FreelistHelper& operator=(const FreelistHelper&) = delete;
   FreelistHelper& operator= (FreelistHelper&&) = delete;
 
  private:
-  struct BinDescriptor {
-    OffsetType offset_;
-    OffsetType limit_;
-  };
-  std::array<BinDescriptor, pv_layout_headers::kBinCount> bin_descriptors_;
+  using BinEntries = std::set<std::pair<OffsetType, OffsetType>>;    // pairs of the size and the offset
+  using BinOffsets = std::map<OffsetType, OffsetType>;               // sizes of entries by their offsets
+
+  // sizes up to this one are mapped to bins by the table, bigger ones are searched in limits
+  static constexpr OffsetType kBinIdsTableLimit = 0x4000;
+
+  limits_type limits_;
+  std::vector<uint8_t> bin_ids_;                                     // ids of bins by quarters of sizes
+  std::array<BinEntries, pv_layout_headers::kBinCount> bins_;
+  std::array<BinOffsets, pv_layout_headers::kBinCount> bin_offsets_;  // kept only for the first fit
+  std::map<OffsetType, OffsetType> entries_;                         // sizes of free entries by their offsets
+  uint32_t non_empty_bins_ = 0;                                      // a bit per bin
+  OffsetType free_size_ = 0;
+  FitPolicy fit_policy_ = FitPolicy::kBestFit;
+
+  void eraseEntry(typename std::map<OffsetType, OffsetType>::iterator entry_it) {
+    const auto [offset, entry_size] = *entry_it;
+    const auto bin_id = getBinIdForSize(entry_size);
+    bins_[bin_id].erase({ entry_size, offset });
+    bin_offsets_[bin_id].erase(offset);
+    if (bins_[bin_id].empty()) {
+      non_empty_bins_ &= ~(1u << bin_id);
+    }
+    entries_.erase(entry_it);
+    free_size_ -= entry_size;
+  }
+
+  void addToBin(OffsetType offset, OffsetType entry_size) {
+    const auto bin_id = getBinIdForSize(entry_size);
+    bins_[bin_id].emplace(entry_size, offset);
+    if (FitPolicy::kFirstFit == fit_policy_) {
+      bin_offsets_[bin_id].emplace(offset, entry_size);
+    }
+    non_empty_bins_ |= 1u << bin_id;
+  }
+
+  void refillBins() {
+    non_empty_bins_ = 0;
+    for (auto &bin : bins_) {
+      bin.clear();
+    }
+    for (auto &bin_offsets : bin_offsets_) {
+      bin_offsets.clear();
+    }
+    for (const auto &[offset, entry_size] : entries_) {
+      addToBin(offset, entry_size);
+    }
+  }
+
+  std::pair<OffsetType, OffsetType> popFreeEntry(typename std::map<OffsetType, OffsetType>::iterator entry_it) {
+    const std::pair<OffsetType, OffsetType> free_entry = *entry_it;
+    eraseEntry(entry_it);
+    return free_entry;
+  }
 
   uint32_t getBinIdForSize(OffsetType entry_size) const {
-    auto found_value_it = std::lower_bound(std::cbegin(bin_descriptors_), std::cend(bin_descriptors_), entry_size, [](
-        const BinDescriptor &bin_descriptor,
-        const OffsetType entry_size) {
-      return entry_size > bin_descriptor.limit_;
-    });
-    if (std::cend(bin_descriptors_) == found_value_it) {
-      return pv_layout_headers::kBinCount - 1;
+    if (entry_size / 4 < bin_ids_.size() - 1) {
+      return bin_ids_[(entry_size + 3) / 4];
     }
 
-    return static_cast<uint32_t>(std::distance(std::cbegin(bin_descriptors_), found_value_it));
+    const auto found_limit_it = std::lower_bound(std::cbegin(limits_), std::cend(limits_), entry_size);
+    return std::cend(limits_) == found_limit_it ? pv_layout_headers::kBinCount - 1 :
+        static_cast<uint32_t>(std::distance(std::cbegin(limits_), found_limit_it));
+  }
+
+  static OffsetType roundLimit(OffsetType size) {
+    return (size + 3) / 4 * 4;
+  }
+
+  template <typename Iterator>
+  static OffsetType loadVarint(Iterator &begin, const Iterator end) {
+    OffsetType value = 0;
+    if (!serialization_utils::LoadVarint(begin, end, value)) {
+      throw exception::YASException("Free space index loading: corrupted varint",
+          storage::StorageError::kCorruptedHeaderError);
+    }
+    return value;
   }
 };
 
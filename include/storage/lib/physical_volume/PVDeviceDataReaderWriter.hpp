@@ -2,7 +2,12 @@
 #include "pv_layout_headers.h"
 #include "../utils/serialization_utils.h"
 #include "../devices/FileDevice.hpp"
+#include "../devices/io_segments.h"
+#include <algorithm>
+#include <array>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 namespace yas {
 namespace pv {
@@ -30,11 +35,24 @@ class PVDeviceDataReaderWriter {
   ValueType Read(OffsetType offset) {
     static_assert(std::is_trivially_copyable_v<ValueType>, "PVDeviceDataReaderWriter::Read<Type>: Type should be POD");
 
-    ByteVector raw_bytes(sizeof(ValueType));
+    // headers are read directly to the object bytes without any intermediate buffers
+    ValueType type;
+    auto raw_bytes = serialization_utils::AsBytes(&type);
     device_.Read(offset, std::begin(raw_bytes), std::end(raw_bytes));
+    return type;
+  }
 
-    ValueType type;
-    serialization_utils::LoadFromBytes(std::cbegin(raw_bytes), std::cend(raw_bytes), &type);
+  // reads only the first read_size bytes of the type, the rest is value-initialized (f.e. the entry at the device
+  // end could be smaller than the union of all entry headers)
+  template <typename ValueType>
+  ValueType Read(OffsetType offset, size_t read_size) {
+    static_assert(std::is_trivially_copyable_v<ValueType>, "PVDeviceDataReaderWriter::Read<Type>: Type should be POD");
+
+    ValueType type{};
+    auto raw_bytes = serialization_utils::AsBytes(&type);
+    auto read_end = std::begin(raw_bytes);
+    std::advance(read_end, std::min(read_size, sizeof type));
+    device_.Read(offset, std::begin(raw_bytes), read_end);
     return type;
   }
 
@@ -42,64 +60,89 @@ class PVDeviceDataReaderWriter {
   void Write(OffsetType position, const ValueType &type) {
     static_assert(std::is_trivially_copyable_v<ValueType>, "PVDeviceDataReaderWriter::Write<Type>: Type should be POD");
 
-    ByteVector data(sizeof(ValueType));
-    serialization_utils::SaveAsBytes(std::begin(data), std::end(data), &type);
-    device_.Write(position, std::cbegin(data), std::cend(data));
+    const auto raw_bytes = serialization_utils::AsBytes(&type);
+    device_.Write(position, raw_bytes.cbegin(), raw_bytes.cend());
   }
 
   ByteVector ReadComplexType(OffsetType offset) {
-    pv_layout_headers::ComplexTypeHeader type_header = Read<pv_layout_headers::ComplexTypeHeader>(offset);
-    checkComplexTypeHeader(type_header, true);
+    return ReadComplexType(offset, Read<pv_layout_headers::ComplexTypeHeader>(offset));
+  }
+
+  // the first header could be already readed by the caller. At first the whole chain of headers is walked and then
+  // all chunks are readed by the one vectored read
+  ByteVector ReadComplexType(OffsetType offset, pv_layout_headers::ComplexTypeHeader type_header) {
+    CheckComplexTypeHeader(type_header, true);
 
+    const auto data_offset = serialization_utils::offset_of(&pv_layout_headers::ComplexTypeHeader::data_);
     ByteVector complex_data(type_header.overall_size_);
-    OffsetType readed_size = 0;
     const OffsetType overall_size = type_header.overall_size_;
+    OffsetType readed_size = 0;
 
-    offset += serialization_utils::offset_of(&pv_layout_headers::ComplexTypeHeader::data_);
-    auto read_cursor_begin = std::begin(complex_data);
-    auto read_cursor_end = std::begin(complex_data);
-    std::advance(read_cursor_end, type_header.chunk_size_);
-    device_.Read(offset, read_cursor_begin, read_cursor_end);
-    readed_size += type_header.chunk_size_;
+    // headers between adjacent chunks are readed again to the scratch buffer, so the device could merge the whole
+    // run of chunks into one request
+    std::array<uint8_t, sizeof(pv_layout_headers::ComplexTypeHeader)> header_scratch;
+    std::vector<devices::ReadSegment<OffsetType>> segments;
+    while (true) {
+      if ((0 == type_header.chunk_size_ && readed_size < overall_size) ||
+          type_header.chunk_size_ > overall_size - readed_size) {
+        throw exception::YASException("Read complex type error: chunk size is bigger than the rest of value",
+            storage::StorageError::kCorruptedHeaderError);
+      }
+
+      if (!segments.empty() && segments.back().position_ + segments.back().size_ == offset) {
+        segments.push_back({ offset, header_scratch.data(), data_offset });
+      }
+      segments.push_back({ offset + data_offset, complex_data.data() + readed_size, type_header.chunk_size_ });
+      readed_size += type_header.chunk_size_;
+      if (readed_size >= overall_size) {
+        break;
+      }
 
-    while (readed_size < overall_size) {
       offset = type_header.sequel_offset_;
-      type_header = Read<pv_layout_headers::ComplexTypeHeader>(type_header.sequel_offset_);
-      checkComplexTypeHeader(type_header, false);
-      offset += serialization_utils::offset_of(&pv_layout_headers::ComplexTypeHeader::data_);
-
-      read_cursor_begin = read_cursor_end;
-      std::advance(read_cursor_end, type_header.chunk_size_);
-      readed_size += type_header.chunk_size_;
-      device_.Read(offset, read_cursor_begin, read_cursor_end);
+      type_header = Read<pv_layout_headers::ComplexTypeHeader>(offset);
+      CheckComplexTypeHeader(type_header, false);
     }
 
+    device_.ReadV(segments);
     return complex_data;
   }
 
+  // writes chunks (pairs of the entry offset and the filled header) of the complex type by the one vectored write,
+  // each header is written right before its data
+  template <typename Iterator>
+  void WriteComplexType(const std::vector<std::pair<OffsetType, pv_layout_headers::ComplexTypeHeader>> &chunks,
+      Iterator begin) {
+    const auto data_offset = serialization_utils::offset_of(&pv_layout_headers::ComplexTypeHeader::data_);
+    std::vector<devices::WriteSegment<OffsetType>> segments;
+    segments.reserve(chunks.size() * 2);
+
+    size_t written_size = 0;
+    for (const auto &[offset, header] : chunks) {
+      segments.push_back({ offset, reinterpret_cast<const uint8_t*>(&header), data_offset });
+      if (0 != header.chunk_size_) {
+        auto chunk_begin = begin;
+        std::advance(chunk_begin, written_size);
+        segments.push_back({ offset + data_offset, reinterpret_cast<const uint8_t*>(&(*chunk_begin)),
+            header.chunk_size_ });
+      }
+      written_size += header.chunk_size_;
+    }
+
+    device_.WriteV(segments);
+  }
+
+  // writes the extent header with the whole value by the one vectored write. The unused tail of the extent isn't
+  // written, the device space for the extent has been already reserved
   template <typename Iterator>
-  OffsetType WriteComplexType(OffsetType offset, pv_layout_headers::PVType pv_type, bool is_first, 
-      OffsetType next_free_offset,Iterator begin, Iterator end) {
-    pv_layout_headers::ComplexTypeHeader header = Read<pv_layout_headers::ComplexTypeHeader>(offset);
-    const auto data_size = std::distance(begin, end);
-    const auto written = std::min<OffsetType>(header.chunk_size_, data_size);
-
-    header.overall_size_ = data_size;
-    header.value_type_ = pv_type;
-    header.value_state_ = (is_first ? pv_layout_headers::PVTypeState::kComplexBegin : 
-        pv_layout_headers::PVTypeState::kComplexSequel);
-    header.chunk_size_ = written;
-    header.sequel_offset_ = next_free_offset;
-
-    auto new_end = begin;
-    std::advance(new_end, written);
-    // at first try to write data 
-    Write<pv_layout_headers::ComplexTypeHeader>(offset, header);
-    device_.Write(offset + 
-        serialization_utils::offset_of(&pv_layout_headers::ComplexTypeHeader::data_), begin, new_end);
-    // and only then header to don't loose original header if data writing will fails with exception
-
-    return written;
+  void WriteExtentType(OffsetType offset, const pv_layout_headers::ComplexTypeHeader &header, Iterator begin) {
+    const auto data_offset = serialization_utils::offset_of(&pv_layout_headers::ComplexTypeHeader::data_);
+    std::vector<devices::WriteSegment<OffsetType>> segments;
+    segments.push_back({ offset, reinterpret_cast<const uint8_t*>(&header), data_offset });
+    if (0 != header.chunk_size_) {
+      segments.push_back({ offset + data_offset, reinterpret_cast<const uint8_t*>(&(*begin)), header.chunk_size_ });
+    }
+
+    device_.WriteV(segments);
   }
 
   ByteVector RawRead(OffsetType offset, OffsetType size) {
@@ -114,20 +157,22 @@ class PVDeviceDataReaderWriter {
     return device_.Write(offset, begin, end);
   }
 
-#ifdef UNIT_TEST
-  Device& GetDevice() const { return device_; }
-#endif
+  // makes the device at least size bytes long without writing the new space (if the device supports it)
+  void Reserve(OffsetType size) {
+    device_.Reserve(size);
+  }
 
-  PVDeviceDataReaderWriter(const PVDeviceDataReaderWriter&) = delete;
-  PVDeviceDataReaderWriter(PVDeviceDataReaderWriter&&) = default;
-  PVDeviceDataReaderWriter& operator=(const PVDeviceDataReaderWriter&) = delete;
-  PVDeviceDataReaderWriter& operator=(PVDeviceDataReaderWriter&&) = delete;
+  void Truncate(OffsetType size) {
+    device_.Truncate(size);
+  }
 
- private:
-  Device device_;
-  uint32_t cluster_size_;
+  // submits the batch of asynchronous reads (available only for devices with SubmitReads, f.e. AsyncFileDevice)
+  template <typename AsyncReads>
+  void SubmitReads(AsyncReads &&reads) {
+    device_.SubmitReads(std::forward<AsyncReads>(reads));
+  }
 
-  void checkComplexTypeHeader(const pv_layout_headers::ComplexTypeHeader &complex_header, bool is_first_header) const {
+  void CheckComplexTypeHeader(const pv_layout_headers::ComplexTypeHeader &complex_header, bool is_first_header) const {
     if (is_first_header && !(complex_header.value_state_ & pv_layout_headers::PVTypeState::kComplexBegin)) {
       // read complex types is only possible from the beggining of sequence
       throw exception::YASException("Read complex type error: kComplexBegin type expected",
@@ -137,7 +182,13 @@ class PVDeviceDataReaderWriter {
       throw exception::YASException("Read complex type error: kComplexSequel type expected",
           storage::StorageError::kCorruptedHeaderError);
     }
-    else if (complex_header.chunk_size_ > cluster_size_) {
+    else if ((complex_header.value_state_ & pv_layout_headers::PVTypeState::kExtent) &&
+        complex_header.chunk_size_ != complex_header.overall_size_) {
+      throw exception::YASException("Read complex type error: extent should contain the whole value",
+          storage::StorageError::kCorruptedHeaderError);
+    }
+    else if (!(complex_header.value_state_ & pv_layout_headers::PVTypeState::kExtent) &&
+        complex_header.chunk_size_ > cluster_size_) {
       throw exception::YASException("Read complex type error: chunk size is bigger than device cluster size",
           storage::StorageError::kCorruptedHeaderError);
     }
@@ -146,6 +197,21 @@ class PVDeviceDataReaderWriter {
           storage::StorageError::kCorruptedHeaderError);
     }
   }
+
+  void cluster_size(uint32_t cluster_size) { cluster_size_ = cluster_size; }
+
+#ifdef UNIT_TEST
+  Device& GetDevice() const { return device_; }
+#endif
+
+  PVDeviceDataReaderWriter(const PVDeviceDataReaderWriter&) = delete;
+  PVDeviceDataReaderWriter(PVDeviceDataReaderWriter&&) = default;
+  PVDeviceDataReaderWriter& operator=(const PVDeviceDataReaderWriter&) = delete;
+  PVDeviceDataReaderWriter& operator=(PVDeviceDataReaderWriter&&) = delete;
+
+ private:
+  Device device_;
+  uint32_t cluster_size_;
 };
 
 } // namespace pv
@@ -1,65 +1,124 @@
 #pragma once
 #include "PVDeviceDataReaderWriter.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <utility>
 
 namespace yas {
 namespace pv {
 
 using namespace pv_layout_headers;
 
+// describes how PV grows when there isn't any free entry for the allocation
+struct GrowthPolicy {
+  double extend_factor_ = 1.1;                  // each next expansion is bigger than the previous one by this factor
+  int32_t initial_extend_size_ = 5 * 0x1000;    // the size of the first expansion (rounded down to clusters)
+  // if it isn't zero, the device space is reserved ahead of the PV end: when less than low_water_mark_ bytes
+  // remain reserved, the reserve is refilled up to the doubled mark (f.e. by the background thread of PVManager)
+  uint64_t low_water_mark_ = 0;
+  // if it isn't zero, the free space at the PV end is given back to the device as soon as it reaches this size
+  // (f.e. cache-like PV drops back to its steady size after the spike of values has been deleted)
+  uint64_t shrink_threshold_ = 0;
+};
+
 template <typename OffsetType>
 class PVEntriesAllocator {
  public:
-  explicit PVEntriesAllocator(int32_t cluster_size)
-      : cluster_size_(cluster_size) {
-    simultaneously_allocated_clusters_ = std::max<int32_t>(maximum_simultaneously_extend_pv_size_/ cluster_size_, 1);
-    last_allocated_clusters_count_ = simultaneously_allocated_clusters_;
+  explicit PVEntriesAllocator(int32_t cluster_size) {
+    this->cluster_size(cluster_size);
   }
 
   ~PVEntriesAllocator() = default;
 
+  // returns the offset and the size of the new space, it is at least entry_size bytes long. The device reserves it
+  // without writing (f.e. by fallocate) and nothing is written there, the free space is tracked only in memory
   template<typename PVDeviceDataReaderWriterType>
-  OffsetType ExpandPV(PVDeviceDataReaderWriterType &data_reader_writer, OffsetType free_entry_offset) {
-    last_allocated_clusters_count_ *= extend_factor_;
-
-    const int64_t allocate_clusters_count = static_cast<int64_t>(last_allocated_clusters_count_);
-    ByteVector new_clusters(simultaneously_allocated_clusters_* cluster_size_, debug_filler);
-
-    ComplexTypeHeader header;
-    header.overall_size_ = cluster_size_ - serialization_utils::offset_of(&ComplexTypeHeader::data_);
-    header.chunk_size_ = cluster_size_ - serialization_utils::offset_of(&ComplexTypeHeader::data_);
-    header.value_type_ = PVType::kEmptyComplex;
-
-    for (int64_t written_clusters = 0; written_clusters < allocate_clusters_count; 
-        written_clusters += simultaneously_allocated_clusters_) {
-      auto current_cursor = std::begin(new_clusters);
-      const auto data_end = std::end(new_clusters);
-      for (int32_t new_cluster_id = 0; new_cluster_id < simultaneously_allocated_clusters_; ++new_cluster_id) {
-        header.next_free_entry_offset_ = free_entry_offset;
-        serialization_utils::SaveAsBytes(current_cursor, std::end(new_clusters), &header);
-        std::advance(current_cursor, cluster_size_);
-        free_entry_offset = offset_traits<OffsetType>::IsExistValue(free_entry_offset) ? 
-            free_entry_offset + cluster_size_ : device_end_;
-      }
-      device_end_ += data_reader_writer.RawWrite(device_end_, std::cbegin(new_clusters), std::cend(new_clusters));
+  std::pair<OffsetType, OffsetType> ExpandPV(PVDeviceDataReaderWriterType &data_reader_writer,
+      OffsetType entry_size) {
+    last_allocated_clusters_count_ *= growth_policy_.extend_factor_;
+    const auto allocate_clusters_count = std::max<int64_t>({ static_cast<int64_t>(last_allocated_clusters_count_), 1,
+        static_cast<int64_t>((entry_size + cluster_size_ - 1) / cluster_size_) });
+    const OffsetType expand_size = static_cast<OffsetType>(allocate_clusters_count * cluster_size_);
+
+    // the device grows only if the space hasn't been reserved ahead
+    if (device_end_ + expand_size > reserved_end_) {
+      data_reader_writer.Reserve(device_end_ + expand_size);
+      reserved_end_ = device_end_ + expand_size;
     }
 
-    return free_entry_offset;
+    const auto new_entry_offset = device_end_;
+    device_end_ += expand_size;
+    return { new_entry_offset, expand_size };
+  }
+
+  // the extent is placed right at the device end. The device reserves it like any expansion, so the caller writes
+  // only the used part of the extent (the rest is never touched until it is reused)
+  template<typename PVDeviceDataReaderWriterType>
+  OffsetType ReserveExtent(PVDeviceDataReaderWriterType &data_reader_writer, OffsetType extent_size) {
+    const auto extent_offset = device_end_;
+    if (device_end_ + extent_size > reserved_end_) {
+      data_reader_writer.Reserve(device_end_ + extent_size);
+      reserved_end_ = device_end_ + extent_size;
+    }
+    device_end_ += extent_size;
+    return extent_offset;
   }
 
+  // refills the device space reserved ahead of the PV end if it is below the low water mark of the policy
+  template<typename PVDeviceDataReaderWriterType>
+  void ReserveAhead(PVDeviceDataReaderWriterType &data_reader_writer) {
+    if (!IsReserveLow()) {
+      return;
+    }
+
+    const OffsetType reserved_end = device_end_ + static_cast<OffsetType>(growth_policy_.low_water_mark_ * 2);
+    data_reader_writer.Reserve(reserved_end);
+    reserved_end_ = reserved_end;
+  }
+
+  // gives the space after device_end (including the reserved one) back to the device, the next expansion starts
+  // from the initial size of the policy
+  template<typename PVDeviceDataReaderWriterType>
+  void Truncate(PVDeviceDataReaderWriterType &data_reader_writer, OffsetType device_end) {
+    data_reader_writer.Truncate(device_end);
+    device_end_ = device_end;
+    reserved_end_ = device_end;
+    last_allocated_clusters_count_ = growth_policy_.initial_extend_size_ / cluster_size_;
+  }
+
+  bool IsReserveLow() const {
+    return 0 != growth_policy_.low_water_mark_ && reserved_size() < growth_policy_.low_water_mark_;
+  }
+
+  OffsetType reserved_size() const {
+    return reserved_end_ > device_end_ ? reserved_end_ - device_end_ : 0;
+  }
+
+  void cluster_size(int32_t cluster_size) {
+    cluster_size_ = cluster_size;
+    this->growth_policy(growth_policy_);
+  }
+
+  // the next expansion starts from the initial size of the new policy
+  void growth_policy(const GrowthPolicy &growth_policy) {
+    growth_policy_.extend_factor_ = std::max(growth_policy.extend_factor_, 1.0);
+    growth_policy_.initial_extend_size_ = std::max(growth_policy.initial_extend_size_, cluster_size_);
+    growth_policy_.low_water_mark_ = growth_policy.low_water_mark_;
+    growth_policy_.shrink_threshold_ = growth_policy.shrink_threshold_;
+    last_allocated_clusters_count_ = growth_policy_.initial_extend_size_ / cluster_size_;
+  }
+
+  const GrowthPolicy &growth_policy() const { return growth_policy_; }
+
   void device_end(OffsetType device_end) { device_end_ = device_end;}
   OffsetType device_end() const { return device_end_; }
 
  private:
-  OffsetType device_end_;
+  OffsetType device_end_ = 0;
+  OffsetType reserved_end_ = 0;     // the device space after device_end_ is reserved up to this offset
   int32_t cluster_size_;
-  int32_t simultaneously_allocated_clusters_;
+  GrowthPolicy growth_policy_;
   double last_allocated_clusters_count_;
-
-  // TODO : for better heterogeneous devices support maximum_simultaneously_extend_pv_size_ should be
-  // taken from some static Device method
-  const int32_t maximum_simultaneously_extend_pv_size_ = 5 * 0x1000;
-  const ByteVector::value_type debug_filler = 0xAA;
-  const double extend_factor_ = 1.1;
 };
 
 } // namespace pv
@@ -4,10 +4,19 @@
 #include "FreelistHelper.hpp"
 #include "EntriesTypeConverter.hpp"
 #include "PVEntriesAllocator.hpp"
+#include "SlabAllocator.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
 #include <type_traits>
 #include <variant>
 #include <cstring>
 #include <optional>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 namespace yas {
 namespace pv {
@@ -19,16 +28,24 @@ using namespace yas::storage;
 template <typename OffsetType, typename Device>
 class PVEntriesManager {
   using FreelistHeaderType = pv_layout_headers::FreelistHeader<OffsetType>;
+  using FreeIndexHeaderType = pv_layout_headers::FreeIndexHeader<OffsetType>;
+  using FreelistHelperType = freelist_helper::FreelistHelper<OffsetType>;
   using PVPathType = typename Device::path_type;
  
  public:
+  // receives the entry content (or nothing if the entry is expired) or the exception that happened during read
+  using entry_content_callback_type = std::function<void(std::optional<storage_value_type>, std::exception_ptr)>;
+
   PVEntriesManager(const PVPathType &file_path, utils::Version version, int32_t priority = 0,
       int32_t cluster_size = kDefaultClusterSize)
       : data_reader_writer_(file_path, cluster_size),
         version_(version),
         priority_(priority),
         cluster_size_(cluster_size),
-        entries_allocator_(cluster_size) {
+        entries_allocator_(cluster_size),
+        slab_allocator_(cluster_size) {
+    entries_allocator_.device_end(sizeof(PVHeader) + sizeof(FreeIndexHeaderType));
+    freelist_helper_.limits(FreelistHelperType::DefaultLimits(cluster_size));
   }
 
   ~PVEntriesManager() = default;
@@ -50,26 +67,51 @@ class PVEntriesManager {
     }
 
     current_cursor += sizeof pv_header;
-    const FreelistHeaderType freelist_header = data_reader_writer_.template Read<FreelistHeaderType>(current_cursor);
-    freelist_helper_.SetBins(freelist_header);
+    CheckClusterSize(pv_header.cluster_size_);
     cluster_size_ = pv_header.cluster_size_;
+    data_reader_writer_.cluster_size(cluster_size_);
+    entries_allocator_.cluster_size(cluster_size_);
+    slab_allocator_.cluster_size(cluster_size_);
+    freelist_helper_.limits(FreelistHelperType::DefaultLimits(cluster_size_));
     priority_ = pv_header.priority_;
+    pv_version_ = pv_header.version_;
     entries_allocator_.device_end(pv_header.pv_size_);
+    saved_free_index_header_ = FreeIndexHeaderType{};
+    saved_free_index_.clear();
+
+    if (pv_header.version_ < kFreeIndexVersion) {
+      loadFreelists(data_reader_writer_.template Read<FreelistHeaderType>(current_cursor));
+    }
+    else {
+      loadFreeIndex(data_reader_writer_.template Read<FreeIndexHeaderType>(current_cursor));
+    }
 
     return pv_header.inverted_index_offset_;
   }
 
+  // PV is saved in the format of version_: before 1.4 free entries are linked in lists of bins (see saveFreelists),
+  // since 1.4 they are saved in the free space index (see saveFreeIndex)
   void SaveStartEntries(OffsetType index_offset) {
+    const bool has_free_index = !(version_ < kFreeIndexVersion);
+    const auto freelist_header = (has_free_index ? FreelistHeaderType{} : saveFreelists());
+    if (has_free_index) {
+      saveFreeIndex();
+    }
+
     PVHeader pv_header;
     pv_header.version_ = version_;
+    pv_version_ = pv_header.version_;
     pv_header.priority_ = priority_;
     pv_header.pv_size_ = entries_allocator_.device_end();
     pv_header.cluster_size_ = cluster_size_;
     pv_header.inverted_index_offset_ = index_offset;
     data_reader_writer_.template Write<PVHeader>(0, pv_header);
-    data_reader_writer_.template Write<FreelistHeaderType>(sizeof pv_header, freelist_helper_.GetBins());
-
-    entries_allocator_.device_end(sizeof pv_header + sizeof(FreelistHeaderType));
+    if (has_free_index) {
+      data_reader_writer_.template Write<FreeIndexHeaderType>(sizeof pv_header, saved_free_index_header_);
+    }
+    else {
+      data_reader_writer_.template Write<FreelistHeaderType>(sizeof pv_header, freelist_header);
+    }
   }
 
   OffsetType CreateNewEntryValue(const storage_value_type &value) {
@@ -92,54 +134,274 @@ class PVEntriesManager {
         [this](const ByteVector &value) { return createNewEntryValue(Blob_EntryType(value)); });
   }
 
+  // writes the blob as one extent whatever its size is, so its data is contiguous on the device and could be read in
+  // place (see GetExtentDataRange)
+  OffsetType CreateNewExtentEntry(const ByteVector &value) {
+    return writeExtentType(Blob_EntryType().pv_type_, std::cbegin(value), value.size());
+  }
+
+  // returns the offset and the size of the data of the entry placed in one extent, nothing for other entries
+  std::optional<std::pair<OffsetType, OffsetType>> GetExtentDataRange(OffsetType offset) {
+    const EntryHeader entry_header = getEntryHeader(offset);
+    const EntryType storage_type = EntriesTypeConverter::ConvertToEntryType(entry_header.pv_state_.value_type_);
+    const bool is_complex_type = std::visit([](auto &&value) {
+      return std::is_same_v<typename std::decay_t<decltype(value)>::HeaderType, ComplexTypeHeader>;
+    }, storage_type);
+    if (!is_complex_type) {
+      return std::nullopt;
+    }
+
+    const auto &header = entry_header.complex_type_header_;
+    data_reader_writer_.CheckComplexTypeHeader(header, true);
+    if (!(header.value_state_ & PVTypeState::kExtent)) {
+      return std::nullopt;
+    }
+    return std::make_pair(offset + serialization_utils::offset_of(&ComplexTypeHeader::data_),
+        static_cast<OffsetType>(header.overall_size_));
+  }
+
   storage_value_type GetEntryContent(OffsetType offset) {
-    const PVType entry_type = getEntryType(offset);
-    const EntryType storage_type = EntriesTypeConverter::ConvertToEntryType(entry_type);
-    return std::visit([this, offset](auto &&value) {
-        auto &&storage_result = getEntryContent<typename std::decay_t<decltype(value)>::HeaderType>(offset);
+    const EntryHeader entry_header = getEntryHeader(offset);
+    const EntryType storage_type = EntriesTypeConverter::ConvertToEntryType(entry_header.pv_state_.value_type_);
+    return std::visit([this, offset, &entry_header](auto &&value) {
+        using HeaderType = typename std::decay_t<decltype(value)>::HeaderType;
+        auto &&storage_result = getEntryContent(offset, getTypedHeader<HeaderType>(entry_header));
         return EntriesTypeConverter::ConvertToUserType(std::move(storage_result));
     }, storage_type);
   }
 
+  // reads the entry by chains of asynchronous device reads (the header, then the data of each complex type chunk
+  // together with the header of the next one), callback is called from the device completion thread. Note that
+  // entries shouldn't be changed until the callback is called.
+  void GetEntryContentAsync(OffsetType offset, entry_content_callback_type callback) noexcept {
+    std::shared_ptr<AsyncEntryReadState> state;
+    try {
+      state = std::make_shared<AsyncEntryReadState>();
+      state->callback_ = std::move(callback);
+      state->entry_offset_ = offset;
+      submitAsyncReads(state, { makeHeaderRead(state, offset,
+          [this](const std::shared_ptr<AsyncEntryReadState> &read_state) { onEntryHeaderReaded(read_state); }) });
+    }
+    catch (...) {
+      state ? finishAsyncRead(state, {}, std::current_exception()) : callback({}, std::current_exception());
+    }
+  }
+
   void DeleteEntry(OffsetType offset) {
-    const PVType pv_type = getEntryType(offset);
-    const EntryType storage_type = EntriesTypeConverter::ConvertToEntryType(pv_type);
-    std::visit([this, offset](auto &&value) {
-      return deleteEntry<typename std::decay_t<decltype(value)>::HeaderType>(offset);
+    const EntryHeader entry_header = getEntryHeader(offset);
+    const EntryType storage_type = EntriesTypeConverter::ConvertToEntryType(entry_header.pv_state_.value_type_);
+    std::visit([this, offset, &entry_header](auto &&value) {
+      using HeaderType = typename std::decay_t<decltype(value)>::HeaderType;
+      return deleteEntry(offset, getTypedHeader<HeaderType>(entry_header));
     }, storage_type);
+
+    const auto shrink_threshold = entries_allocator_.growth_policy().shrink_threshold_;
+    if (0 != shrink_threshold &&
+        freelist_helper_.GetTailFreeSize(entries_allocator_.device_end()) >= shrink_threshold) {
+      ReleaseTailSpace();
+    }
   }
 
   std::optional<utils::Time> GetEntryExpiredDate(OffsetType offset) {
-    const PVType pv_type = getEntryType(offset);
-    const EntryType storage_type = EntriesTypeConverter::ConvertToEntryType(pv_type);
-    return std::visit([this, offset](auto &&value) {
-      return getEntryExpiredDate<typename std::decay_t<decltype(value)>::HeaderType>(offset);
+    const EntryHeader entry_header = getEntryHeader(offset);
+    const EntryType storage_type = EntriesTypeConverter::ConvertToEntryType(entry_header.pv_state_.value_type_);
+    return std::visit([&entry_header](auto &&value) {
+      using HeaderType = typename std::decay_t<decltype(value)>::HeaderType;
+      return getEntryExpiredDate(getTypedHeader<HeaderType>(entry_header));
     }, storage_type);
   }
 
   void SetEntryExpiredDate(OffsetType offset, const utils::Time &expired_date) {
-    const PVType pv_type = getEntryType(offset);
-    const EntryType storage_type = EntriesTypeConverter::ConvertToEntryType(pv_type);
-    std::visit([this, offset, &expired_date](auto &&value) {
-      return setEntryExpiredDate<typename std::decay_t<decltype(value)>::HeaderType>(offset, expired_date);
+    const EntryHeader entry_header = getEntryHeader(offset);
+    const EntryType storage_type = EntriesTypeConverter::ConvertToEntryType(entry_header.pv_state_.value_type_);
+    std::visit([this, offset, &entry_header, &expired_date](auto &&value) {
+      using HeaderType = typename std::decay_t<decltype(value)>::HeaderType;
+      return setEntryExpiredDate(offset, getTypedHeader<HeaderType>(entry_header), expired_date);
     }, storage_type);
   }
 
   int32_t priority() const { return priority_; }
 
+  const GrowthPolicy &growth_policy() const { return entries_allocator_.growth_policy(); }
+  void growth_policy(const GrowthPolicy &growth_policy) { entries_allocator_.growth_policy(growth_policy); }
+
+  // refills the device space reserved ahead of the PV end, so allocations don't have to grow the device
+  void ReserveAhead() {
+    entries_allocator_.ReserveAhead(data_reader_writer_);
+  }
+
+  bool IsReserveLow() const {
+    return entries_allocator_.IsReserveLow();
+  }
+
+  // limits of freelist bins are saved in PV, free entries are moved to the new bins right away
+  const typename FreelistHelperType::limits_type &freelist_limits() const { return freelist_helper_.limits(); }
+  void freelist_limits(const typename FreelistHelperType::limits_type &limits) { freelist_helper_.limits(limits); }
+
+  // returns the size of the first chunk of the entry as it has been taken from the free space
+  OffsetType GetEntrySize(OffsetType offset) {
+    const EntryHeader entry_header = getEntryHeader(offset);
+    const EntryType storage_type = EntriesTypeConverter::ConvertToEntryType(entry_header.pv_state_.value_type_);
+    return std::visit([this, &entry_header](auto &&value) -> OffsetType {
+      using HeaderType = typename std::decay_t<decltype(value)>::HeaderType;
+      if constexpr(std::is_same_v<HeaderType, ComplexTypeHeader>) {
+        const auto &header = entry_header.complex_type_header_;
+        if (header.value_state_ & PVTypeState::kExtent) {
+          return getExtentSize(header.overall_size_);
+        }
+        const auto data_offset = serialization_utils::offset_of(&ComplexTypeHeader::data_);
+        const OffsetType header_tail_size = sizeof(ComplexTypeHeader) - data_offset;
+        return data_offset + std::max<OffsetType>(header.chunk_size_, header_tail_size);
+      }
+      else {
+        return sizeof(HeaderType);
+      }
+    }, storage_type);
+  }
+
+  // moves the entry (each chunk of the chain separately) to the lowest free space before it, returns the new offset
+  // of the entry or the same one if it hasn't been moved. Small entries are moved to lower slabs in the slab mode.
+  // Old places of moved chunks are kept until FreeMovedEntries (the saved index could refer to them)
+  OffsetType MoveEntryLower(OffsetType offset) {
+    const EntryHeader entry_header = getEntryHeader(offset);
+    const EntryType storage_type = EntriesTypeConverter::ConvertToEntryType(entry_header.pv_state_.value_type_);
+    return std::visit([this, offset, &entry_header](auto &&value) -> OffsetType {
+      using HeaderType = typename std::decay_t<decltype(value)>::HeaderType;
+      if constexpr(std::is_same_v<HeaderType, Simple4TypeHeader>) {
+        return moveEntryChunk(offset, sizeof(HeaderType), PVType::kEmpty4Simple);
+      }
+      else if constexpr(std::is_same_v<HeaderType, Simple8TypeHeader>) {
+        return moveEntryChunk(offset, sizeof(HeaderType), PVType::kEmpty8Simple);
+      }
+      else {
+        return moveComplexEntry(offset, entry_header.complex_type_header_);
+      }
+    }, storage_type);
+  }
+
+  // frees old places of entries moved by MoveEntryLower, it should be called only after the header refers to the
+  // index with their new places
+  void FreeMovedEntries() {
+    for (const auto &[offset, chunk_size, free_type] : moved_chunks_) {
+      markFreeEntry(offset, free_type);
+      freeEntry(offset, chunk_size);
+    }
+    moved_chunks_.clear();
+  }
+
+  bool HasMovedEntries() const noexcept { return !moved_chunks_.empty(); }
+
+  // gives the free space at the PV end back to the device (the new end keeps the cluster alignment of the PV),
+  // returns the count of released bytes
+  OffsetType ReleaseTailSpace() {
+    const OffsetType device_end = entries_allocator_.device_end();
+    const auto [tail_offset, tail_size] = freelist_helper_.PopTailFreeEntry(device_end);
+    if (!offset_traits<OffsetType>::IsExistValue(tail_offset)) {
+      return 0;
+    }
+
+    const OffsetType start_entries_size = sizeof(PVHeader) + sizeof(FreeIndexHeaderType);
+    const OffsetType unit_size = getAllocationUnitSize();
+    const OffsetType new_device_end = start_entries_size +
+        (tail_offset - start_entries_size + unit_size - 1) / unit_size * unit_size;
+    if (new_device_end >= device_end) {
+      freelist_helper_.PushFreeEntry(tail_offset, tail_size);
+      return 0;
+    }
+
+    freelist_helper_.PushFreeEntry(tail_offset, new_device_end - tail_offset);
+    entries_allocator_.Truncate(data_reader_writer_, new_device_end);
+    return device_end - new_device_end;
+  }
+
+  freelist_helper::FitPolicy fit_policy() const { return freelist_helper_.fit_policy(); }
+  void fit_policy(freelist_helper::FitPolicy fit_policy) { freelist_helper_.fit_policy(fit_policy); }
+
+  // in the slab mode small entries are placed in clusters dedicated to their size class (see SlabAllocator). The
+  // mode is saved in PV (since 1.4, it throws YASException for older versions), switching it off moves free slots
+  // of all slabs (and the rest of used slots after their entries) to the free space index
+  bool slab_mode() const { return is_slab_mode_; }
+  void slab_mode(bool is_slab_mode) {
+    if (is_slab_mode && version_ < kFreeIndexVersion) {
+      throw exception::YASException("The slab mode isn't supported by the PV version",
+          StorageError::kPVVersionUnsupported);
+    }
+    if (!is_slab_mode) {
+      // used slots become usual entries freed by their own size, so the rest of each slot after the entry is freed
+      // now (it costs a header read per slot)
+      for (const auto &[slot_offset, slot_size] : slab_allocator_.GetUsedSlots()) {
+        const auto entry_size = GetEntrySize(slot_offset);
+        if (entry_size < slot_size) {
+          freelist_helper_.PushFreeEntry(slot_offset + entry_size, slot_size - entry_size);
+        }
+      }
+      for (const auto &[slot_offset, slot_size] : slab_allocator_.ReleaseAll()) {
+        freelist_helper_.PushFreeEntry(slot_offset, slot_size);
+      }
+    }
+    is_slab_mode_ = is_slab_mode;
+  }
+
+  // the version of the loaded (or the last saved) PV header, the format of the saved index depends on it
+  utils::Version pv_version() const noexcept { return pv_version_; }
+
+  int32_t cluster_size() const noexcept { return cluster_size_; }
+
+  static void CheckClusterSize(int32_t cluster_size) {
+    if (cluster_size < static_cast<int32_t>(kMinimumClusterSize) ||
+        cluster_size > static_cast<int32_t>(kMaximumClusterSize)) {
+      throw exception::YASException("Invalid PV cluster size: " + std::to_string(cluster_size),
+          StorageError::kInvalidClusterSize);
+    }
+  }
+
  private:
   using EntryHeaderStorage = std::aligned_union<0, PVState, Simple4TypeHeader, Simple8TypeHeader, ComplexTypeHeader>;
-  STRUCT_PACK(union alignas(EntryHeaderStorage) EntryHeader {
+  // ComplexTypeHeader has default member initializers, so the union needs its own ctor. The union isn't packed: its
+  // members are packed already, and the packing of the union is ignored for non-POD members anyway
+  union alignas(EntryHeaderStorage) EntryHeader {
+    EntryHeader() noexcept : pv_state_() {}
+
     PVState pv_state_;
     Simple4TypeHeader simple4_type_header_;
     Simple8TypeHeader simple8_type_header_;
     ComplexTypeHeader complex_type_header_;
-  });
+  };
+  static_assert(sizeof(EntryHeader) == sizeof(ComplexTypeHeader), "EntryHeader should be as big as the biggest header");
    
+  // the state of one asynchronous entry read shared between its device reads
+  struct AsyncEntryReadState {
+    EntryHeader header_;
+    ByteVector data_;
+    PVType value_type_ = PVType::kEmpty4Simple;
+    OffsetType entry_offset_ = 0;
+    OffsetType chunk_offset_ = 0;
+    OffsetType readed_size_ = 0;
+    std::atomic<int32_t> pending_reads_count_ = 0;
+    std::atomic<bool> is_failed_ = false;
+    entry_content_callback_type callback_;
+  };
+  using AsyncEntryReadStep = std::function<void(const std::shared_ptr<AsyncEntryReadState>&)>;
+
+  // the first version that places big values in extents
+  static constexpr utils::Version kExtentVersion = utils::Version(1, 3);
+  // the first version that keeps free entries in the serialized index instead of linked lists
+  static constexpr utils::Version kFreeIndexVersion = utils::Version(1, 4);
+  // each free entry takes two varints, so the allocation of the index region changes the index by a few entries
+  static constexpr OffsetType kFreeIndexSlack = 0x80;
+
   PVDeviceDataReaderWriter<OffsetType, Device> data_reader_writer_;
-  freelist_helper::FreelistHelper<OffsetType> freelist_helper_;
+  FreelistHelperType freelist_helper_;
   PVEntriesAllocator<OffsetType> entries_allocator_;
+  slab_allocator::SlabAllocator<OffsetType> slab_allocator_;
+  bool is_slab_mode_ = false;
   utils::Version version_;    // there could be some parsing issues depends on version
+  utils::Version pv_version_;
+  // the free space index referred by the header on the device (see SaveStartEntries)
+  FreeIndexHeaderType saved_free_index_header_{};
+  ByteVector saved_free_index_;
+  // old places of moved chunks (the offset, the size and the type of the free entry), see FreeMovedEntries
+  std::vector<std::tuple<OffsetType, OffsetType, PVType>> moved_chunks_;
   int32_t cluster_size_;
   int32_t priority_;
 
@@ -161,10 +423,9 @@ class PVEntriesManager {
   }
 
   template<typename HeaderType>
-  EntryType getEntryContent(OffsetType offset) {
-    HeaderType header = data_reader_writer_.template Read<HeaderType>(offset);
+  EntryType getEntryContent(OffsetType offset, const HeaderType &header) {
     if constexpr(std::is_same_v<HeaderType, ComplexTypeHeader>) {
-      auto &&data = data_reader_writer_.ReadComplexType(offset);
+      auto &&data = data_reader_writer_.ReadComplexType(offset, header);
       return EntriesTypeConverter::ConvertToEntryType<ByteVector>(header.value_type_, std::move(data));
     }
     else {
@@ -174,185 +435,642 @@ class PVEntriesManager {
   }
 
   template<typename HeaderType>
-  std::optional<utils::Time> getEntryExpiredDate(OffsetType offset) {
-    HeaderType header = data_reader_writer_.template Read<HeaderType>(offset);
+  static std::optional<utils::Time> getEntryExpiredDate(const HeaderType &header) {
     if (!(header.value_state_ & PVTypeState::kIsExpired)) {
       return {};
     }
     return utils::Time(header.expired_time_low_, header.expired_time_high_);
   }
 
+  // freed entries are only marked on the device (to catch reads by stale offsets), the free space itself is
+  // tracked by freelist_helper_
   template<typename HeaderType>
-  void deleteEntry(OffsetType offset) {
-    HeaderType header = data_reader_writer_.template Read<HeaderType>(offset);
+  void deleteEntry(OffsetType offset, HeaderType header) {
     if constexpr(!std::is_same_v<HeaderType, ComplexTypeHeader>) {
-      header.value_type_ = (sizeof header == sizeof(Simple4TypeHeader) ? PVType::kEmpty4Simple : PVType::kEmpty8Simple);
-      header.value_state_ = PVTypeState::kEmpty;
-      header.next_free_entry_offset_ = freelist_helper_.GetFreeEntry(sizeof header);
-      data_reader_writer_.template Write<HeaderType>(offset, header);
-      freelist_helper_.PushFreeEntry(offset, sizeof header);
+      markFreeEntry(offset, sizeof header == sizeof(Simple4TypeHeader) ? PVType::kEmpty4Simple : PVType::kEmpty8Simple);
+      freeEntry(offset, sizeof header);
       return;
     }
+    else if (header.value_state_ & PVTypeState::kExtent) {
+      // the whole extent is freed as one entry
+      markFreeEntry(offset, PVType::kEmptyComplex);
+      freeEntry(offset, getExtentSize(header.overall_size_));
+    }
     else {
+      const auto data_offset = serialization_utils::offset_of(&ComplexTypeHeader::data_);
+      const OffsetType header_tail_size = sizeof(ComplexTypeHeader) - data_offset;
       const auto overall_size = header.overall_size_;
-      auto next_entry_offset = header.sequel_offset_;
-
-      header.value_type_ = PVType::kEmptyComplex;
-      header.value_state_ = PVTypeState::kComplexBegin;
-      header.overall_size_ = header.chunk_size_;
-      header.next_free_entry_offset_ = freelist_helper_.GetFreeEntry(header.chunk_size_);
-      data_reader_writer_.template Write<ComplexTypeHeader>(offset, header);
-      freelist_helper_.PushFreeEntry(offset, header.chunk_size_ + 
-          serialization_utils::offset_of(&ComplexTypeHeader::data_));
-
-      auto already_deleted = header.chunk_size_;
-      while (already_deleted < overall_size && offset_traits<OffsetType>::IsExistValue(next_entry_offset)) {
-        const auto saved_next_entry_offset = next_entry_offset;
-        header = data_reader_writer_.template Read<ComplexTypeHeader>(next_entry_offset);
-
-        next_entry_offset = header.sequel_offset_;
-        header.value_type_ = PVType::kEmptyComplex;
-        header.value_state_ = PVTypeState::kComplexBegin;
-        header.overall_size_ = header.chunk_size_;
-        header.next_free_entry_offset_ = freelist_helper_.GetFreeEntry(header.chunk_size_);
-        data_reader_writer_.template Write<ComplexTypeHeader>(saved_next_entry_offset, header);
-        freelist_helper_.PushFreeEntry(saved_next_entry_offset, header.chunk_size_
-            + serialization_utils::offset_of(&ComplexTypeHeader::data_));
+      OffsetType already_deleted = 0;
+      while (true) {
+        markFreeEntry(offset, PVType::kEmptyComplex);
+        freeEntry(offset, data_offset + std::max<OffsetType>(header.chunk_size_, header_tail_size));
         already_deleted += header.chunk_size_;
-        return;
+        if (already_deleted >= overall_size || 0 == header.chunk_size_ ||
+            !offset_traits<OffsetType>::IsExistValue(header.sequel_offset_)) {
+          break;
+        }
+
+        offset = header.sequel_offset_;
+        header = data_reader_writer_.template Read<ComplexTypeHeader>(offset);
+        if (!(header.value_state_ & PVTypeState::kComplexSequel)) {
+          throw exception::YASException("Delete complex type error: kComplexSequel type expected",
+              StorageError::kCorruptedHeaderError);
+        }
+      }
+    }
+  }
+
+  // the entry goes back to its slab (the slab is freed entirely when it becomes empty) or to the free space index
+  void freeEntry(OffsetType offset, OffsetType entry_size) {
+    if (!slab_allocator_.HasSlot(offset)) {
+      freelist_helper_.PushFreeEntry(offset, entry_size);
+      return;
+    }
+
+    const auto empty_slab_offset = slab_allocator_.FreeSlot(offset);
+    if (offset_traits<OffsetType>::IsExistValue(empty_slab_offset)) {
+      freelist_helper_.PushFreeEntry(empty_slab_offset, slab_allocator_.slab_size());
+    }
+  }
+
+  OffsetType moveComplexEntry(OffsetType offset, const ComplexTypeHeader &header) {
+    if (header.value_state_ & PVTypeState::kExtent) {
+      return moveEntryChunk(offset, getExtentSize(header.overall_size_), PVType::kEmptyComplex);
+    }
+
+    // each moved chunk of the chain is linked from the previous one
+    const auto data_offset = serialization_utils::offset_of(&ComplexTypeHeader::data_);
+    const OffsetType header_tail_size = sizeof(ComplexTypeHeader) - data_offset;
+    const auto overall_size = header.overall_size_;
+    const auto entry_offset = moveEntryChunk(offset, data_offset + std::max<OffsetType>(header.chunk_size_,
+        header_tail_size), PVType::kEmptyComplex);
+    auto previous_offset = entry_offset;
+    auto previous_header = header;
+    OffsetType already_moved = header.chunk_size_;
+    while (already_moved < overall_size && 0 != previous_header.chunk_size_ &&
+        offset_traits<OffsetType>::IsExistValue(previous_header.sequel_offset_)) {
+      offset = previous_header.sequel_offset_;
+      const auto chunk_header = data_reader_writer_.template Read<ComplexTypeHeader>(offset);
+      if (!(chunk_header.value_state_ & PVTypeState::kComplexSequel)) {
+        throw exception::YASException("Move complex type error: kComplexSequel type expected",
+            StorageError::kCorruptedHeaderError);
+      }
+
+      const auto chunk_offset = moveEntryChunk(offset, data_offset + std::max<OffsetType>(chunk_header.chunk_size_,
+          header_tail_size), PVType::kEmptyComplex);
+      if (chunk_offset != offset) {
+        previous_header.sequel_offset_ = chunk_offset;
+        data_reader_writer_.template Write<ComplexTypeHeader>(previous_offset, previous_header);
       }
+      previous_offset = chunk_offset;
+      previous_header = chunk_header;
+      already_moved += chunk_header.chunk_size_;
     }
+    return entry_offset;
+  }
+
+  // the chunk is copied as it is (it doesn't keep its own offset), the old place becomes free by FreeMovedEntries
+  OffsetType moveEntryChunk(OffsetType offset, OffsetType chunk_size, PVType free_type) {
+    const auto class_id = (is_slab_mode_ ? slab_allocator_.GetClassId(chunk_size) : slab_allocator::kSlabClassCount);
+    auto new_offset = offset_traits<OffsetType>::NonExistValue();
+    if (class_id < slab_allocator::kSlabClassCount) {
+      new_offset = slab_allocator_.PopLowerFreeSlot(class_id, offset);
+      if (!offset_traits<OffsetType>::IsExistValue(new_offset)) {
+        const auto slab_size = slab_allocator_.slab_size();
+        const auto [free_offset, free_size] = freelist_helper_.PopLowerFreeEntry(slab_size, offset);
+        if (offset_traits<OffsetType>::IsExistValue(free_offset)) {
+          freelist_helper_.PushFreeEntry(free_offset + slab_size, free_size - slab_size);
+          new_offset = slab_allocator_.AddSlab(free_offset, class_id);
+        }
+      }
+    }
+    else {
+      const auto [free_offset, free_size] = freelist_helper_.PopLowerFreeEntry(chunk_size, offset);
+      if (offset_traits<OffsetType>::IsExistValue(free_offset)) {
+        freelist_helper_.PushFreeEntry(free_offset + chunk_size, free_size - chunk_size);
+        new_offset = free_offset;
+      }
+    }
+
+    if (!offset_traits<OffsetType>::IsExistValue(new_offset)) {
+      return offset;
+    }
+    const auto chunk = data_reader_writer_.RawRead(offset, chunk_size);
+    data_reader_writer_.RawWrite(new_offset, std::cbegin(chunk), std::cend(chunk));
+    moved_chunks_.emplace_back(offset, chunk_size, free_type);
+    return new_offset;
+  }
+
+  void markFreeEntry(OffsetType offset, PVType free_type) {
+    PVState state;
+    state.value_type_ = free_type;
+    state.value_state_ = PVTypeState::kEmpty;
+    data_reader_writer_.template Write<PVState>(offset, state);
   }
 
   template<typename HeaderType>
-  void setEntryExpiredDate(OffsetType offset, const utils::Time &expired_date) {
-    HeaderType header = data_reader_writer_.template Read<HeaderType>(offset);
-    header.value_type_ = header.value_type_;
-    header.value_state_ = PVTypeState::kIsExpired;
+  void setEntryExpiredDate(OffsetType offset, HeaderType header, const utils::Time &expired_date) {
+    // the other state flags (f.e. the beginning of the complex type) are kept
+    header.value_state_ |= PVTypeState::kIsExpired;
     header.expired_time_high_ = expired_date.expired_time_high();
     header.expired_time_low_ = expired_date.expired_time_low();
     data_reader_writer_.template Write<HeaderType>(offset, header);
   }
 
-  PVType getEntryType(OffsetType offset) {
-    // In version 1.3 it is good to optimize read operations count by add std::aligned_union<headers...>
-    // It gives us with a possibility to read this union in this method and decrease by one read operations.
-    // But because of read/write cache in most devices there aren't any important performance issues at the moment.
-    // Also it is important to add checks that (readed_offset + sizeof(union)) < device_end
-    const auto pv_state = data_reader_writer_.template Read<PVState>(offset);
-    return pv_state.value_type_;
+  template<typename HeaderType>
+  static const HeaderType &getTypedHeader(const EntryHeader &entry_header) {
+    if constexpr(std::is_same_v<HeaderType, Simple4TypeHeader>) {
+      return entry_header.simple4_type_header_;
+    }
+    else if constexpr(std::is_same_v<HeaderType, Simple8TypeHeader>) {
+      return entry_header.simple8_type_header_;
+    }
+    else {
+      return entry_header.complex_type_header_;
+    }
+  }
+
+  template<typename HeaderType>
+  static bool isHeaderExpired(const HeaderType &header) {
+    return (header.value_state_ & PVTypeState::kIsExpired) &&
+        utils::Time(header.expired_time_low_, header.expired_time_high_).IsExpired();
+  }
+
+  // the header is read by the one request, but it shouldn't cross the device end (the last entry could be small)
+  template<typename AsyncDevice = Device>
+  typename AsyncDevice::AsyncRead makeHeaderRead(const std::shared_ptr<AsyncEntryReadState> &state, OffsetType offset,
+      AsyncEntryReadStep next_step) {
+    const OffsetType device_end = entries_allocator_.device_end();
+    if (offset >= device_end) {
+      throw exception::YASException("Async entry read error: entry offset is out of the device",
+          StorageError::kCorruptedHeaderError);
+    }
+
+    state->header_ = EntryHeader();
+    const auto header_size = std::min<OffsetType>(sizeof(EntryHeader), device_end - offset);
+    return makeAsyncRead(state, offset, serialization_utils::AsBytes(&state->header_).begin(),
+        static_cast<uint32_t>(header_size), std::move(next_step));
+  }
+
+  // next_step is called when all reads of the current batch have been completed
+  template<typename AsyncDevice = Device>
+  typename AsyncDevice::AsyncRead makeAsyncRead(const std::shared_ptr<AsyncEntryReadState> &state, OffsetType offset,
+      uint8_t *data, uint32_t size, AsyncEntryReadStep next_step) {
+    return { offset, data, size, [this, state, next_step](bool is_success) {
+      if (!is_success) {
+        state->is_failed_ = true;
+      }
+      if (0 != --state->pending_reads_count_) {
+        return;
+      }
+
+      if (state->is_failed_) {
+        finishAsyncRead(state, {}, std::make_exception_ptr(exception::YASException(
+            "Async entry read error: something bad happened during device read", StorageError::kDeviceReadError)));
+        return;
+      }
+      next_step(state);
+    }};
+  }
+
+  template<typename AsyncDevice = Device>
+  void submitAsyncReads(const std::shared_ptr<AsyncEntryReadState> &state,
+      std::vector<typename AsyncDevice::AsyncRead> reads) {
+    state->pending_reads_count_ = static_cast<int32_t>(reads.size());
+    data_reader_writer_.SubmitReads(std::move(reads));
+  }
+
+  void finishAsyncRead(const std::shared_ptr<AsyncEntryReadState> &state, std::optional<storage_value_type> value,
+      std::exception_ptr exception) noexcept {
+    try {
+      state->callback_(std::move(value), exception);
+    }
+    catch (...) {
+      // there isn't anybody to report it from the completion thread
+    }
+  }
+
+  void onEntryHeaderReaded(const std::shared_ptr<AsyncEntryReadState> &state) noexcept {
+    std::optional<storage_value_type> value;
+    try {
+      const auto entry_type = state->header_.pv_state_.value_type_;
+      const EntryType storage_type = EntriesTypeConverter::ConvertToEntryType(entry_type);
+      const bool is_finished = std::visit([this, &state, &value](auto &&storage_value) {
+        using HeaderType = typename std::decay_t<decltype(storage_value)>::HeaderType;
+        const auto &header = getTypedHeader<HeaderType>(state->header_);
+        if (isHeaderExpired(header)) {
+          return true;
+        }
+
+        if constexpr(std::is_same_v<HeaderType, ComplexTypeHeader>) {
+          data_reader_writer_.CheckComplexTypeHeader(header, true);
+          state->value_type_ = header.value_type_;
+          state->data_.resize(header.overall_size_);
+          return false;
+        }
+        else {
+          const auto aligned_value = header.value_;
+          value = EntriesTypeConverter::ConvertToUserType(
+              EntriesTypeConverter::ConvertToEntryType(header.value_type_, aligned_value));
+          return true;
+        }
+      }, storage_type);
+
+      if (!is_finished) {
+        state->chunk_offset_ = state->entry_offset_;
+        submitComplexChunkReads(state, state->header_.complex_type_header_);
+        return;
+      }
+    }
+    catch (...) {
+      finishAsyncRead(state, {}, std::current_exception());
+      return;
+    }
+
+    finishAsyncRead(state, std::move(value), nullptr);
+  }
+
+  // submits the data of the current chunk together with the header of the next one (if it is needed) in one batch
+  void submitComplexChunkReads(const std::shared_ptr<AsyncEntryReadState> &state, const ComplexTypeHeader &header) {
+    const OffsetType remain_size = state->data_.size() - state->readed_size_;
+    if (0 == header.chunk_size_ || header.chunk_size_ > remain_size) {
+      throw exception::YASException("Async entry read error: invalid complex type chunk size",
+          StorageError::kCorruptedHeaderError);
+    }
+
+    const auto on_chunk_readed = [this](const std::shared_ptr<AsyncEntryReadState> &read_state) {
+      onComplexChunkReaded(read_state);
+    };
+    const auto data_offset = state->chunk_offset_ + serialization_utils::offset_of(&ComplexTypeHeader::data_);
+    std::vector<typename Device::AsyncRead> reads;
+    reads.push_back(makeAsyncRead(state, data_offset, state->data_.data() + state->readed_size_,
+        static_cast<uint32_t>(header.chunk_size_), on_chunk_readed));
+
+    state->readed_size_ += header.chunk_size_;
+    if (state->readed_size_ < state->data_.size()) {
+      state->chunk_offset_ = header.sequel_offset_;
+      reads.push_back(makeHeaderRead(state, state->chunk_offset_, on_chunk_readed));
+    }
+    submitAsyncReads(state, std::move(reads));
   }
 
+  void onComplexChunkReaded(const std::shared_ptr<AsyncEntryReadState> &state) noexcept {
+    std::optional<storage_value_type> value;
+    try {
+      if (state->readed_size_ < state->data_.size()) {
+        const auto header = state->header_.complex_type_header_;
+        data_reader_writer_.CheckComplexTypeHeader(header, false);
+        submitComplexChunkReads(state, header);
+        return;
+      }
+
+      value = EntriesTypeConverter::ConvertToUserType(
+          EntriesTypeConverter::ConvertToEntryType<ByteVector>(state->value_type_, std::move(state->data_)));
+    }
+    catch (...) {
+      finishAsyncRead(state, {}, std::current_exception());
+      return;
+    }
+
+    finishAsyncRead(state, std::move(value), nullptr);
+  }
+
+  // the type and the header of the entry are decoded from the one read of the biggest header, but the read
+  // shouldn't cross the device end (the last entry could be smaller than the biggest header)
   EntryHeader getEntryHeader(OffsetType offset) {
-    return data_reader_writer_.template Read<EntryHeader>(offset);
+    const OffsetType device_end = entries_allocator_.device_end();
+    if (offset >= device_end) {
+      throw exception::YASException("Entry header read error: entry offset is out of the device",
+          StorageError::kCorruptedHeaderError);
+    }
+
+    return data_reader_writer_.template Read<EntryHeader>(offset,
+        std::min<OffsetType>(sizeof(EntryHeader), device_end - offset));
   }
 
+  // all chunks are allocated at first, so the whole chain is written by the one vectored write. Big values are
+  // placed in one extent instead of the chain
   template<typename Iterator>
   OffsetType writeComplexType(PVType value_type, const Iterator begin, const Iterator end) {
     const OffsetType data_size = std::distance(begin, end);
-    auto free_offset = getFreeEntryOffset(data_size + sizeof(ComplexTypeHeader));
-    auto first_free_offset = free_offset;
+    if (data_size > kExtentThreshold && !(version_ < kExtentVersion)) {
+      return writeExtentType(value_type, begin, data_size);
+    }
+
+    // chunks are placed one after another in each allocated entry, so the chain from one big free entry is
+    // contiguous and its headers are written only once by the vectored write. Chunks of the chain shouldn't be
+    // bigger than the cluster even if the free entry is bigger (f.e. freed extent) and each of them should fit the
+    // whole header (it is written entirely when the chunk is freed)
+    const auto data_offset = serialization_utils::offset_of(&ComplexTypeHeader::data_);
+    const OffsetType chunk_limit = cluster_size_ - data_offset;
+    const OffsetType header_tail_size = sizeof(ComplexTypeHeader) - data_offset;
 
-    bool is_first = true;
-    OffsetType written = 0;
+    std::vector<std::pair<OffsetType, ComplexTypeHeader>> chunks;
     OffsetType overall_written = 0;
-    while (overall_written < data_size) {
-      auto new_begin = begin;
-      std::advance(new_begin, overall_written);
-      auto next_free_offset = getFreeEntryOffset(data_size - overall_written + sizeof(ComplexTypeHeader));
-      written = data_reader_writer_.WriteComplexType(free_offset, value_type, is_first, next_free_offset,
-          new_begin, end);
-      is_first = false;
+    // small values take one slot in the slab mode
+    const OffsetType slot_entry_size = data_offset + std::max(data_size, header_tail_size);
+    if (is_slab_mode_ && slab_allocator_.GetClassId(slot_entry_size) < slab_allocator::kSlabClassCount) {
+      ComplexTypeHeader header;
+      header.value_type_ = value_type;
+      header.value_state_ = PVTypeState::kComplexBegin;
+      header.overall_size_ = data_size;
+      header.chunk_size_ = data_size;
+      chunks.emplace_back(getFreeEntryOffset(slot_entry_size), header);
+      overall_written = data_size;
+    }
+
+    while (overall_written < data_size || chunks.empty()) {
+      // the whole rest of the chain is requested at once, but any free entry that fits the next chunk is suitable
+      const OffsetType remain_size = data_size - overall_written;
+      const OffsetType chunks_count = std::max<OffsetType>((remain_size + chunk_limit - 1) / chunk_limit, 1);
+      const OffsetType last_chunk_size = remain_size - (chunks_count - 1) * chunk_limit;
+      const auto [entry_offset, entry_size] = getFreeEntry(
+          (chunks_count - 1) * cluster_size_ + data_offset + std::max(last_chunk_size, header_tail_size),
+          data_offset + std::max(std::min(remain_size, chunk_limit), header_tail_size));
+
+      const auto entry_end = entry_offset + entry_size;
+      auto chunk_offset = entry_offset;
+      while ((overall_written < data_size || chunks.empty()) && chunk_offset + sizeof(ComplexTypeHeader) <= entry_end) {
+        ComplexTypeHeader header;
+        header.value_type_ = value_type;
+        header.value_state_ = (chunks.empty() ? PVTypeState::kComplexBegin : PVTypeState::kComplexSequel);
+        header.overall_size_ = data_size;
+        header.chunk_size_ = std::min<OffsetType>({ data_size - overall_written, chunk_limit,
+            entry_end - chunk_offset - data_offset });
+        if (!chunks.empty()) {
+          chunks.back().second.sequel_offset_ = chunk_offset;
+        }
+        chunks.emplace_back(chunk_offset, header);
+
+        overall_written += header.chunk_size_;
+        chunk_offset += data_offset + std::max(header.chunk_size_, header_tail_size);
+      }
 
-      free_offset = next_free_offset;
-      overall_written += written;
+      // the tail of the partially used free entry could be too small for a chunk, but it is still a free entry
+      if (entry_end > chunk_offset) {
+        freelist_helper_.PushFreeEntry(chunk_offset, entry_end - chunk_offset);
+      }
     }
 
-    return first_free_offset;
+    data_reader_writer_.WriteComplexType(chunks, begin);
+    return chunks.front().first;
+  }
+
+  template<typename Iterator>
+  OffsetType writeExtentType(PVType value_type, const Iterator begin, OffsetType data_size) {
+    const auto extent_size = getExtentSize(data_size);
+    const auto extent_offset = getFreeExtentOffset(extent_size);
+
+    ComplexTypeHeader header;
+    header.value_type_ = value_type;
+    header.value_state_ = PVTypeState::kComplexBegin | PVTypeState::kExtent;
+    header.overall_size_ = data_size;
+    header.chunk_size_ = data_size;
+    data_reader_writer_.WriteExtentType(extent_offset, header, begin);
+    return extent_offset;
+  }
+
+  // extents are multiples of the allocation unit, so the clusters after them keep their alignment
+  OffsetType getExtentSize(OffsetType data_size) const {
+    const auto entry_size = data_size + serialization_utils::offset_of(&ComplexTypeHeader::data_);
+    const OffsetType unit_size = getAllocationUnitSize();
+    return (entry_size + unit_size - 1) / unit_size * unit_size;
+  }
+
+  // the cluster, but huge clusters are split into kExtentThreshold units, otherwise each extent and the tail left
+  // after shrinking would waste up to the whole cluster
+  OffsetType getAllocationUnitSize() const noexcept {
+    return std::min(static_cast<OffsetType>(cluster_size_), static_cast<OffsetType>(kExtentThreshold));
   }
 
+  // the smallest free entry that fits the extent is reused (f.e. the freed extent), otherwise the extent is reserved
+  // at the device end
+  OffsetType getFreeExtentOffset(OffsetType extent_size) {
+    const auto [free_offset, free_size] = freelist_helper_.PopFreeEntry(extent_size, extent_size);
+    if (!offset_traits<OffsetType>::IsExistValue(free_offset)) {
+      return entries_allocator_.ReserveExtent(data_reader_writer_, extent_size);
+    }
+
+    if (free_size > extent_size) {
+      freelist_helper_.PushFreeEntry(free_offset + extent_size, free_size - extent_size);
+    }
+    return free_offset;
+  }
+
+  // small entries are taken from slabs in the slab mode, new slabs take clusters from the free space index
   OffsetType getFreeEntryOffset(OffsetType entry_size) {
-    const auto offset = getFreeOffset(entry_size);
+    const auto class_id = (is_slab_mode_ ? slab_allocator_.GetClassId(entry_size) : slab_allocator::kSlabClassCount);
+    if (class_id == slab_allocator::kSlabClassCount) {
+      return getFreeEntry(entry_size, entry_size).first;
+    }
 
-    OffsetType split_size = 0;
-    switch (getEntryType(offset)) {
-    case PVType::kEmpty4Simple:
-      recoverAndPushNextEntry<Simple4TypeHeader>(offset);
-      return offset;
-    case PVType::kEmpty8Simple:
-      recoverAndPushNextEntry<Simple8TypeHeader>(offset);
-      return offset;
-    case PVType::kEmptyComplex:
-      const ComplexTypeHeader header = data_reader_writer_.template Read<ComplexTypeHeader>(offset);
-      recoverAndPushNextEntry<ComplexTypeHeader>(offset);
-      if (entry_size > header.overall_size_) {
-        return offset;
-      }
-      split_size = header.overall_size_ - entry_size;
+    const auto slot_offset = slab_allocator_.PopFreeSlot(class_id);
+    if (offset_traits<OffsetType>::IsExistValue(slot_offset)) {
+      return slot_offset;
     }
+    const auto slab_size = slab_allocator_.slab_size();
+    return slab_allocator_.AddSlab(getFreeEntry(slab_size, slab_size).first, class_id);
+  }
 
-    splitEntries(offset + entry_size, split_size);
-    return offset;
+  // returns the offset of the allocated entry and its size. The rest of the free entry goes back to the index even
+  // if it doesn't fit the smallest entry (it would be merged with the neighbour when it is freed), so the size is
+  // smaller than entry_size only if there isn't any free entry of entry_size, but there is one of minimum_size
+  std::pair<OffsetType, OffsetType> getFreeEntry(OffsetType entry_size, OffsetType minimum_size) {
+    auto free_entry = freelist_helper_.PopFreeEntry(entry_size, minimum_size);
+    if (!offset_traits<OffsetType>::IsExistValue(free_entry.first)) {
+      free_entry = entries_allocator_.ExpandPV(data_reader_writer_, entry_size);
+    }
+
+    auto &[offset, free_size] = free_entry;
+    if (free_size > entry_size) {
+      freelist_helper_.PushFreeEntry(offset + entry_size, free_size - entry_size);
+      free_size = entry_size;
+    }
+    return free_entry;
   }
 
-  OffsetType getFreeOffset(OffsetType entry_size) {
-    auto offset = freelist_helper_.PopFreeEntryOffset(entry_size);
-    if (!offset_traits<OffsetType>::IsExistValue(offset)) {
-      const auto free_entry_offset = entries_allocator_.ExpandPV(data_reader_writer_,
-          freelist_helper_.GetFreeEntry(cluster_size_));
-      freelist_helper_.PushFreeEntry(free_entry_offset, cluster_size_);
-      offset = freelist_helper_.PopFreeEntryOffset(entry_size);
-      if (!offset_traits<OffsetType>::IsExistValue(offset)) {
-        throw (exception::YASException("Error during physical volume size extended",
-            StorageError::kDeviceExpandError));
+  // the region of the loaded index is kept until the next SaveStartEntries, the header on the device refers to it
+  void loadFreeIndex(const FreeIndexHeaderType &free_index_header) {
+    const OffsetType device_end = entries_allocator_.device_end();
+    const OffsetType free_index_offset = free_index_header.free_index_offset_;
+    OffsetType free_index_size = 0;
+    for (const OffsetType part_size : { free_index_header.free_index_size_, free_index_header.slab_index_size_,
+        free_index_header.freelist_limits_size_ }) {
+      if (free_index_size + part_size < free_index_size) {
+        free_index_size = device_end;
+        break;
+      }
+      free_index_size += part_size;
+    }
+    // the region size isn't saved before the slack was added
+    const OffsetType region_size = std::max(free_index_size, free_index_header.free_index_region_size_);
+
+    const OffsetType free_index_end = free_index_offset + region_size;
+    if (free_index_offset < sizeof(PVHeader) + sizeof(FreeIndexHeaderType) || free_index_end < free_index_offset ||
+        free_index_end > device_end) {
+      throw exception::YASException("PV header parsing: invalid free space index location",
+          StorageError::kInvalidPVSignatureError);
+    }
+
+    freelist_helper_.Clear();
+    slab_allocator_.Clear();
+    if (0 != free_index_size) {
+      const auto free_index = data_reader_writer_.RawRead(free_index_offset, free_index_size);
+      const auto slab_index_begin = std::cbegin(free_index) + free_index_header.free_index_size_;
+      const auto freelist_limits_begin = slab_index_begin + free_index_header.slab_index_size_;
+      // limits are set at first, so entries are placed in the right bins
+      if (0 != free_index_header.freelist_limits_size_) {
+        freelist_helper_.limits(FreelistHelperType::DeserializeLimits(freelist_limits_begin, std::cend(free_index)));
       }
+      freelist_helper_.Deserialize(std::cbegin(free_index), slab_index_begin);
+      slab_allocator_.Deserialize(slab_index_begin, freelist_limits_begin);
+      saved_free_index_ = free_index;
     }
+    is_slab_mode_ = (0 != free_index_header.is_slab_mode_);
+    saved_free_index_header_ = free_index_header;
+    saved_free_index_header_.free_index_region_size_ = region_size;
+  }
 
-    return offset;
+  // sizes of parts are set to the header (but not the location)
+  ByteVector serializeFreeIndex(FreeIndexHeaderType &free_index_header) const {
+    auto free_index = freelist_helper_.Serialize();
+    const auto slab_index = slab_allocator_.Serialize();
+    const auto freelist_limits = freelist_helper_.SerializeLimits();
+    free_index_header.free_index_size_ = free_index.size();
+    free_index_header.slab_index_size_ = slab_index.size();
+    free_index_header.is_slab_mode_ = is_slab_mode_;
+    free_index_header.freelist_limits_size_ = freelist_limits.size();
+    free_index.insert(std::end(free_index), std::cbegin(slab_index), std::cend(slab_index));
+    free_index.insert(std::end(free_index), std::cbegin(freelist_limits), std::cend(freelist_limits));
+    return free_index;
   }
 
-  void splitEntries(OffsetType split_offset, OffsetType split_size) {
-    if (split_size > sizeof(ComplexTypeHeader)) {
-      ComplexTypeHeader header;
-      header.value_type_ = PVType::kEmptyComplex;
-      header.next_free_entry_offset_ = freelist_helper_.GetFreeEntry(split_size);
-      header.overall_size_ = split_size;
-      header.chunk_size_ = split_size;
-      data_reader_writer_.template Write<ComplexTypeHeader>(split_offset, header);
-      freelist_helper_.PushFreeEntry(split_offset, split_size);
-    }
-    else if (split_size >= sizeof(Simple4TypeHeader) && split_size < sizeof(Simple8TypeHeader)) {
-      Simple4TypeHeader header;
-      header.next_free_entry_offset_ = freelist_helper_.GetFreeEntry(split_size);
-      header.value_type_ = PVType::kEmpty4Simple;
-      data_reader_writer_.template Write<Simple4TypeHeader>(split_offset, header);
-      freelist_helper_.PushFreeEntry(split_offset, split_size);
-    }
-    else if (split_size >= sizeof(Simple8TypeHeader)) {
-      Simple8TypeHeader header;
-      header.next_free_entry_offset_ = freelist_helper_.GetFreeEntry(split_size);
-      header.value_type_ = PVType::kEmpty8Simple;
-      data_reader_writer_.template Write<Simple8TypeHeader>(split_offset, header);
-      freelist_helper_.PushFreeEntry(split_offset, split_size);
-    }
-  }
-
-  // recover next_free_offset from Header and push it to the freelist
-  template<typename HeaderType>
-  bool recoverAndPushNextEntry(OffsetType offset) {
-    HeaderType header = data_reader_writer_.template Read<HeaderType>(offset);
-    const auto next_free_entry = header.next_free_entry_offset_;
-    if (!offset_traits<OffsetType>::IsExistValue(next_free_entry)) {
-      return false;
+  // the lowest free entry is taken, so the index doesn't stop the PV shrink
+  OffsetType popFreeIndexRegion(OffsetType region_size) {
+    const auto [free_offset, free_size] = freelist_helper_.PopLowerFreeEntry(region_size,
+        entries_allocator_.device_end());
+    if (!offset_traits<OffsetType>::IsExistValue(free_offset)) {
+      return entries_allocator_.ReserveExtent(data_reader_writer_, region_size);
+    }
+
+    if (free_size > region_size) {
+      freelist_helper_.PushFreeEntry(free_offset + region_size, free_size - region_size);
     }
+    return free_offset;
+  }
+
+  // the free space index, slabs and limits of bins are placed in the lowest free entry that fits them (or at the
+  // device end), the space for them is taken before they are serialized, so their own allocation doesn't change them.
+  // The header on the device refers to the index saved before until it is rewritten, so that index is freed only
+  // here and nothing could be written there before the header refers to the new one. The index isn't rewritten if it
+  // hasn't been changed
+  void saveFreeIndex() {
+    FreeIndexHeaderType free_index_header{};
+    auto free_index = serializeFreeIndex(free_index_header);
+    if (0 == saved_free_index_header_.free_index_region_size_ || free_index != saved_free_index_ ||
+        free_index_header.is_slab_mode_ != saved_free_index_header_.is_slab_mode_) {
+      // the slack keeps the region big enough for the index changed by the region allocation
+      OffsetType region_size = free_index.size() + kFreeIndexSlack;
+      OffsetType region_offset = popFreeIndexRegion(region_size);
+      freelist_helper_.PushFreeEntry(saved_free_index_header_.free_index_offset_,
+          saved_free_index_header_.free_index_region_size_);
+      free_index = serializeFreeIndex(free_index_header);
+      if (free_index.size() > region_size) {
+        freelist_helper_.PushFreeEntry(region_offset, region_size);
+        free_index = serializeFreeIndex(free_index_header);
+        region_size = free_index.size() + kFreeIndexSlack;
+        region_offset = entries_allocator_.ReserveExtent(data_reader_writer_, region_size);
+      }
+
+      free_index_header.free_index_offset_ = region_offset;
+      free_index_header.free_index_region_size_ = region_size;
+      if (!free_index.empty()) {
+        data_reader_writer_.RawWrite(region_offset, std::cbegin(free_index), std::cend(free_index));
+      }
+      saved_free_index_header_ = free_index_header;
+      saved_free_index_ = std::move(free_index);
+    }
+  }
 
-    auto next_free_entry_size = sizeof header;
-    if constexpr(std::is_same_v<HeaderType, ComplexTypeHeader>){
-      header = data_reader_writer_.template Read<ComplexTypeHeader>(next_free_entry);
-      next_free_entry_size = header.overall_size_ + serialization_utils::offset_of(&ComplexTypeHeader::data_);
+  // each free entry gets the header of the empty entry that links it to the next one of its bin (by the historical
+  // limits), as PV before 1.4 keeps them. The empty complex header describes the whole entry, but smaller entries
+  // get simple headers, so the rest of them after the header is lost (as well as entries smaller than any header)
+  FreelistHeaderType saveFreelists() {
+    FreelistHeaderType freelist_header;
+    for (int32_t bin_id = 0; bin_id < pv_layout_headers::kBinCount; ++bin_id) {
+      freelist_header.free_bins_[bin_id] = offset_traits<OffsetType>::NonExistValue();
+    }
+    auto link_entry = [this, &freelist_header](OffsetType free_offset, OffsetType entry_size, auto &header) {
+      const auto &limits = FreelistHelperType::kFreelistLimits;
+      const auto bin_id = std::distance(std::cbegin(limits),
+          std::upper_bound(std::cbegin(limits), std::cend(limits), entry_size)) - 1;
+      header.next_free_entry_offset_ = freelist_header.free_bins_[bin_id];
+      data_reader_writer_.template Write<std::decay_t<decltype(header)>>(free_offset, header);
+      freelist_header.free_bins_[bin_id] = free_offset;
+    };
+
+    const auto data_offset = serialization_utils::offset_of(&ComplexTypeHeader::data_);
+    for (const auto &[free_offset, free_size] : freelist_helper_.entries()) {
+      if (free_size >= sizeof(ComplexTypeHeader)) {
+        ComplexTypeHeader header;
+        header.value_type_ = PVType::kEmptyComplex;
+        header.value_state_ = PVTypeState::kComplexBegin;
+        header.overall_size_ = free_size - data_offset;
+        header.chunk_size_ = header.overall_size_;
+        link_entry(free_offset, free_size, header);
+      }
+      else if (free_size >= sizeof(Simple8TypeHeader)) {
+        Simple8TypeHeader header{};
+        header.value_type_ = PVType::kEmpty8Simple;
+        header.value_state_ = PVTypeState::kEmpty;
+        link_entry(free_offset, sizeof header, header);
+      }
+      else if (free_size >= sizeof(Simple4TypeHeader)) {
+        Simple4TypeHeader header{};
+        header.value_type_ = PVType::kEmpty4Simple;
+        header.value_state_ = PVTypeState::kEmpty;
+        link_entry(free_offset, sizeof header, header);
+      }
+    }
+
+    return freelist_header;
+  }
+
+  // PV before 1.4 keeps free entries in linked lists of bins, so they are walked once to build the index
+  void loadFreelists(const FreelistHeaderType &freelist_header) {
+    const auto data_offset = serialization_utils::offset_of(&ComplexTypeHeader::data_);
+    const OffsetType device_end = entries_allocator_.device_end();
+    freelist_helper_.Clear();
+    for (auto free_offset : freelist_header.free_bins_) {
+      while (offset_traits<OffsetType>::IsExistValue(free_offset) && !freelist_helper_.HasFreeEntry(free_offset)) {
+        const EntryHeader entry_header = getEntryHeader(free_offset);
+        OffsetType entry_size = 0;
+        OffsetType next_free_offset = offset_traits<OffsetType>::NonExistValue();
+        switch (entry_header.pv_state_.value_type_) {
+        case PVType::kEmpty4Simple:
+          entry_size = sizeof(Simple4TypeHeader);
+          next_free_offset = entry_header.simple4_type_header_.next_free_entry_offset_;
+          break;
+        case PVType::kEmpty8Simple:
+          entry_size = sizeof(Simple8TypeHeader);
+          next_free_offset = entry_header.simple8_type_header_.next_free_entry_offset_;
+          break;
+        case PVType::kEmptyComplex:
+          entry_size = entry_header.complex_type_header_.overall_size_ + data_offset;
+          next_free_offset = entry_header.complex_type_header_.next_free_entry_offset_;
+          break;
+        default:
+          break;
+        }
+
+        if (0 == entry_size || entry_size > device_end - free_offset) {
+          throw exception::YASException("PV freelists parsing: corrupted free entry",
+              StorageError::kCorruptedHeaderError);
+        }
+        freelist_helper_.PushFreeEntry(free_offset, entry_size);
+        free_offset = next_free_offset;
+      }
     }
-    freelist_helper_.PushFreeEntry(next_free_entry, next_free_entry_size);
-    return true;
   }
 };
 
@@ -0,0 +1,300 @@
+#pragma once
+#include "pv_layout_headers.h"
+#include "../common/bit_utils.h"
+#include "../common/common.h"
+#include "../common/offset_type_traits.hpp"
+#include "../utils/serialization_utils.h"
+#include "../exceptions/YASException.hpp"
+#include <array>
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace yas {
+namespace slab_allocator {
+
+constexpr uint32_t kSlabClassCount = 7;
+
+// Slabs are clusters (or kExtentThreshold parts of huge clusters) dedicated to entries of one size class (f.e. only
+// Simple8TypeHeader), so small entries of the same size are packed next to each other like in jemalloc and one page
+// read brings many of them. Each slab is split into slots, their occupancy is kept only in memory by bitmaps. The slabs
+// are serialized by Serialize on PV close next to the free space index and restored by Deserialize on PV load.
+template <typename OffsetType>
+class SlabAllocator {
+ public:
+  // sizes of slots, the last ones are for complex entries with small data
+  static constexpr std::array<OffsetType, kSlabClassCount> kSlabClasses = {
+      sizeof(pv_layout_headers::Simple4TypeHeader),
+      sizeof(pv_layout_headers::Simple8TypeHeader),
+      64,
+      96,
+      128,
+      192,
+      256 };
+
+  explicit SlabAllocator(int32_t cluster_size) {
+    this->cluster_size(cluster_size);
+  }
+
+  ~SlabAllocator() = default;
+
+  // returns the id of the smallest class that fits entry_size or kSlabClassCount if the entry is too big for slabs
+  // (the cluster should fit at least two slots of the class)
+  uint32_t GetClassId(OffsetType entry_size) const {
+    const auto found_class_it = std::lower_bound(std::cbegin(kSlabClasses), std::cend(kSlabClasses), entry_size);
+    const auto class_id = static_cast<uint32_t>(std::distance(std::cbegin(kSlabClasses), found_class_it));
+    return (class_id < kSlabClassCount && slots_counts_[class_id] >= 2) ? class_id : kSlabClassCount;
+  }
+
+  // returns the offset of the free slot of the class (slabs with lower offsets are filled first) or NonExistValue if
+  // all slabs of the class are full
+  OffsetType PopFreeSlot(uint32_t class_id) {
+    return PopLowerFreeSlot(class_id, std::numeric_limits<OffsetType>::max());
+  }
+
+  // the same as PopFreeSlot, but the slot should be placed before offset_limit (f.e. to move the entry closer to the
+  // PV beginning)
+  OffsetType PopLowerFreeSlot(uint32_t class_id, OffsetType offset_limit) {
+    auto &partial_slabs = partial_slabs_[class_id];
+    if (partial_slabs.empty() || *std::begin(partial_slabs) >= offset_limit) {
+      return offset_traits<OffsetType>::NonExistValue();
+    }
+
+    const auto slab_offset = *std::begin(partial_slabs);
+    auto &slab = slabs_.at(slab_offset);
+    uint32_t slot_id = 0;
+    for (uint32_t word_id = 0; word_id < slab.occupancy_.size(); ++word_id) {
+      if (~slab.occupancy_[word_id]) {
+        slot_id = word_id * 64 + bit_utils::CountTrailingZeros(~slab.occupancy_[word_id]);
+        break;
+      }
+    }
+    const OffsetType slot_offset = slab_offset + slot_id * kSlabClasses[class_id];
+    if (slot_offset >= offset_limit) {
+      return offset_traits<OffsetType>::NonExistValue();
+    }
+
+    slab.occupancy_[slot_id / 64] |= 1ull << (slot_id % 64);
+    if (++slab.used_count_ == slots_counts_[class_id]) {
+      partial_slabs.erase(std::begin(partial_slabs));
+    }
+    return slot_offset;
+  }
+
+  // the new slab takes the cluster at slab_offset, its first slot is returned already used
+  OffsetType AddSlab(OffsetType slab_offset, uint32_t class_id) {
+    Slab slab;
+    slab.class_id_ = class_id;
+    slab.used_count_ = 1;
+    slab.occupancy_ = makeEmptyOccupancy(class_id);
+    slab.occupancy_[0] = 1;
+    slabs_.emplace(slab_offset, std::move(slab));
+    if (slots_counts_[class_id] > 1) {
+      partial_slabs_[class_id].insert(slab_offset);
+    }
+    return slab_offset;
+  }
+
+  // checks if offset lies inside some slab
+  bool HasSlot(OffsetType offset) const {
+    return std::cend(slabs_) != findSlab(offset);
+  }
+
+  // returns the offset of the slab if it has become empty (its cluster should be freed by the caller), otherwise
+  // NonExistValue. Throws YASException if offset isn't the used slot.
+  OffsetType FreeSlot(OffsetType offset) {
+    const auto slab_it = findSlab(offset);
+    if (std::end(slabs_) == slab_it) {
+      throw exception::YASException("Slab slot freeing: the offset is out of slabs",
+          storage::StorageError::kCorruptedHeaderError);
+    }
+
+    auto &[slab_offset, slab] = *slab_it;
+    const auto slot_size = kSlabClasses[slab.class_id_];
+    const auto slot_id = static_cast<uint32_t>((offset - slab_offset) / slot_size);
+    const auto slot_mask = 1ull << (slot_id % 64);
+    if (0 != (offset - slab_offset) % slot_size || slot_id >= slots_counts_[slab.class_id_] ||
+        !(slab.occupancy_[slot_id / 64] & slot_mask)) {
+      throw exception::YASException("Slab slot freeing: the slot isn't used",
+          storage::StorageError::kCorruptedHeaderError);
+    }
+
+    slab.occupancy_[slot_id / 64] &= ~slot_mask;
+    if (0 != --slab.used_count_) {
+      partial_slabs_[slab.class_id_].insert(slab_offset);
+      return offset_traits<OffsetType>::NonExistValue();
+    }
+
+    const auto empty_slab_offset = slab_offset;
+    partial_slabs_[slab.class_id_].erase(empty_slab_offset);
+    slabs_.erase(slab_it);
+    return empty_slab_offset;
+  }
+
+  // returns used slots of all slabs as pairs of the offset and the size
+  std::vector<std::pair<OffsetType, OffsetType>> GetUsedSlots() const {
+    std::vector<std::pair<OffsetType, OffsetType>> used_slots;
+    for (const auto &[slab_offset, slab] : slabs_) {
+      const auto slot_size = kSlabClasses[slab.class_id_];
+      for (uint32_t slot_id = 0; slot_id < slots_counts_[slab.class_id_]; ++slot_id) {
+        if (slab.occupancy_[slot_id / 64] & (1ull << (slot_id % 64))) {
+          used_slots.emplace_back(slab_offset + slot_id * slot_size, slot_size);
+        }
+      }
+    }
+    return used_slots;
+  }
+
+  // drops all slabs and returns their free slots as pairs of the offset and the size (neighbour free slots are
+  // joined), so they could be moved to the free space index
+  std::vector<std::pair<OffsetType, OffsetType>> ReleaseAll() {
+    std::vector<std::pair<OffsetType, OffsetType>> free_slots;
+    for (const auto &[slab_offset, slab] : slabs_) {
+      const auto slot_size = kSlabClasses[slab.class_id_];
+      const auto slots_count = slots_counts_[slab.class_id_];
+      for (uint32_t slot_id = 0; slot_id < slots_count; ++slot_id) {
+        if (slab.occupancy_[slot_id / 64] & (1ull << (slot_id % 64))) {
+          continue;
+        }
+
+        const OffsetType slot_offset = slab_offset + slot_id * slot_size;
+        if (!free_slots.empty() && free_slots.back().first + free_slots.back().second == slot_offset) {
+          free_slots.back().second += slot_size;
+        }
+        else {
+          free_slots.emplace_back(slot_offset, slot_size);
+        }
+      }
+
+      // the tail of the cluster that doesn't fit a slot
+      const OffsetType slots_end = slab_offset + slots_count * slot_size;
+      if (slots_end < slab_offset + slab_size_) {
+        free_slots.emplace_back(slots_end, slab_offset + slab_size_ - slots_end);
+      }
+    }
+
+    Clear();
+    return free_slots;
+  }
+
+  void Clear() noexcept {
+    slabs_.clear();
+    for (auto &partial_slabs : partial_slabs_) {
+      partial_slabs.clear();
+    }
+  }
+
+  // slabs are saved in the offset order as varints of the gap after the previous slab and of the class id followed
+  // by the occupancy bitmap (a bit per slot)
+  ByteVector Serialize() const {
+    ByteVector serialized_slabs;
+    OffsetType previous_end = 0;
+    for (const auto &[slab_offset, slab] : slabs_) {
+      serialization_utils::SaveVarint(serialized_slabs, slab_offset - previous_end);
+      serialization_utils::SaveVarint(serialized_slabs, slab.class_id_);
+      const auto bitmap_size = (slots_counts_[slab.class_id_] + 7) / 8;
+      for (uint32_t byte_id = 0; byte_id < bitmap_size; ++byte_id) {
+        serialized_slabs.push_back(static_cast<uint8_t>(slab.occupancy_[byte_id / 8] >> (byte_id % 8 * 8)));
+      }
+      previous_end = slab_offset + slab_size_;
+    }
+
+    return serialized_slabs;
+  }
+
+  // replaces slabs by the serialized ones, throws YASException if they are corrupted
+  template <typename Iterator>
+  void Deserialize(Iterator begin, const Iterator end) {
+    Clear();
+    OffsetType previous_end = 0;
+    while (begin != end) {
+      OffsetType gap = 0;
+      uint32_t class_id = 0;
+      if (!serialization_utils::LoadVarint(begin, end, gap) || !serialization_utils::LoadVarint(begin, end, class_id) ||
+          class_id >= kSlabClassCount || previous_end + gap < previous_end) {
+        throw exception::YASException("Slabs loading: corrupted slab", storage::StorageError::kCorruptedHeaderError);
+      }
+
+      Slab slab;
+      slab.class_id_ = class_id;
+      slab.occupancy_ = makeEmptyOccupancy(class_id);
+      const auto slots_count = slots_counts_[class_id];
+      for (uint32_t byte_id = 0; byte_id < (slots_count + 7) / 8; ++byte_id) {
+        if (begin == end) {
+          throw exception::YASException("Slabs loading: corrupted occupancy",
+              storage::StorageError::kCorruptedHeaderError);
+        }
+        slab.occupancy_[byte_id / 8] |= static_cast<uint64_t>(static_cast<uint8_t>(*begin++)) << (byte_id % 8 * 8);
+      }
+      // bits after the last slot are ignored
+      if (0 != slots_count % 64) {
+        slab.occupancy_.back() &= (1ull << (slots_count % 64)) - 1;
+      }
+      for (const auto word : slab.occupancy_) {
+        slab.used_count_ += bit_utils::PopCount(word);
+      }
+
+      const OffsetType slab_offset = previous_end + gap;
+      if (slab.used_count_ < slots_count) {
+        partial_slabs_[class_id].insert(slab_offset);
+      }
+      slabs_.emplace(slab_offset, std::move(slab));
+      previous_end = slab_offset + slab_size_;
+    }
+  }
+
+  // slabs take one cluster each (but not more than kExtentThreshold), so the cluster size shouldn't be changed while
+  // there are any slabs
+  void cluster_size(int32_t cluster_size) {
+    slab_size_ = std::min(static_cast<OffsetType>(cluster_size), static_cast<OffsetType>(kExtentThreshold));
+    for (uint32_t class_id = 0; class_id < kSlabClassCount; ++class_id) {
+      slots_counts_[class_id] = static_cast<uint32_t>(slab_size_ / kSlabClasses[class_id]);
+    }
+  }
+
+  OffsetType slab_size() const noexcept { return slab_size_; }
+  size_t slabs_count() const noexcept { return slabs_.size(); }
+
+  SlabAllocator(SlabAllocator&) = delete;
+  SlabAllocator(SlabAllocator&&) = delete;
+  SlabAllocator& operator=(const SlabAllocator&) = delete;
+  SlabAllocator& operator= (SlabAllocator&&) = delete;
+
+ private:
+  struct Slab {
+    uint32_t class_id_ = 0;
+    uint32_t used_count_ = 0;
+    std::vector<uint64_t> occupancy_;     // a bit per slot, the slot is used if its bit is set
+  };
+
+  std::map<OffsetType, Slab> slabs_;
+  std::array<std::set<OffsetType>, kSlabClassCount> partial_slabs_;    // offsets of slabs with free slots
+  std::array<uint32_t, kSlabClassCount> slots_counts_;
+  OffsetType slab_size_;
+
+  typename std::map<OffsetType, Slab>::const_iterator findSlab(OffsetType offset) const {
+    auto slab_it = slabs_.upper_bound(offset);
+    if (std::cbegin(slabs_) == slab_it || offset - std::prev(slab_it)->first >= slab_size_) {
+      return std::cend(slabs_);
+    }
+    return std::prev(slab_it);
+  }
+
+  typename std::map<OffsetType, Slab>::iterator findSlab(OffsetType offset) {
+    auto slab_it = slabs_.upper_bound(offset);
+    if (std::begin(slabs_) == slab_it || offset - std::prev(slab_it)->first >= slab_size_) {
+      return std::end(slabs_);
+    }
+    return std::prev(slab_it);
+  }
+
+  std::vector<uint64_t> makeEmptyOccupancy(uint32_t class_id) const {
+    return std::vector<uint64_t>((slots_counts_[class_id] + 63) / 64, 0);
+  }
+};
+
+} // namespace slab_allocator
+} // namespace yas
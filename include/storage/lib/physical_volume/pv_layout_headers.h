@@ -13,9 +13,10 @@ constexpr int32_t kBinCount = 11;
 
 // PV layout contains:
 // PVHeader
-// Freelists
+// Freelists (FreeIndexHeader since 1.4)
 // Inverted index
 // Data
+// Free space index (since 1.4, it is dropped on load, so next entries overwrite it)
 
 STRUCT_PACK(
 struct PVHeader {
@@ -28,12 +29,29 @@ struct PVHeader {
   int32_t freelist_bins_count_ = kBinCount;                                        //  + 4 bytes
 });
 
+// heads of linked lists of free entries (before 1.4)
 STRUCT_PACK(
 template<typename OffsetType>
 struct FreelistHeader {
   OffsetType free_bins_[kBinCount];
 });
 
+// the location of the serialized free space index, it takes the place of FreelistHeader (since 1.4). Slabs and
+// limits of freelist bins are serialized right after the free space index (there are default limits for the
+// cluster size if they aren't saved). The region of the index could be bigger than its parts (zero if it isn't
+// saved)
+STRUCT_PACK(
+template<typename OffsetType>
+struct FreeIndexHeader {
+  OffsetType free_index_offset_;
+  OffsetType free_index_size_;
+  OffsetType slab_index_size_;
+  OffsetType is_slab_mode_;
+  OffsetType freelist_limits_size_;
+  OffsetType free_index_region_size_;
+  OffsetType reserved_[kBinCount - 6];
+});
+
 enum PVType : uint8_t {
   kInt8   = 0,
   kUint8  = 1,
@@ -60,7 +78,8 @@ enum PVTypeState : uint8_t {
   kEmpty = 0x00,
   kIsExpired = 0x01,      // has expired time
   kComplexBegin = 0x02,   // beginning of Complex type
-  kComplexSequel = 0x04   // next chunk of Complex type
+  kComplexSequel = 0x04,  // next chunk of Complex type
+  kExtent = 0x08          // the whole Complex type is placed in one contiguous extent (since 1.3)
 };
 
 constexpr PVTypeState operator|(PVTypeState lhs, PVTypeState rhs) {
@@ -81,9 +100,9 @@ constexpr PVTypeState& operator|=(PVTypeState &lhs, PVTypeState rhs) {
 
 // I assume that the most common types would be types with 4 and 8 bytes size, so there are specially
 // size-optimized headers for them. Each header could be in 2 states: allocated and freed. Allocated 
-// headers contain expired_time and data. Freed headers contain the link instead of data. This link 
-// points to the next freed header with size in the same bucket's range. These freelists then would be
-// used for allocating new entries in file. It will lead to decrease fragmentation and expensive 
+// headers contain expired_time and data. Before 1.4 freed headers contained the link instead of data. This
+// link pointed to the next freed header with size in the same bucket's range. Since 1.4 free entries are
+// kept only in the memory index (FreelistHelper), which is used for allocating new entries in file. It will lead to decrease fragmentation and expensive 
 // extension process of the physical volume on hdd. Also note that expired_time can also be placed at 
 // inverted index and there is also a tradeoff between size/speed. I chose the file location to reduce
 // possible RAM costs (following the reqs in proposal).
@@ -93,7 +112,8 @@ constexpr PVTypeState& operator|=(PVTypeState &lhs, PVTypeState rhs) {
 // Given this fact it can be said that it would be faster to implement the same logic as in jemalloc or
 // low fragmentation heap in Windows >= 8. The first is designed to place objects of the same size next to 
 // each other to reach cache-friendly using and the second has buckets with preallocated headers and 
-// exploit similar conception. But i think that for test task it is too complex :).
+// exploit similar conception. The slab mode of PVEntriesManager (SlabAllocator) does the same: small entries
+// are placed in clusters dedicated to their size class.
 
 STRUCT_PACK(
   struct PVState {
@@ -137,6 +157,7 @@ struct ComplexTypeHeader : public PVState {
   };
 });
 
+static_assert(sizeof(FreeIndexHeader<DOffsetType>) == sizeof(FreelistHeader<DOffsetType>), "FreeIndexHeader should keep the layout of FreelistHeader");
 static_assert(sizeof(float) == 4, "please fix type mapping: float should be 4 bytes at size");
 
 constexpr uint32_t kTimeSize = sizeof ComplexTypeHeader::expired_time_high_ + sizeof ComplexTypeHeader::expired_time_low_;
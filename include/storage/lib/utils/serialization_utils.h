@@ -1,5 +1,6 @@
 #pragma once
 #include <cstdint>
+#include <type_traits>
 #include <vector>
 
 namespace yas {
@@ -58,6 +59,36 @@ ReadIterator LoadFromBytes(ReadIterator begin, ReadIterator end, Type *data) {
   return new_end;
 }
 
+// unsigned integers are saved by 7 bits per byte, the high bit marks that the next byte follows
+template<typename Type>
+void SaveVarint(std::vector<uint8_t> &data, Type value) {
+  static_assert(std::is_unsigned_v<Type>, "Type must be unsigned");
+  while (value >= 0x80) {
+    data.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  data.push_back(static_cast<uint8_t>(value));
+}
+
+// returns false if the varint is truncated or doesn't fit Type, begin is moved after the loaded varint
+template<typename ReadIterator, typename Type>
+bool LoadVarint(ReadIterator &begin, const ReadIterator end, Type &value) {
+  static_assert(std::is_unsigned_v<Type>, "Type must be unsigned");
+  value = 0;
+  for (uint32_t shift = 0; shift < sizeof(Type) * 8; shift += 7) {
+    if (begin == end) {
+      return false;
+    }
+    const uint8_t byte = *begin++;
+    value |= static_cast<Type>(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
 // the built-in offsetof macros is compile-specific and could have some important limitations
 // that prevent us of using it if constexpr f.e.
 template <typename T1, typename T2>
@@ -1,6 +1,15 @@
 #pragma once
 #include "lib/utils/Version.hpp"
+#include "lib/devices/CachedDevice.hpp"
 #include "lib/devices/FileDevice.hpp"
+#if defined(__unix__) || defined(__APPLE__)
+#include "lib/devices/AsyncFileDevice.hpp"
+#include "lib/devices/MappedFileDevice.hpp"
+#include "lib/devices/PosixFileDevice.hpp"
+#endif
+#ifdef __linux__
+#include "lib/devices/DirectFileDevice.hpp"
+#endif
 #include <cstdint>
 
 namespace yas {
@@ -11,7 +20,13 @@ using DOffsetType = uintptr_t;
 // type of key chars in storage
 using DCharType = char;
 
-// device that would be used to access PV
+// device that would be used to access PV (on POSIX systems devices::MappedFileDevice<DOffsetType> could be used
+// instead to access PV through the memory mapping and devices::PosixFileDevice<DOffsetType> - through pread/pwrite,
+// both of them allow simultaneous reads from several threads; devices::AsyncFileDevice<DOffsetType> additionally
+// enables PVManager::GetAsync through io_uring or a pool of reader threads). Any of them could be wrapped into
+// devices::CachedDevice<Device> to keep hot pages (mostly entry headers) in memory. On Linux
+// devices::DirectFileDevice<DOffsetType> bypasses the kernel page cache, so CachedDevice over it gives the exact
+// limit of memory used by PV.
 using DDevice = devices::FileDevice<DOffsetType>;
 
 // there must be some maximum type size
@@ -20,6 +35,15 @@ constexpr uint64_t kMaximumTypeSize = 400 * 1024 * 1024; // 400 Mb
 // 3840 - to guaranteed fit in page size on x86/amd64
 constexpr uint32_t kDefaultClusterSize = 3840;
 
-constexpr utils::Version kMaximumSupportedVersion(1, 2);
+// complex values bigger than this size are placed in one contiguous extent instead of the chain of clusters
+constexpr uint64_t kExtentThreshold = 0x10000;
+
+// PV could be tuned to its values by the cluster size: f.e. 64K-2M clusters for blobs (chunks of values are as big
+// as the cluster). Extents and slabs of PV with clusters bigger than kExtentThreshold are split into units of
+// kExtentThreshold, so small values don't take whole huge clusters
+constexpr uint32_t kMinimumClusterSize = 0x100;
+constexpr uint32_t kMaximumClusterSize = 0x200000;
+
+constexpr utils::Version kMaximumSupportedVersion(1, 6);
 
 } // namespace yas
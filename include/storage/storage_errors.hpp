@@ -1,5 +1,6 @@
 #pragma once
 #include <cstdint>
+#include <string>
 
 namespace yas {
 namespace storage {
@@ -28,6 +29,9 @@ enum class StorageError : uint32_t {
   kMemoryNotEnough = 18,
   kPathNotFound = 19,
   kPVNotFound = 20,
+  kInvalidFreelistLimits = 21,
+  kInvalidClusterSize = 22,
+  kInvertedIndexSerializationError = 23,
 
   kUnknownExceptionType
 };
@@ -0,0 +1,168 @@
+#pragma once
+#include "storage/lib/inverted_index/AdaptiveRadixTreeEngine.hpp"
+#include "storage/lib/inverted_index/AhoCorasickEngine.hpp"
+#include "storage/lib/inverted_index/leaf_type_traits.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using Engine = yas::index_helper::AdaptiveRadixTreeEngine<char, uint64_t>;
+using TrieEngine = yas::index_helper::AhoCorasickEngine<char, uint64_t>;
+
+TEST(AdaptiveRadixTreeEngine, BasicInsertTest) {
+  Engine engine;
+  const std::vector<std::string> keys = { "/home/user1/tmp1", "/home/user1/tmp2", "/home/user1/tmp3", "/home/user2",
+      "/home/user1", "/home", "/var/log", "/var/logs/app" };
+  for (size_t key_id = 0; key_id < keys.size(); ++key_id) {
+    Engine::leaf_type leaf = key_id * 10;
+    EXPECT_TRUE(engine.Insert(keys[key_id], leaf));
+  }
+
+  for (size_t key_id = 0; key_id < keys.size(); ++key_id) {
+    EXPECT_EQ(key_id * 10, engine.Get(keys[key_id]));
+    EXPECT_TRUE(engine.HasKey(keys[key_id]));
+  }
+
+  // prefixes of keys aren't keys, but they are in the tree
+  const auto non_exist_value = yas::index_helper::leaf_type_traits<Engine::leaf_type>::NonExistValue();
+  EXPECT_EQ(non_exist_value, engine.Get("/home/user1/tmp"));
+  EXPECT_FALSE(engine.HasKey("/hom"));
+  EXPECT_FALSE(engine.HasKey("/home/user3"));
+  EXPECT_EQ(10, engine.FindMaxSubKey("/home/user3"));
+  EXPECT_EQ(15, engine.FindMaxSubKey("/home/user1/tmp"));
+  EXPECT_EQ(0, engine.FindMaxSubKey("home"));
+
+  Engine::leaf_type leaf = 1;
+  engine.Insert("/home/user1/tmp1", leaf);
+  EXPECT_EQ(1, engine.Get("/home/user1/tmp1"));
+}
+
+TEST(AdaptiveRadixTreeEngine, DeleteTest) {
+  Engine engine;
+  Engine::leaf_type leaf = 10;
+  engine.Insert("/home/user1/tmp1", leaf);
+  engine.Insert("/home/user1/tmp2", leaf);
+
+  EXPECT_TRUE(engine.Delete("/home/user1/tmp1"));
+  EXPECT_FALSE(engine.HasKey("/home/user1/tmp1"));
+  EXPECT_TRUE(engine.HasKey("/home/user1/tmp2"));
+  // the same as in AhoCorasickEngine: the path still exists, but other keys aren't there
+  EXPECT_TRUE(engine.Delete("/home/user"));
+  EXPECT_FALSE(engine.Delete("/home/user2"));
+  EXPECT_EQ(16, engine.FindMaxSubKey("/home/user1/tmp1"));
+}
+
+TEST(AdaptiveRadixTreeEngine, NodeGrowthTest) {
+  // routes of the root node pass all node kinds
+  Engine engine;
+  for (int32_t ch = 0; ch < 256; ++ch) {
+    const std::string key = { static_cast<char>(ch), 'a', 'b', 'c' };
+    Engine::leaf_type leaf = ch;
+    engine.Insert(key, leaf);
+    for (int32_t inserted_ch = 0; inserted_ch <= ch; ++inserted_ch) {
+      const std::string inserted_key = { static_cast<char>(inserted_ch), 'a', 'b', 'c' };
+      EXPECT_EQ(static_cast<Engine::leaf_type>(inserted_ch), engine.Get(inserted_key));
+    }
+  }
+
+  std::vector<Engine::leaf_type> leaves;
+  engine.VisitLeaves([&leaves](Engine::leaf_type leaf) { leaves.push_back(leaf); });
+  std::sort(std::begin(leaves), std::end(leaves));
+  EXPECT_EQ(256, leaves.size());
+  for (size_t leaf_id = 0; leaf_id < leaves.size(); ++leaf_id) {
+    EXPECT_EQ(leaf_id, leaves[leaf_id]);
+  }
+
+  engine.VisitLeaves([](Engine::leaf_type &leaf) { leaf += 1000; });
+  EXPECT_EQ(1000 + 'x', engine.Get("xabc"));
+
+  Engine moved_engine(std::move(engine));
+  EXPECT_EQ(1000 + 'y', moved_engine.Get("yabc"));
+  EXPECT_LT(0, moved_engine.MemoryUsage());
+}
+
+TEST(AdaptiveRadixTreeEngine, RandomKeysTest) {
+  // the tree answers the same as the char trie
+  Engine engine;
+  TrieEngine trie_engine;
+  std::mt19937 random_engine(7);
+  auto make_key = [&random_engine]() {
+    std::string key;
+    const auto key_size = 1 + random_engine() % 12;
+    for (size_t ch_id = 0; ch_id < key_size; ++ch_id) {
+      key.push_back("/ab"[random_engine() % 3]);
+    }
+    return key;
+  };
+
+  for (int32_t operation_id = 0; operation_id < 20000; ++operation_id) {
+    const auto key = make_key();
+    if (random_engine() % 4) {
+      Engine::leaf_type leaf = operation_id;
+      engine.Insert(key, leaf);
+      trie_engine.Insert(key, leaf);
+    }
+    else {
+      EXPECT_EQ(trie_engine.Delete(key), engine.Delete(key));
+    }
+
+    const auto checked_key = make_key();
+    EXPECT_EQ(trie_engine.Get(checked_key), engine.Get(checked_key));
+    EXPECT_EQ(trie_engine.HasKey(checked_key), engine.HasKey(checked_key));
+    EXPECT_EQ(trie_engine.FindMaxSubKey(checked_key), engine.FindMaxSubKey(checked_key));
+  }
+}
+
+TEST(AdaptiveRadixTreeEngine, DISABLED_LookupBenchmark) {
+  // long hierarchical paths like /tenant-1/service-17/host-405.example.com/cpu.user
+  std::vector<std::string> keys;
+  const std::vector<std::string> metrics = { "cpu.user", "cpu.system", "memory.resident", "disk.io.read_bytes" };
+  for (int32_t tenant_id = 0; tenant_id < 10; ++tenant_id) {
+    for (int32_t service_id = 0; service_id < 25; ++service_id) {
+      for (int32_t host_id = 0; host_id < 100; ++host_id) {
+        for (const auto &metric : metrics) {
+          keys.push_back("/tenant-" + std::to_string(tenant_id) + "/service-" + std::to_string(service_id) +
+              "/host-" + std::to_string(host_id) + ".datacenter.example.com/" + metric);
+        }
+      }
+    }
+  }
+
+  auto measure = [&keys](auto &engine, const char *title) {
+    for (size_t key_id = 0; key_id < keys.size(); ++key_id) {
+      uint64_t leaf = key_id;
+      engine.Insert(keys[key_id], leaf);
+    }
+
+    auto lookup_keys = keys;
+    std::shuffle(std::begin(lookup_keys), std::end(lookup_keys), std::mt19937(1));
+    const auto start_time = std::chrono::steady_clock::now();
+    size_t found_count = 0;
+    for (const auto &key : lookup_keys) {
+      found_count += engine.HasKey(key) ? 1 : 0;
+    }
+    const auto finish_time = std::chrono::steady_clock::now();
+    EXPECT_EQ(keys.size(), found_count);
+
+    const auto elapsed_time = std::chrono::duration_cast<std::chrono::microseconds>(finish_time - start_time).count();
+    std::cout << title << ": " << engine.MemoryUsage() / keys.size() << " bytes per key, "
+        << static_cast<int64_t>(keys.size()) * 1000000 / std::max<int64_t>(elapsed_time, 1) << " lookups per second"
+        << std::endl;
+  };
+
+  std::cout << keys.size() << " path keys" << std::endl;
+  {
+    TrieEngine trie_engine;
+    measure(trie_engine, "char trie");
+  }
+  Engine engine;
+  measure(engine, "adaptive radix tree");
+}
+
+}
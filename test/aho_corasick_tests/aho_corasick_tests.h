@@ -1,7 +1,13 @@
 #pragma once
 #include "storage/lib/inverted_index/AhoCorasickEngine.hpp"
 #include "storage/lib/inverted_index/leaf_type_traits.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
 #include <string_view>
+#include <vector>
 
 namespace {
 TEST(AhoCorasickEngine, BasicInsertTest) {
@@ -146,4 +152,90 @@ TEST(AhoCorasickEngine, DeleteRootTest) {
   EXPECT_EQ(false, engine.HasKey("/home/"));
 }
 
+TEST(AhoCorasickEngine, ManyRoutesTest) {
+  // nodes with many children move their routes from the node to the route table
+  using Engine = yas::index_helper::AhoCorasickEngine<char, uint64_t>;
+  Engine engine;
+  for (int32_t ch = 0; ch < 256; ++ch) {
+    const std::string key = { 'a', static_cast<char>(ch), 'b' };
+    Engine::leaf_type leaf = ch;
+    engine.Insert(key, leaf);
+    EXPECT_EQ(leaf, engine.Get(key));
+  }
+  for (int32_t ch = 0; ch < 256; ++ch) {
+    EXPECT_EQ(static_cast<Engine::leaf_type>(ch), engine.Get(std::string{ 'a', static_cast<char>(ch), 'b' }));
+    EXPECT_FALSE(engine.HasKey(std::string{ 'a', static_cast<char>(ch) }));
+  }
+
+  // wide chars keep the table sorted
+  using WideEngine = yas::index_helper::AhoCorasickEngine<wchar_t, uint64_t>;
+  WideEngine wide_engine;
+  std::vector<wchar_t> chars;
+  for (wchar_t ch = 0; ch < 300; ++ch) {
+    chars.push_back(static_cast<wchar_t>(ch * 7919 % 65536));
+  }
+  for (const auto ch : chars) {
+    WideEngine::leaf_type leaf = ch;
+    wide_engine.Insert(std::wstring{ L'/', ch }, leaf);
+  }
+  for (const auto ch : chars) {
+    EXPECT_EQ(static_cast<WideEngine::leaf_type>(ch), wide_engine.Get(std::wstring{ L'/', ch }));
+  }
+  EXPECT_FALSE(wide_engine.HasKey(std::wstring{ L'/', 1 }));
+  EXPECT_EQ(1, wide_engine.FindMaxSubKey(std::wstring{ L'/', 1 }));
+}
+
+TEST(AhoCorasickEngine, SmallRoutesTest) {
+  // nodes with 5-16 routes compare all of them at once, unused places of routes shouldn't match
+  using Engine = yas::index_helper::AhoCorasickEngine<char, uint64_t>;
+  for (const auto &chars : { std::string("abcde"), std::string("\x01\x7f\x80\xff-./012345678") }) {
+    Engine engine;
+    for (size_t ch_id = 0; ch_id < chars.size(); ++ch_id) {
+      Engine::leaf_type leaf = ch_id;
+      engine.Insert(std::string{ '/', chars[ch_id] }, leaf);
+    }
+
+    for (size_t ch_id = 0; ch_id < chars.size(); ++ch_id) {
+      EXPECT_EQ(ch_id, engine.Get(std::string{ '/', chars[ch_id] }));
+    }
+    EXPECT_FALSE(engine.HasKey(std::string{ '/', '\0' }));
+    EXPECT_FALSE(engine.HasKey("/z"));
+    EXPECT_EQ(1, engine.FindMaxSubKey(std::string{ '/', '\0' }));
+  }
+}
+
+TEST(AhoCorasickEngine, DISABLED_LookupBenchmark) {
+  // hierarchical paths like /tenant1/service17/host405
+  using Engine = yas::index_helper::AhoCorasickEngine<char, uint64_t>;
+  std::vector<std::string> keys;
+  for (int32_t tenant_id = 0; tenant_id < 10; ++tenant_id) {
+    for (int32_t service_id = 0; service_id < 100; ++service_id) {
+      for (int32_t host_id = 0; host_id < 1000; ++host_id) {
+        keys.push_back("/tenant" + std::to_string(tenant_id) + "/service" + std::to_string(service_id) + "/host" +
+            std::to_string(host_id));
+      }
+    }
+  }
+
+  Engine engine;
+  for (size_t key_id = 0; key_id < keys.size(); ++key_id) {
+    Engine::leaf_type leaf = key_id;
+    engine.Insert(keys[key_id], leaf);
+  }
+
+  std::shuffle(std::begin(keys), std::end(keys), std::mt19937(1));
+  const auto start_time = std::chrono::steady_clock::now();
+  size_t found_count = 0;
+  for (const auto &key : keys) {
+    found_count += engine.HasKey(key) ? 1 : 0;
+  }
+  const auto finish_time = std::chrono::steady_clock::now();
+  EXPECT_EQ(keys.size(), found_count);
+
+  const auto elapsed_time = std::chrono::duration_cast<std::chrono::microseconds>(finish_time - start_time).count();
+  std::cout << keys.size() << " path keys: " << engine.MemoryUsage() / keys.size() << " bytes per key, "
+      << static_cast<int64_t>(keys.size()) * 1000000 / std::max<int64_t>(elapsed_time, 1) << " lookups per second"
+      << std::endl;
+}
+
 }
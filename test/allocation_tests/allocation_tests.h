@@ -0,0 +1,100 @@
+#pragma once
+#include "storage/PVManager.hpp"
+#include "storage/lib/devices/PosixFileDevice.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+using namespace yas;
+
+// all allocations of the test binary are counted
+std::atomic<uint64_t> allocations_count = 0;
+
+void *operator new(size_t size) {
+  ++allocations_count;
+  if (void *memory = std::malloc(size == 0 ? 1 : size)) {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept {
+  std::free(memory);
+}
+
+namespace {
+
+using TestDeviceType = devices::PosixFileDevice<DOffsetType>;
+
+fs::path CreateEmptyTestFile(const std::string &name) {
+  const auto path = fs::temp_directory_path() / name;
+  fs::remove(path);
+  TestDeviceType::CreateEmpty(path);
+  return path;
+}
+
+TEST(PVDeviceDataReaderWriter, HeadersReadWriteAllocations) {
+  const auto path = CreateEmptyTestFile("yas_allocations_3c5e7a9b1d2f4a6c8e0b2d4f6a8c1e3b_1");
+  pv::PVDeviceDataReaderWriter<DOffsetType, TestDeviceType> data_reader_writer(path);
+
+  pv_layout_headers::ComplexTypeHeader complex_header;
+  complex_header.value_type_ = pv_layout_headers::PVType::kBlob;
+  complex_header.chunk_size_ = 0x10;
+
+  const int32_t operations_count = 1000;
+  const auto initial_allocations_count = allocations_count.load();
+  for (int32_t operation_id = 0; operation_id < operations_count; ++operation_id) {
+    data_reader_writer.Write(operation_id * sizeof complex_header, complex_header);
+    const auto pv_state = data_reader_writer.Read<pv_layout_headers::PVState>(operation_id * sizeof complex_header);
+    const auto readed_header = data_reader_writer.Read<pv_layout_headers::ComplexTypeHeader>(
+        operation_id * sizeof complex_header);
+    EXPECT_EQ(pv_layout_headers::PVType::kBlob, pv_state.value_type_);
+    EXPECT_EQ(complex_header.chunk_size_, readed_header.chunk_size_);
+  }
+
+  EXPECT_EQ(0, allocations_count - initial_allocations_count);
+}
+
+TEST(PVManager, DISABLED_AllocationsPerOperationBenchmark) {
+  using PVManagerType = storage::PVManager<DCharType, DOffsetType, TestDeviceType>;
+  const auto pv_path = fs::temp_directory_path() / "yas_allocations_3c5e7a9b1d2f4a6c8e0b2d4f6a8c1e3b_2";
+  fs::remove(pv_path);
+
+  const int32_t keys_count = 10000;
+  std::vector<std::string> keys;
+  for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+    keys.push_back("/root/" + std::to_string(key_id));
+  }
+
+  auto pv_manager = PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0);
+  auto start_allocations_count = allocations_count.load();
+  for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+    pv_manager->Put(keys[key_id], static_cast<uint64_t>(key_id));
+  }
+  const auto put_allocations_count = allocations_count - start_allocations_count;
+
+  start_allocations_count = allocations_count.load();
+  for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+    const auto result = pv_manager->Get(keys[key_id]);
+    EXPECT_EQ(static_cast<uint64_t>(key_id), std::get<uint64_t>(result.value()));
+  }
+  const auto get_allocations_count = allocations_count - start_allocations_count;
+
+  start_allocations_count = allocations_count.load();
+  for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+    pv_manager->Delete(keys[key_id]);
+  }
+  const auto delete_allocations_count = allocations_count - start_allocations_count;
+
+  std::cout << "Allocations per operation: Put - " << static_cast<double>(put_allocations_count) / keys_count
+      << ", Get - " << static_cast<double>(get_allocations_count) / keys_count << ", Delete - "
+      << static_cast<double>(delete_allocations_count) / keys_count << std::endl;
+}
+
+}
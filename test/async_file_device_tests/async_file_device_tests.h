@@ -0,0 +1,176 @@
+#pragma once
+#include "storage/PVManager.hpp"
+#include "storage/lib/devices/AsyncFileDevice.hpp"
+#include <atomic>
+#include <future>
+#include <vector>
+
+using namespace yas;
+
+namespace {
+
+using AsyncFileDeviceType = devices::AsyncFileDevice<DOffsetType>;
+
+fs::path CreateEmptyTestFile(const std::string &name) {
+  const auto path = fs::temp_directory_path() / name;
+  fs::remove(path);
+  AsyncFileDeviceType::CreateEmpty(path);
+  return path;
+}
+
+void CheckReadsBatch(const fs::path &path, bool is_io_uring_allowed) {
+  AsyncFileDeviceType device(path, is_io_uring_allowed);
+  EXPECT_TRUE(device.IsOpen());
+  if (!is_io_uring_allowed) {
+    EXPECT_FALSE(device.IsIOUringUsed());
+  }
+
+  const int32_t blocks_count = 0x400;
+  const int32_t block_size = 0x100;
+  for (int32_t block_id = 0; block_id < blocks_count; ++block_id) {
+    const ByteVector block(block_size, static_cast<uint8_t>(block_id));
+    device.Write(block_id * block_size, std::cbegin(block), std::cend(block));
+  }
+
+  std::vector<ByteVector> blocks(blocks_count, ByteVector(block_size));
+  std::atomic<int32_t> mismatches_count = 0;
+  std::atomic<int32_t> completed_count = 0;
+  std::promise<void> all_completed;
+  std::vector<AsyncFileDeviceType::AsyncRead> reads;
+  for (int32_t block_id = 0; block_id < blocks_count; ++block_id) {
+    reads.push_back({ static_cast<DOffsetType>(block_id * block_size), blocks[block_id].data(), block_size,
+        [&, block_id](bool is_success) {
+      mismatches_count += !is_success || (ByteVector(block_size, static_cast<uint8_t>(block_id)) != blocks[block_id]);
+      if (blocks_count == ++completed_count) {
+        all_completed.set_value();
+      }
+    }});
+  }
+  // the batch is bigger than the io_uring submission queue
+  device.SubmitReads(std::move(reads));
+
+  all_completed.get_future().wait();
+  EXPECT_EQ(0, mismatches_count);
+}
+
+TEST(AsyncFileDevice, ReadsBatchTest) {
+  const auto path = CreateEmptyTestFile("yas_async_device_2d4c6e8a0b1f3d5c7e9a1b3d5f7a9c0e_1");
+  CheckReadsBatch(path, true);
+}
+
+TEST(AsyncFileDevice, ThreadPoolReadsBatchTest) {
+  const auto path = CreateEmptyTestFile("yas_async_device_2d4c6e8a0b1f3d5c7e9a1b3d5f7a9c0e_2");
+  CheckReadsBatch(path, false);
+}
+
+TEST(AsyncFileDevice, ReadAfterEndTest) {
+  const auto path = CreateEmptyTestFile("yas_async_device_2d4c6e8a0b1f3d5c7e9a1b3d5f7a9c0e_3");
+  AsyncFileDeviceType device(path);
+
+  const ByteVector write_vector(0x10, '\x41');
+  device.Write(0, std::cbegin(write_vector), std::cend(write_vector));
+
+  ByteVector read_vector(0x20);
+  std::promise<bool> read_result;
+  device.SubmitReads({ { 0, read_vector.data(), static_cast<uint32_t>(read_vector.size()),
+      [&read_result](bool is_success) { read_result.set_value(is_success); } } });
+  EXPECT_FALSE(read_result.get_future().get());
+}
+
+TEST(AsyncFileDevice, CloseWithPendingReadsTest) {
+  const auto path = CreateEmptyTestFile("yas_async_device_2d4c6e8a0b1f3d5c7e9a1b3d5f7a9c0e_6");
+  const int32_t reads_count = 0x400;
+  const ByteVector write_vector(reads_count, '\x41');
+  for (const bool is_io_uring_allowed : { true, false }) {
+    AsyncFileDeviceType device(path, is_io_uring_allowed);
+    device.Write(0, std::cbegin(write_vector), std::cend(write_vector));
+
+    // reads are completed by Close, the ones submitted after it fail at once
+    ByteVector read_vector(reads_count);
+    std::atomic<int32_t> completed_count = 0;
+    std::vector<AsyncFileDeviceType::AsyncRead> reads;
+    for (int32_t read_id = 0; read_id < reads_count; ++read_id) {
+      reads.push_back({ static_cast<DOffsetType>(read_id), read_vector.data() + read_id, 1,
+          [&completed_count](bool is_success) { completed_count += is_success; } });
+    }
+    device.SubmitReads(std::move(reads));
+    device.Close();
+    EXPECT_EQ(reads_count, completed_count);
+    EXPECT_EQ(write_vector, read_vector);
+
+    bool is_failed = false;
+    device.SubmitReads({ { 0, read_vector.data(), 1, [&is_failed](bool is_success) { is_failed = !is_success; } } });
+    EXPECT_TRUE(is_failed);
+  }
+}
+
+TEST(AsyncFileDevice, PVManagerGetAsyncTest) {
+  using PVManagerType = storage::PVManager<DCharType, DOffsetType, AsyncFileDeviceType>;
+  const auto pv_path = fs::temp_directory_path() / "yas_async_device_2d4c6e8a0b1f3d5c7e9a1b3d5f7a9c0e_4";
+  fs::remove(pv_path);
+
+  // the blob is spread over several clusters, so it is read by a chain of submissions
+  ByteVector blob_value(kDefaultClusterSize * 5 + 0x100);
+  for (size_t byte_id = 0; byte_id < blob_value.size(); ++byte_id) {
+    blob_value[byte_id] = static_cast<uint8_t>(byte_id % 0xFB);
+  }
+  const std::string string_value("Welcome to YAS!");
+  const uint64_t numeric_value = 0x1122334455667788;
+  const int32_t small_value = -0x1234;
+
+  {
+    auto pv_manager = PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0);
+    EXPECT_TRUE(pv_manager->Put("/root/blob", blob_value));
+    EXPECT_TRUE(pv_manager->Put("/root/string", string_value));
+    EXPECT_TRUE(pv_manager->Put("/root/numeric", numeric_value));
+    EXPECT_TRUE(pv_manager->Put("/root/small", small_value));
+  }
+
+  auto pv_manager = PVManagerType::Load(pv_path, kMaximumSupportedVersion);
+  auto blob_future = pv_manager->GetAsync("/root/blob");
+  auto string_future = pv_manager->GetAsync("/root/string");
+  auto numeric_future = pv_manager->GetAsync("/root/numeric");
+  auto small_future = pv_manager->GetAsync("/root/small");
+  auto absent_future = pv_manager->GetAsync("/root/absent");
+
+  const auto blob_result = blob_future.get();
+  const auto string_result = string_future.get();
+  const auto numeric_result = numeric_future.get();
+  const auto small_result = small_future.get();
+  const auto absent_result = absent_future.get();
+  EXPECT_EQ(blob_value, std::get<ByteVector>(blob_result.value()));
+  EXPECT_EQ(string_value, std::get<std::string>(string_result.value()));
+  EXPECT_EQ(numeric_value, std::get<uint64_t>(numeric_result.value()));
+  EXPECT_EQ(small_value, std::get<int32_t>(small_result.value()));
+  EXPECT_EQ(storage::StorageError::kKeyNotFound, absent_result.error().error_code_);
+}
+
+TEST(AsyncFileDevice, PVManagerGetAsyncWithWritesTest) {
+  using PVManagerType = storage::PVManager<DCharType, DOffsetType, AsyncFileDeviceType>;
+  const auto pv_path = fs::temp_directory_path() / "yas_async_device_2d4c6e8a0b1f3d5c7e9a1b3d5f7a9c0e_5";
+  fs::remove(pv_path);
+
+  auto pv_manager = PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0);
+  const int32_t keys_count = 0x200;
+  std::vector<std::future<PVManagerType::get_result_type>> results;
+  for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+    const auto key = "/root/" + std::to_string(key_id);
+    EXPECT_TRUE(pv_manager->Put(key, std::string(key_id + 1, 'x')));
+    // writes wait for the previous async reads, so the entries couldn't be reused under them
+    results.push_back(pv_manager->GetAsync(key));
+    if (0 != key_id) {
+      EXPECT_TRUE(pv_manager->Delete("/root/" + std::to_string(key_id - 1)));
+    }
+  }
+
+  for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+    const auto result = results[key_id].get();
+    EXPECT_EQ(std::string(key_id + 1, 'x'), std::get<std::string>(result.value()));
+  }
+
+  EXPECT_TRUE(pv_manager->SetExpiredDate("/root/" + std::to_string(keys_count - 1), 1));
+  const auto expired_result = pv_manager->GetAsync("/root/" + std::to_string(keys_count - 1)).get();
+  EXPECT_EQ(storage::StorageError::kKeyNotFound, expired_result.error().error_code_);
+}
+
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include "storage/PVManager.hpp"
+#include "storage/lib/devices/CachedDevice.hpp"
+#include "storage/lib/devices/TestDevice.hpp"
+
+using namespace yas;
+
+namespace {
+
+constexpr uint32_t kTestPageSize = 0x10;
+using CachedTestDeviceType = devices::CachedDevice<devices::TestDevice<uint64_t>, kTestPageSize>;
+
+TEST(CachedDevice, WriteReadTest) {
+  CachedTestDeviceType device("/root");
+  EXPECT_TRUE(device.IsOpen());
+
+  const ByteVector write_vector = { '\x00', '\x01', '\x02', '\x04', '\x05' };
+  EXPECT_EQ(write_vector.size(), device.Write(0, std::cbegin(write_vector), std::cend(write_vector)));
+  EXPECT_EQ(write_vector.size(), device.Write(kTestPageSize - 2, std::cbegin(write_vector), std::cend(write_vector)));
+  EXPECT_EQ(kTestPageSize + 3, device.Size());
+
+  ByteVector read_vector(write_vector.size());
+  device.Read(kTestPageSize - 2, std::begin(read_vector), std::end(read_vector));
+  EXPECT_EQ(write_vector, read_vector);
+
+  ByteVector after_end_vector(write_vector.size());
+  EXPECT_THROW(device.Read(kTestPageSize, std::begin(after_end_vector), std::end(after_end_vector)),
+      exception::YASException);
+}
+
+TEST(CachedDevice, EvictionTest) {
+  // only two pages could be cached, so dirty pages are written back during writes
+  CachedTestDeviceType device("/root", kTestPageSize * 2);
+  EXPECT_EQ(kTestPageSize * 2, device.memory_budget());
+
+  const uint64_t pages_count = 0x40;
+  for (uint64_t page_id = 0; page_id < pages_count; ++page_id) {
+    const ByteVector page(kTestPageSize + 1, static_cast<uint8_t>(page_id));
+    device.Write(page_id * kTestPageSize, std::cbegin(page), std::cend(page));
+  }
+
+  for (uint64_t page_id = 0; page_id < pages_count; ++page_id) {
+    ByteVector page(kTestPageSize);
+    device.Read(page_id * kTestPageSize, std::begin(page), std::end(page));
+    EXPECT_EQ(ByteVector(kTestPageSize, static_cast<uint8_t>(page_id)), page);
+  }
+
+  ByteVector last_byte(1);
+  device.Read(pages_count * kTestPageSize, std::begin(last_byte), std::end(last_byte));
+  EXPECT_EQ(static_cast<uint8_t>(pages_count - 1), last_byte[0]);
+}
+
+TEST(CachedDevice, HitsMissesTest) {
+  CachedTestDeviceType device("/root", kTestPageSize * 4);
+
+  const ByteVector write_vector(kTestPageSize * 2, '\x41');
+  device.Write(0, std::cbegin(write_vector), std::cend(write_vector));
+  EXPECT_EQ(0, device.hits_count());
+  EXPECT_EQ(2, device.misses_count());
+
+  ByteVector read_vector(4);
+  for (int32_t read_id = 0; read_id < 10; ++read_id) {
+    device.Read(kTestPageSize - 2, std::begin(read_vector), std::end(read_vector));
+  }
+  EXPECT_EQ(20, device.hits_count());
+  EXPECT_EQ(2, device.misses_count());
+
+  // decreased budget drops all cached pages
+  device.memory_budget(kTestPageSize);
+  device.Read(0, std::begin(read_vector), std::end(read_vector));
+  EXPECT_EQ(3, device.misses_count());
+  EXPECT_EQ(ByteVector(4, '\x41'), read_vector);
+}
+
+TEST(CachedDevice, TruncateTest) {
+  CachedTestDeviceType device("/root", kTestPageSize * 4);
+  const ByteVector write_vector(kTestPageSize * 3, '\x41');
+  device.Write(0, std::cbegin(write_vector), std::cend(write_vector));
+
+  // dirty pages after the new end aren't written back, the rest of the last page is zeroed
+  device.Truncate(kTestPageSize + 2);
+  EXPECT_EQ(kTestPageSize + 2, device.Size());
+  device.Flush();
+  ByteVector read_vector(4);
+  EXPECT_THROW(device.Read(kTestPageSize, std::begin(read_vector), std::end(read_vector)), exception::YASException);
+
+  const ByteVector tail_vector(1, '\x42');
+  device.Write(kTestPageSize * 2, std::cbegin(tail_vector), std::cend(tail_vector));
+  device.Read(kTestPageSize, std::begin(read_vector), std::end(read_vector));
+  EXPECT_EQ(ByteVector({ '\x41', '\x41', '\x00', '\x00' }), read_vector);
+  ByteVector gap_vector(3);
+  device.Read(kTestPageSize * 2 - 2, std::begin(gap_vector), std::end(gap_vector));
+  EXPECT_EQ(ByteVector({ '\x00', '\x00', '\x42' }), gap_vector);
+}
+
+TEST(CachedDevice, PVManagerPutGetReloadTest) {
+  using CachedFileDeviceType = devices::CachedDevice<devices::FileDevice<DOffsetType>>;
+  using PVManagerType = storage::PVManager<DCharType, DOffsetType, CachedFileDeviceType>;
+  const auto pv_path = fs::temp_directory_path() / "yas_cached_device_7f3a9c1e5b2d4f6a8c0e2b4d6f8a1c3e_1";
+  fs::remove(pv_path);
+
+  const ByteVector blob_value(kDefaultClusterSize * 3, '\x43');
+  const std::string string_value("Welcome to YAS!");
+  const uint64_t numeric_value = 0x1122334455667788;
+
+  {
+    auto pv_manager = PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0);
+    EXPECT_TRUE(pv_manager->Put("/root/blob", blob_value));
+    EXPECT_TRUE(pv_manager->Put("/root/string", string_value));
+    EXPECT_TRUE(pv_manager->Put("/root/numeric", numeric_value));
+  }
+
+  auto pv_manager = PVManagerType::Load(pv_path, kMaximumSupportedVersion);
+  const auto blob_result = pv_manager->Get("/root/blob");
+  const auto string_result = pv_manager->Get("/root/string");
+  const auto numeric_result = pv_manager->Get("/root/numeric");
+  EXPECT_EQ(blob_value, std::get<ByteVector>(blob_result.value()));
+  EXPECT_EQ(string_value, std::get<std::string>(string_result.value()));
+  EXPECT_EQ(numeric_value, std::get<uint64_t>(numeric_result.value()));
+}
+
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include "storage/PVManager.hpp"
+#include "storage/lib/devices/CachedDevice.hpp"
+#include "storage/lib/devices/DirectFileDevice.hpp"
+
+using namespace yas;
+
+namespace {
+
+using DirectFileDeviceType = devices::DirectFileDevice<DOffsetType>;
+constexpr DOffsetType kBlockSize = DirectFileDeviceType::kBlockSize;
+
+fs::path CreateEmptyTestFile(const std::string &name) {
+  const auto path = fs::temp_directory_path() / name;
+  fs::remove(path);
+  DirectFileDeviceType::CreateEmpty(path);
+  return path;
+}
+
+TEST(DirectFileDevice, UnalignedWriteReadTest) {
+  const auto path = CreateEmptyTestFile("yas_direct_device_9e1b3d5f7a2c4e6a8b0d2f4a6c8e0b1d_1");
+  DirectFileDeviceType device(path);
+  EXPECT_TRUE(device.IsOpen());
+
+  const ByteVector write_vector = { '\x00', '\x01', '\x02', '\x04', '\x05' };
+  EXPECT_EQ(write_vector.size(), device.Write(0, std::cbegin(write_vector), std::cend(write_vector)));
+  // crosses the block boundary
+  EXPECT_EQ(write_vector.size(), device.Write(kBlockSize - 2, std::cbegin(write_vector), std::cend(write_vector)));
+  EXPECT_EQ(kBlockSize + 3, device.Size());
+
+  ByteVector read_vector(write_vector.size());
+  device.Read(0, std::begin(read_vector), std::end(read_vector));
+  EXPECT_EQ(write_vector, read_vector);
+  device.Read(kBlockSize - 2, std::begin(read_vector), std::end(read_vector));
+  EXPECT_EQ(write_vector, read_vector);
+
+  ByteVector after_end_vector(0x10);
+  EXPECT_THROW(device.Read(kBlockSize, std::begin(after_end_vector), std::end(after_end_vector)),
+      exception::YASException);
+}
+
+TEST(DirectFileDevice, EdgeBlocksPreservedTest) {
+  const auto path = CreateEmptyTestFile("yas_direct_device_9e1b3d5f7a2c4e6a8b0d2f4a6c8e0b1d_2");
+  const ByteVector background(kBlockSize * 20 + 0x123, '\x41');
+  const ByteVector big_vector(kBlockSize * 17 + 0x10, '\x42');
+  const DOffsetType big_vector_position = kBlockSize + 0x77;
+
+  {
+    DirectFileDeviceType device(path);
+    device.Write(0, std::cbegin(background), std::cend(background));
+    // bigger than the bounce buffer with unaligned both edges
+    device.Write(big_vector_position, std::cbegin(big_vector), std::cend(big_vector));
+  }
+
+  // the last block should be truncated to the logical size during close
+  EXPECT_EQ(background.size(), fs::file_size(path));
+
+  ByteVector expected_vector = background;
+  std::copy(std::cbegin(big_vector), std::cend(big_vector), std::begin(expected_vector) + big_vector_position);
+  DirectFileDeviceType device(path);
+  ByteVector read_vector(background.size());
+  device.Read(0, std::begin(read_vector), std::end(read_vector));
+  EXPECT_EQ(expected_vector, read_vector);
+}
+
+TEST(DirectFileDevice, RecommendedClusterSizeTest) {
+  EXPECT_EQ(kBlockSize, DirectFileDeviceType::RecommendedClusterSize(kDefaultClusterSize));
+  EXPECT_EQ(kBlockSize * 2, DirectFileDeviceType::RecommendedClusterSize(kBlockSize * 2));
+  EXPECT_EQ(kDefaultClusterSize, devices::FileDevice<DOffsetType>::RecommendedClusterSize(kDefaultClusterSize));
+}
+
+TEST(DirectFileDevice, PVManagerPutGetReloadTest) {
+  // the page cache is replaced by the cache with the fixed memory budget
+  using CachedDirectDeviceType = devices::CachedDevice<DirectFileDeviceType>;
+  using PVManagerType = storage::PVManager<DCharType, DOffsetType, CachedDirectDeviceType>;
+  const auto pv_path = fs::temp_directory_path() / "yas_direct_device_9e1b3d5f7a2c4e6a8b0d2f4a6c8e0b1d_3";
+  fs::remove(pv_path);
+
+  // the value that fills exactly the whole block-aligned cluster
+  const ByteVector blob_value(kBlockSize * 3, '\x43');
+  const std::string string_value("Welcome to YAS!");
+  const uint64_t numeric_value = 0x1122334455667788;
+
+  {
+    auto pv_manager = PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0);
+    EXPECT_TRUE(pv_manager->Put("/root/blob", blob_value));
+    EXPECT_TRUE(pv_manager->Put("/root/string", string_value));
+    EXPECT_TRUE(pv_manager->Put("/root/numeric", numeric_value));
+  }
+
+  auto pv_manager = PVManagerType::Load(pv_path, kMaximumSupportedVersion);
+  const auto blob_result = pv_manager->Get("/root/blob");
+  const auto string_result = pv_manager->Get("/root/string");
+  const auto numeric_result = pv_manager->Get("/root/numeric");
+  EXPECT_EQ(blob_value, std::get<ByteVector>(blob_result.value()));
+  EXPECT_EQ(string_value, std::get<std::string>(string_result.value()));
+  EXPECT_EQ(numeric_value, std::get<uint64_t>(numeric_result.value()));
+
+  // the loaded PV uses its own cluster size instead of the default one
+  EXPECT_TRUE(pv_manager->Put("/root/blob2", blob_value));
+  const auto blob2_result = pv_manager->Get("/root/blob2");
+  EXPECT_EQ(blob_value, std::get<ByteVector>(blob2_result.value()));
+}
+
+}
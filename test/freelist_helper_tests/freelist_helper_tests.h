@@ -1,5 +1,9 @@
 #pragma once
 #include "storage/lib/physical_volume/FreelistHelper.hpp"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <map>
 #include <iostream>
 
 using namespace yas::freelist_helper;
@@ -15,6 +19,214 @@ TEST(FreelistHelper, BasicPushPopTest) {
     helper.PushFreeEntry(bin_id * 0x10101010, FreelistHelperType::kFreelistLimits[bin_id] - 5);
     EXPECT_EQ(helper.PopFreeEntryOffset(FreelistHelperType::kFreelistLimits[bin_id] - 5), bin_id * 0x10101010);
   }
+  EXPECT_EQ(0, helper.entries_count());
+  EXPECT_EQ(0, helper.free_size());
+}
+
+TEST(FreelistHelper, BestFitTest) {
+  FreelistHelperType helper;
+  helper.PushFreeEntry(0x1000, 200);
+  helper.PushFreeEntry(0x2000, 120);
+  helper.PushFreeEntry(0x3000, 16);
+  helper.PushFreeEntry(0x4000, 5000);
+  EXPECT_EQ(5336, helper.free_size());
+
+  // the smallest entry that fits is taken even from the next bins
+  EXPECT_EQ(0x2000, helper.PopFreeEntryOffset(110));
+  EXPECT_EQ(0x1000, helper.PopFreeEntryOffset(110));
+  EXPECT_EQ(0x4000, helper.PopFreeEntryOffset(110));
+  EXPECT_FALSE(yas::offset_traits<yas::DOffsetType>::IsExistValue(helper.PopFreeEntryOffset(110)));
+
+  // the biggest entry is taken if it isn't smaller than the minimum size
+  helper.PushFreeEntry(0x5000, 3000);
+  EXPECT_FALSE(yas::offset_traits<yas::DOffsetType>::IsExistValue(helper.PopFreeEntry(8000, 4000).first));
+  const auto [offset, entry_size] = helper.PopFreeEntry(8000, 2000);
+  EXPECT_EQ(0x5000, offset);
+  EXPECT_EQ(3000, entry_size);
+  EXPECT_EQ(0x3000, helper.PopFreeEntryOffset(12));
+}
+
+TEST(FreelistHelper, SerializationTest) {
+  FreelistHelperType helper;
+  for (yas::DOffsetType entry_id = 0; entry_id < 1000; ++entry_id) {
+    helper.PushFreeEntry(entry_id * 0x10000 + entry_id, 12 + entry_id * 7);
+  }
+
+  const auto serialized_index = helper.Serialize();
+  EXPECT_GT(helper.entries_count() * 2 * sizeof(yas::DOffsetType), serialized_index.size());
+
+  FreelistHelperType loaded_helper;
+  loaded_helper.Deserialize(std::cbegin(serialized_index), std::cend(serialized_index));
+  EXPECT_EQ(helper.entries_count(), loaded_helper.entries_count());
+  EXPECT_EQ(helper.free_size(), loaded_helper.free_size());
+  EXPECT_EQ(serialized_index, loaded_helper.Serialize());
+
+  const yas::ByteVector corrupted_index = { 0x80, 0x80 };
+  EXPECT_THROW(loaded_helper.Deserialize(std::cbegin(corrupted_index), std::cend(corrupted_index)),
+      yas::exception::YASException);
+}
+
+TEST(FreelistHelper, CoalescingTest) {
+  FreelistHelperType helper;
+  helper.PushFreeEntry(0x1000, 0x100);
+  helper.PushFreeEntry(0x1200, 0x100);
+  EXPECT_EQ(2, helper.entries_count());
+
+  // the entry between two free entries merges them into one
+  helper.PushFreeEntry(0x1100, 0x100);
+  EXPECT_EQ(1, helper.entries_count());
+  EXPECT_EQ(0x300, helper.free_size());
+
+  // small tails are merged too and the entry that overlaps the free space is ignored
+  helper.PushFreeEntry(0x1300, 4);
+  helper.PushFreeEntry(0x1280, 0x100);
+  EXPECT_EQ(1, helper.entries_count());
+  EXPECT_EQ(0x304, helper.free_size());
+
+  const auto [offset, entry_size] = helper.PopFreeEntry(0x304, 0x304);
+  EXPECT_EQ(0x1000, offset);
+  EXPECT_EQ(0x304, entry_size);
+  EXPECT_EQ(0, helper.entries_count());
+}
+
+TEST(FreelistHelper, FirstFitTest) {
+  FreelistHelperType helper;
+  helper.fit_policy(FitPolicy::kFirstFit);
+  helper.PushFreeEntry(0x8000, 120);
+  helper.PushFreeEntry(0x3000, 3000);
+  helper.PushFreeEntry(0x1000, 200);
+  helper.PushFreeEntry(0x2000, 16);
+
+  // the entry with the lowest offset that fits is taken instead of the smallest one
+  EXPECT_EQ(0x1000, helper.PopFreeEntryOffset(110));
+  EXPECT_EQ(0x3000, helper.PopFreeEntryOffset(110));
+  EXPECT_EQ(0x2000, helper.PopFreeEntryOffset(12));
+  const auto [offset, entry_size] = helper.PopFreeEntry(8000, 100);
+  EXPECT_EQ(0x8000, offset);
+  EXPECT_EQ(120, entry_size);
+
+  // entries pushed before the policy is switched are found too, smaller entries of the own bin are skipped
+  FreelistHelperType switched_helper;
+  switched_helper.PushFreeEntry(0x1000, 104);
+  switched_helper.PushFreeEntry(0x2000, 120);
+  switched_helper.PushFreeEntry(0x4000, 1000);
+  switched_helper.PushFreeEntry(0x6000, 108);
+  switched_helper.fit_policy(FitPolicy::kFirstFit);
+  EXPECT_EQ(0x2000, switched_helper.PopFreeEntryOffset(110));
+  EXPECT_EQ(0x4000, switched_helper.PopFreeEntryOffset(110));
+  switched_helper.fit_policy(FitPolicy::kBestFit);
+  EXPECT_EQ(0x6000, switched_helper.PopFreeEntryOffset(106));
+  EXPECT_EQ(0x1000, switched_helper.PopFreeEntryOffset(100));
+}
+
+TEST(FreelistHelper, LowerAndTailEntriesTest) {
+  FreelistHelperType helper;
+  helper.PushFreeEntry(0x1000, 100);
+  helper.PushFreeEntry(0x2000, 300);
+  helper.PushFreeEntry(0x3000, 0x1000);
+
+  // the lowest fitting entry is taken even if it isn't the best fit
+  EXPECT_FALSE(yas::offset_traits<yas::DOffsetType>::IsExistValue(helper.PopLowerFreeEntry(200, 0x2000).first));
+  const auto lower_entry = helper.PopLowerFreeEntry(50, 0x2000);
+  EXPECT_EQ(0x1000, lower_entry.first);
+  EXPECT_EQ(100, lower_entry.second);
+
+  EXPECT_EQ(0, helper.GetTailFreeSize(0x5000));
+  EXPECT_EQ(0x1000, helper.GetTailFreeSize(0x4000));
+  EXPECT_FALSE(yas::offset_traits<yas::DOffsetType>::IsExistValue(helper.PopTailFreeEntry(0x5000).first));
+  const auto tail_entry = helper.PopTailFreeEntry(0x4000);
+  EXPECT_EQ(0x3000, tail_entry.first);
+  EXPECT_EQ(0x1000, tail_entry.second);
+  EXPECT_EQ(300, helper.free_size());
+}
+
+TEST(FreelistHelper, LimitsTest) {
+  EXPECT_EQ(FreelistHelperType::kFreelistLimits, FreelistHelperType::DefaultLimits(yas::kDefaultClusterSize));
+  const auto big_cluster_limits = FreelistHelperType::DefaultLimits(0x10000);
+  EXPECT_EQ(12, big_cluster_limits.front());
+  EXPECT_EQ(16, big_cluster_limits[1]);
+  EXPECT_EQ(0x10000, big_cluster_limits.back());
+  EXPECT_TRUE(std::is_sorted(std::cbegin(big_cluster_limits), std::cend(big_cluster_limits)));
+  EXPECT_THROW(FreelistHelperType::DeriveLimits({}, 32), yas::exception::YASException);
+
+  // most of limits are placed around often sizes
+  const std::map<yas::DOffsetType, uint64_t> sizes_histogram = { { 12, 100 }, { 40, 300 }, { 48, 300 }, { 56, 300 },
+      { 300, 50 }, { 3000, 10 } };
+  const auto derived_limits = FreelistHelperType::DeriveLimits(sizes_histogram, yas::kDefaultClusterSize);
+  EXPECT_EQ(yas::kDefaultClusterSize, derived_limits.back());
+  EXPECT_TRUE(std::adjacent_find(std::cbegin(derived_limits), std::cend(derived_limits),
+      std::greater_equal<yas::DOffsetType>()) == std::cend(derived_limits));
+  EXPECT_NE(std::cend(derived_limits), std::find(std::cbegin(derived_limits), std::cend(derived_limits), 40));
+  EXPECT_NE(std::cend(derived_limits), std::find(std::cbegin(derived_limits), std::cend(derived_limits), 48));
+
+  // entries are moved to the new bins, so they are found by new limits
+  FreelistHelperType helper;
+  helper.PushFreeEntry(0x1000, 44);
+  helper.PushFreeEntry(0x2000, 400);
+  helper.limits(derived_limits);
+  EXPECT_EQ(derived_limits, helper.limits());
+  EXPECT_EQ(0x1000, helper.PopFreeEntryOffset(42));
+  EXPECT_EQ(0x2000, helper.PopFreeEntryOffset(300));
+
+  auto invalid_limits = derived_limits;
+  invalid_limits[3] = invalid_limits[2];
+  EXPECT_THROW(helper.limits(invalid_limits), yas::exception::YASException);
+  invalid_limits[3] = invalid_limits[2] + 1;
+  EXPECT_THROW(helper.limits(invalid_limits), yas::exception::YASException);
+  EXPECT_EQ(derived_limits, helper.limits());
+
+  const auto serialized_limits = helper.SerializeLimits();
+  EXPECT_EQ(derived_limits, FreelistHelperType::DeserializeLimits(std::cbegin(serialized_limits),
+      std::cend(serialized_limits)));
+  EXPECT_THROW(FreelistHelperType::DeserializeLimits(std::cbegin(serialized_limits),
+      std::prev(std::cend(serialized_limits))), yas::exception::YASException);
+}
+
+// allocates and frees entries of pseudo-random sizes like PVEntriesManager does (the rest of the free entry goes
+// back), returns the count of operations per second
+int64_t MeasureAllocationWorkload(FitPolicy fit_policy, int32_t entries_count, int32_t operations_count) {
+  FreelistHelperType helper;
+  helper.fit_policy(fit_policy);
+  uint32_t random_state = 42;
+  auto next_size = [&random_state]() {
+    random_state = random_state * 1103515245 + 12345;
+    return static_cast<yas::DOffsetType>(12 + (random_state >> 16) % 500);
+  };
+
+  std::vector<std::pair<yas::DOffsetType, yas::DOffsetType>> allocated;
+  yas::DOffsetType device_end = 0;
+  const auto start_time = std::chrono::steady_clock::now();
+  for (int32_t operation_id = 0; operation_id < operations_count; ++operation_id) {
+    if (static_cast<int32_t>(allocated.size()) < entries_count || (random_state & 0x100)) {
+      const auto entry_size = next_size();
+      auto [offset, free_size] = helper.PopFreeEntry(entry_size, entry_size);
+      if (!yas::offset_traits<yas::DOffsetType>::IsExistValue(offset)) {
+        offset = device_end;
+        free_size = entry_size;
+        device_end += entry_size;
+      }
+      helper.PushFreeEntry(offset + entry_size, free_size - entry_size);
+      allocated.emplace_back(offset, entry_size);
+    }
+    else {
+      const auto entry_id = next_size() * 7919 % allocated.size();
+      helper.PushFreeEntry(allocated[entry_id].first, allocated[entry_id].second);
+      allocated[entry_id] = allocated.back();
+      allocated.pop_back();
+    }
+  }
+
+  const auto finish_time = std::chrono::steady_clock::now();
+  const auto elapsed_time = std::chrono::duration_cast<std::chrono::microseconds>(finish_time - start_time).count();
+  return static_cast<int64_t>(operations_count) * 1000000 / std::max<int64_t>(elapsed_time, 1);
+}
+
+TEST(FreelistHelper, DISABLED_AllocationBenchmark) {
+  const int32_t entries_count = 10000;
+  const int32_t operations_count = 500000;
+  std::cout << "Allocations and frees per second: best fit - "
+      << MeasureAllocationWorkload(FitPolicy::kBestFit, entries_count, operations_count) << ", first fit - "
+      << MeasureAllocationWorkload(FitPolicy::kFirstFit, entries_count, operations_count) << std::endl;
 }
 
 }
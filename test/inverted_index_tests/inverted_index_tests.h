@@ -2,6 +2,10 @@
 #include "gtest/gtest.h"
 #include "storage/lib/inverted_index/InvertedIndexHelper.hpp"
 #include "storage/lib/utils/Version.hpp"
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
 
 namespace {
 
@@ -172,4 +176,177 @@ TEST(InvertedIndexHelper, IsChangedTest) {
   EXPECT_TRUE(helper_2->is_changed());
 }
 
-}
\ No newline at end of file
+TEST(InvertedIndexHelper, EnginesSerializationTest) {
+  // both engines are saved in the same format, so the index could be loaded by another engine
+  using TreeIndexHelper = yas::index_helper::InvertedIndexHelper<char, uint64_t,
+      yas::index_helper::AdaptiveRadixTreeEngine<char, uint64_t>>;
+  const std::vector<std::string> keys = { "/root", "/root/aa1", "/root/aa1/bb1", "/root/aa2", "/home/user1/file1",
+      "/home/user1/file2", "/home/user2", "/tmp/a", "/tmp/b", "/tmp/c", "/tmp/d", "/tmp/e", "/tmp/f" };
+  TreeIndexHelper tree_helper;
+  for (size_t key_id = 0; key_id < keys.size(); ++key_id) {
+    tree_helper.Insert(keys[key_id], key_id);
+  }
+  tree_helper.Delete("/tmp/c");
+
+  yas::utils::Version version(1, 1);
+  const auto serialized_tree = tree_helper.Serialize<uint32_t>(version);
+  const auto trie_helper = IndexHelper::Deserialize<uint32_t>(std::cbegin(serialized_tree),
+      std::cend(serialized_tree), version);
+  const auto serialized_trie = trie_helper->Serialize<uint32_t>(version);
+  const auto loaded_tree_helper = TreeIndexHelper::Deserialize<uint32_t>(std::cbegin(serialized_trie),
+      std::cend(serialized_trie), version);
+  for (size_t key_id = 0; key_id < keys.size(); ++key_id) {
+    const uint64_t expected_leaf = ("/tmp/c" == keys[key_id]) ?
+        yas::index_helper::leaf_type_traits<uint64_t>::NonExistValue() : key_id;
+    EXPECT_EQ(expected_leaf, trie_helper->Get(keys[key_id]));
+    EXPECT_EQ(expected_leaf, loaded_tree_helper->Get(keys[key_id]));
+  }
+  EXPECT_FALSE(loaded_tree_helper->HasKey("/root/aa"));
+  EXPECT_EQ(8, loaded_tree_helper->FindMaxSubKey("/root/aa3"));
+}
+
+
+TEST(InvertedIndexHelper, FlatIndexTest) {
+  using TreeIndexHelper = yas::index_helper::InvertedIndexHelper<char, uint64_t,
+      yas::index_helper::AdaptiveRadixTreeEngine<char, uint64_t>>;
+  const std::vector<std::string> keys = { "/root", "/root/aa1", "/root/aa1/bb1", "/root/aa2", "/home/user1/file1",
+      "/home/user1/file2", "/home/user2", "/tmp/a", "/tmp/b", "/tmp/c", "/tmp/d", "/tmp/e", "/tmp/f", "/tmp/g",
+      "/tmp/h", "/tmp/i", "/tmp/j", "/tmp/k", "/tmp/l", "/tmp/m", "/tmp/n", "/tmp/o", "/tmp/p", "/tmp/q", "/tmp/r" };
+  IndexHelper trie_helper;
+  TreeIndexHelper tree_helper;
+  for (size_t key_id = 0; key_id < keys.size(); ++key_id) {
+    trie_helper.Insert(keys[key_id], key_id);
+    tree_helper.Insert(keys[key_id], key_id);
+  }
+  trie_helper.Delete("/tmp/c");
+  tree_helper.Delete("/tmp/c");
+
+  // both engines are saved to the same flat trie
+  const yas::utils::Version version(1, 5);
+  const auto serialized_trie = trie_helper.SerializeFlat(version);
+  EXPECT_EQ(serialized_trie, tree_helper.SerializeFlat(version));
+
+  auto flat_helper = IndexHelper::Open({ serialized_trie, version });
+  auto flat_tree_helper = TreeIndexHelper::Open({ serialized_trie, version });
+  EXPECT_TRUE(flat_helper->is_flat());
+  EXPECT_FALSE(flat_helper->is_changed());
+  for (size_t key_id = 0; key_id < keys.size(); ++key_id) {
+    const uint64_t expected_leaf = ("/tmp/c" == keys[key_id]) ?
+        yas::index_helper::leaf_type_traits<uint64_t>::NonExistValue() : key_id;
+    EXPECT_EQ(expected_leaf, flat_helper->Get(keys[key_id]));
+  }
+  EXPECT_FALSE(flat_helper->HasKey("/root/aa"));
+  EXPECT_FALSE(flat_helper->HasKey("/tmp/z"));
+  EXPECT_EQ(8, flat_helper->FindMaxSubKey("/root/aa3"));
+  EXPECT_EQ(0, flat_helper->FindMaxSubKey("root"));
+  size_t leaves_count = 0;
+  flat_helper->VisitLeaves([&leaves_count](uint64_t) { ++leaves_count; });
+  EXPECT_EQ(keys.size() - 1, leaves_count);
+
+  // changes are kept aside of the flat trie until the engine is built from it
+  EXPECT_TRUE(flat_helper->Insert("/tmp/c", 100));
+  EXPECT_TRUE(flat_tree_helper->Delete("/tmp/d"));
+  EXPECT_TRUE(flat_helper->is_flat());
+  EXPECT_TRUE(flat_helper->is_changed());
+  EXPECT_FALSE(flat_tree_helper->Delete("/tmp/z"));
+  EXPECT_TRUE(flat_tree_helper->Insert("/var/log/app", 200));
+  EXPECT_EQ(12, flat_tree_helper->FindMaxSubKey("/var/log/app/1"));
+  EXPECT_EQ(200, flat_tree_helper->Get("/var/log/app"));
+  leaves_count = 0;
+  flat_tree_helper->VisitLeaves([&leaves_count](uint64_t) { ++leaves_count; });
+  EXPECT_EQ(keys.size() - 1, leaves_count);
+  flat_helper->Materialize();
+  flat_tree_helper->Materialize();
+  EXPECT_FALSE(flat_helper->is_flat());
+  EXPECT_FALSE(flat_tree_helper->is_flat());
+  for (size_t key_id = 0; key_id < keys.size(); ++key_id) {
+    EXPECT_EQ(("/tmp/c" == keys[key_id]) ? 100 : key_id, flat_helper->Get(keys[key_id]));
+    EXPECT_EQ("/tmp/c" != keys[key_id] && "/tmp/d" != keys[key_id], flat_tree_helper->HasKey(keys[key_id]));
+  }
+  EXPECT_EQ(200, flat_tree_helper->Get("/var/log/app"));
+
+  // the data isn't trusted
+  EXPECT_THROW(IndexHelper::Open({ yas::ByteVector(serialized_trie.begin(), serialized_trie.end() - 1), version }),
+      yas::exception::YASException);
+  EXPECT_THROW(IndexHelper::Open({ serialized_trie, yas::utils::Version(1, 4) }), yas::exception::YASException);
+  auto corrupted_trie = serialized_trie;
+  // the first child of the root refers to the root itself
+  std::fill_n(std::begin(corrupted_trie) + sizeof(yas::index_helper::flat_trie_headers::FlatTrieHeader) +
+      sizeof(uint64_t), sizeof(uint32_t), 0);
+  auto corrupted_helper = IndexHelper::Open({ corrupted_trie, version });
+  EXPECT_FALSE(corrupted_helper->HasKey("/root"));
+  EXPECT_THROW(corrupted_helper->Materialize(), yas::exception::YASException);
+}
+
+TEST(InvertedIndexHelper, IndexLogTest) {
+  using IndexLog = yas::index_helper::IndexLogHelper<char, uint64_t>;
+  const auto non_exist_value = yas::index_helper::leaf_type_traits<uint64_t>::NonExistValue();
+  const yas::utils::Version version(1, 6);
+
+  // changes are logged only if it is switched on, failed deletes aren't logged
+  IndexHelper helper;
+  helper.Insert("/root/aa1", 1);
+  helper.log_changes(true);
+  helper.Insert("/root/aa2", 2);
+  helper.Insert("/root/aa1", 3);
+  EXPECT_TRUE(helper.Delete("/root/aa2"));
+  EXPECT_FALSE(helper.Delete("/tmp"));
+  const std::vector<IndexHelper::change_type> expected_changes = { { "/root/aa2", 2 }, { "/root/aa1", 3 },
+      { "/root/aa2", non_exist_value } };
+  EXPECT_EQ(expected_changes, helper.changes());
+
+  const auto serialized_log = IndexLog::Serialize(helper.changes(), 100, version);
+  EXPECT_TRUE(IndexLog::IsIndexLog(serialized_log.data(), serialized_log.size()));
+  std::vector<IndexHelper::change_type> changes;
+  EXPECT_EQ(100, IndexLog::Deserialize(serialized_log.data(), serialized_log.size(), version, changes));
+  EXPECT_EQ(expected_changes, changes);
+  helper.ClearChanges();
+  EXPECT_TRUE(helper.changes().empty());
+  EXPECT_FALSE(helper.is_changed());
+
+  // changes are replayed over the flat index
+  IndexHelper base_helper;
+  base_helper.Insert("/root/aa1", 1);
+  base_helper.Insert("/root/aa2", 1);
+  auto flat_helper = IndexHelper::Open({ base_helper.SerializeFlat(version), version });
+  flat_helper->ApplyChanges(changes);
+  EXPECT_FALSE(flat_helper->is_changed());
+  EXPECT_EQ(3, flat_helper->Get("/root/aa1"));
+  EXPECT_FALSE(flat_helper->HasKey("/root/aa2"));
+
+  // the data isn't trusted
+  EXPECT_THROW(IndexLog::Deserialize(serialized_log.data(), serialized_log.size() - 1, version, changes),
+      yas::exception::YASException);
+  EXPECT_THROW(IndexLog::Deserialize(serialized_log.data(), serialized_log.size(), yas::utils::Version(1, 5),
+      changes), yas::exception::YASException);
+  EXPECT_FALSE(IndexLog::IsIndexLog(serialized_log.data(), 4));
+}
+
+TEST(InvertedIndexHelper, DISABLED_FlatIndexOpenBenchmark) {
+  IndexHelper helper;
+  const int32_t keys_count = 200000;
+  for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+    helper.Insert("/tenant-" + std::to_string(key_id % 10) + "/host-" + std::to_string(key_id) + "/cpu.user", key_id);
+  }
+
+  const yas::utils::Version version(1, 5);
+  const auto serialized_index = helper.Serialize<uint64_t>(version);
+  auto start_time = std::chrono::steady_clock::now();
+  const auto loaded_helper = IndexHelper::Deserialize<uint64_t>(std::cbegin(serialized_index),
+      std::cend(serialized_index), version);
+  const auto deserialize_time = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start_time).count();
+
+  auto serialized_flat_index = helper.SerializeFlat(version);
+  start_time = std::chrono::steady_clock::now();
+  const auto flat_helper = IndexHelper::Open({ std::move(serialized_flat_index), version });
+  const auto open_time = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start_time).count();
+
+  EXPECT_TRUE(loaded_helper->HasKey("/tenant-7/host-1237/cpu.user"));
+  EXPECT_TRUE(flat_helper->HasKey("/tenant-7/host-1237/cpu.user"));
+  std::cout << keys_count << " keys: deserialization - " << deserialize_time << " us, flat index open - "
+      << open_time << " us" << std::endl;
+}
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "storage/lib/devices/MappedFileDevice.hpp"
+#include "storage/PVManager.hpp"
+
+using namespace yas;
+
+namespace {
+
+using MappedFileDeviceType = devices::MappedFileDevice<DOffsetType>;
+
+fs::path CreateEmptyTestFile(const std::string &name) {
+  const auto path = fs::temp_directory_path() / name;
+  fs::remove(path);
+  MappedFileDeviceType::CreateEmpty(path);
+  return path;
+}
+
+TEST(MappedFileDevice, WriteReadTest) {
+  const auto path = CreateEmptyTestFile("yas_mapped_device_e1c3f0a2f1b95c4d4d2a7e0b3c9d6a11_1");
+  MappedFileDeviceType device(path);
+  EXPECT_TRUE(device.IsOpen());
+
+  const ByteVector write_vector = { '\x00', '\x01', '\x02', '\x04', '\x05' };
+  EXPECT_EQ(write_vector.size(), device.Write(0, std::cbegin(write_vector), std::cend(write_vector)));
+
+  ByteVector read_vector(write_vector.size());
+  device.Read(0, std::begin(read_vector), std::end(read_vector));
+  EXPECT_EQ(write_vector, read_vector);
+}
+
+TEST(MappedFileDevice, ReadAfterEndTest) {
+  const auto path = CreateEmptyTestFile("yas_mapped_device_e1c3f0a2f1b95c4d4d2a7e0b3c9d6a11_2");
+  MappedFileDeviceType device(path);
+
+  const ByteVector write_vector(0x10, '\x41');
+  device.Write(0, std::cbegin(write_vector), std::cend(write_vector));
+
+  ByteVector read_vector(0x20);
+  EXPECT_THROW(device.Read(0, std::begin(read_vector), std::end(read_vector)), exception::YASException);
+}
+
+TEST(MappedFileDevice, ExpandAndReopenTest) {
+  const auto path = CreateEmptyTestFile("yas_mapped_device_e1c3f0a2f1b95c4d4d2a7e0b3c9d6a11_3");
+  const ByteVector write_vector(0x1000, '\x42');
+  const DOffsetType writes_count = 0x400;     // 4 Mb - several remappings
+
+  {
+    MappedFileDeviceType device(path);
+    for (DOffsetType write_id = 0; write_id < writes_count; ++write_id) {
+      device.Write(write_id * write_vector.size(), std::cbegin(write_vector), std::cend(write_vector));
+    }
+  }
+
+  // the preallocated tail should be truncated during close
+  EXPECT_EQ(writes_count * write_vector.size(), fs::file_size(path));
+
+  MappedFileDeviceType device(path);
+  ByteVector read_vector(write_vector.size());
+  device.Read((writes_count - 1) * write_vector.size(), std::begin(read_vector), std::end(read_vector));
+  EXPECT_EQ(write_vector, read_vector);
+}
+
+TEST(MappedFileDevice, PVManagerPutGetReloadTest) {
+  using PVManagerType = storage::PVManager<DCharType, DOffsetType, MappedFileDeviceType>;
+  const auto pv_path = fs::temp_directory_path() / "yas_mapped_device_e1c3f0a2f1b95c4d4d2a7e0b3c9d6a11_4";
+  fs::remove(pv_path);
+
+  const ByteVector blob_value(0x1000 * 3, '\x43');
+  const std::string string_value("Welcome to YAS!");
+  const uint64_t numeric_value = 0x1122334455667788;
+
+  {
+    auto pv_manager = PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0);
+    EXPECT_TRUE(pv_manager->Put("/root/blob", blob_value));
+    EXPECT_TRUE(pv_manager->Put("/root/string", string_value));
+    EXPECT_TRUE(pv_manager->Put("/root/numeric", numeric_value));
+  }
+
+  auto pv_manager = PVManagerType::Load(pv_path, kMaximumSupportedVersion);
+  const auto blob_result = pv_manager->Get("/root/blob");
+  const auto string_result = pv_manager->Get("/root/string");
+  const auto numeric_result = pv_manager->Get("/root/numeric");
+  EXPECT_EQ(blob_value, std::get<ByteVector>(blob_result.value()));
+  EXPECT_EQ(string_value, std::get<std::string>(string_result.value()));
+  EXPECT_EQ(numeric_value, std::get<uint64_t>(numeric_result.value()));
+}
+
+}
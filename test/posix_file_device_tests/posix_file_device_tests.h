@@ -0,0 +1,136 @@
+#pragma once
+#include "storage/lib/devices/PosixFileDevice.hpp"
+#include <thread>
+#include <vector>
+
+using namespace yas;
+
+namespace {
+
+using PosixFileDeviceType = devices::PosixFileDevice<uint64_t>;
+
+fs::path CreateEmptyTestFile(const std::string &name) {
+  const auto path = fs::temp_directory_path() / name;
+  fs::remove(path);
+  PosixFileDeviceType::CreateEmpty(path);
+  return path;
+}
+
+TEST(PosixFileDevice, WriteReadTest) {
+  const auto path = CreateEmptyTestFile("yas_posix_device_5b0e8f7d2c3a4b1e9f6d8c7b5a4e3d21_1");
+  PosixFileDeviceType device(path);
+  EXPECT_TRUE(device.IsOpen());
+
+  const ByteVector write_vector = { '\x00', '\x01', '\x02', '\x04', '\x05' };
+  EXPECT_EQ(write_vector.size(), device.Write(0, std::cbegin(write_vector), std::cend(write_vector)));
+  EXPECT_EQ(write_vector.size(), device.Write(3, std::cbegin(write_vector), std::cend(write_vector)));
+
+  ByteVector read_vector(write_vector.size());
+  device.Read(3, std::begin(read_vector), std::end(read_vector));
+  EXPECT_EQ(write_vector, read_vector);
+}
+
+TEST(PosixFileDevice, ReadAfterEndTest) {
+  const auto path = CreateEmptyTestFile("yas_posix_device_5b0e8f7d2c3a4b1e9f6d8c7b5a4e3d21_2");
+  PosixFileDeviceType device(path);
+
+  const ByteVector write_vector(0x10, '\x41');
+  device.Write(0, std::cbegin(write_vector), std::cend(write_vector));
+
+  ByteVector read_vector(0x20);
+  EXPECT_THROW(device.Read(0, std::begin(read_vector), std::end(read_vector)), exception::YASException);
+}
+
+TEST(PosixFileDevice, VectoredWriteReadTest) {
+  const auto path = CreateEmptyTestFile("yas_posix_device_5b0e8f7d2c3a4b1e9f6d8c7b5a4e3d21_4");
+  PosixFileDeviceType device(path);
+
+  // adjacent segments are merged into one request, the last one is placed separately
+  const ByteVector first_vector(0x10, '\x41');
+  const ByteVector second_vector(0x20, '\x42');
+  const ByteVector third_vector(0x08, '\x43');
+  const std::vector<devices::WriteSegment<uint64_t>> write_segments = {
+      { 0, first_vector.data(), first_vector.size() },
+      { 0x10, second_vector.data(), second_vector.size() },
+      { 0x100, third_vector.data(), third_vector.size() } };
+  EXPECT_EQ(0x38, device.WriteV(write_segments));
+  EXPECT_EQ(0x108, device.Size());
+
+  ByteVector first_read(first_vector.size());
+  ByteVector second_read(second_vector.size());
+  ByteVector third_read(third_vector.size());
+  device.ReadV({ { 0x100, third_read.data(), third_read.size() },
+      { 0, first_read.data(), first_read.size() },
+      { 0x10, second_read.data(), second_read.size() } });
+  EXPECT_EQ(first_vector, first_read);
+  EXPECT_EQ(second_vector, second_read);
+  EXPECT_EQ(third_vector, third_read);
+
+  // more segments than one preadv call accepts
+  const uint64_t segments_count = 3000;
+  ByteVector many_read(segments_count);
+  std::vector<devices::ReadSegment<uint64_t>> read_segments;
+  for (uint64_t segment_id = 0; segment_id < segments_count; ++segment_id) {
+    read_segments.push_back({ segment_id % 0x30, many_read.data() + segment_id, 1 });
+  }
+  device.ReadV(read_segments);
+  for (uint64_t segment_id = 0; segment_id < segments_count; ++segment_id) {
+    EXPECT_EQ(segment_id % 0x30 < 0x10 ? '\x41' : '\x42', many_read[segment_id]);
+  }
+
+  ByteVector after_end_read(0x10);
+  EXPECT_THROW(device.ReadV({ { 0x100, after_end_read.data(), after_end_read.size() } }), exception::YASException);
+}
+
+TEST(PosixFileDevice, ConcurrentReadTest) {
+  const auto path = CreateEmptyTestFile("yas_posix_device_5b0e8f7d2c3a4b1e9f6d8c7b5a4e3d21_3");
+  PosixFileDeviceType device(path);
+
+  const int32_t blocks_count = 0x100;
+  const int32_t block_size = 0x100;
+  for (int32_t block_id = 0; block_id < blocks_count; ++block_id) {
+    const ByteVector block(block_size, static_cast<uint8_t>(block_id));
+    device.Write(block_id * block_size, std::cbegin(block), std::cend(block));
+  }
+
+  const int32_t threads_count = 4;
+  std::vector<int32_t> mismatches(threads_count, 0);
+  std::vector<std::thread> readers;
+  for (int32_t thread_id = 0; thread_id < threads_count; ++thread_id) {
+    readers.emplace_back([&device, &mismatches, thread_id]() {
+      ByteVector block(block_size);
+      for (int32_t block_id = thread_id; block_id < blocks_count; block_id += threads_count) {
+        device.Read(block_id * block_size, std::begin(block), std::end(block));
+        mismatches[thread_id] += (ByteVector(block_size, static_cast<uint8_t>(block_id)) != block);
+      }
+    });
+  }
+  for (auto &reader : readers) {
+    reader.join();
+  }
+
+  for (const auto mismatches_count : mismatches) {
+    EXPECT_EQ(0, mismatches_count);
+  }
+}
+
+TEST(PosixFileDevice, TruncateTest) {
+  const auto path = CreateEmptyTestFile("yas_posix_device_5b0e8f7d2c3a4b1e9f6d8c7b5a4e3d21_5");
+  PosixFileDeviceType device(path);
+
+  const ByteVector write_vector(0x20, '\x41');
+  device.Write(0, std::cbegin(write_vector), std::cend(write_vector));
+  device.Reserve(0x1000);
+  EXPECT_EQ(0x1000, device.Size());
+
+  // the device isn't extended by truncation
+  device.Truncate(0x10);
+  device.Truncate(0x2000);
+  EXPECT_EQ(0x10, device.Size());
+  ByteVector read_vector(0x10);
+  device.Read(0, std::begin(read_vector), std::end(read_vector));
+  EXPECT_EQ(ByteVector(0x10, '\x41'), read_vector);
+  EXPECT_THROW(device.Read(0x8, std::begin(read_vector), std::end(read_vector)), exception::YASException);
+}
+
+}
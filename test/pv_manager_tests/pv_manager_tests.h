@@ -1,5 +1,9 @@
 #pragma once
 #include "storage/PVManagerFactory.hpp"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
 
 using namespace yas;
 
@@ -431,4 +435,1045 @@ TEST(PVManager, ReqsFuzzyTest_1) {
   }
 }
 
+// puts keys_count numeric values and then reads all of them back from readers_count threads,
+// returns the overall time in milliseconds
+template <typename Device>
+int64_t MeasurePutGetWorkload(const fs::path &pv_path, int32_t keys_count, int32_t readers_count) {
+  using PVManagerType = storage::PVManager<DCharType, DOffsetType, Device>;
+  fs::remove(pv_path);
+
+  const auto start_time = std::chrono::steady_clock::now();
+  auto pv_manager = PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0);
+  for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+    pv_manager->Put("/root/" + std::to_string(key_id), static_cast<uint32_t>(key_id));
+  }
+
+  std::vector<std::thread> readers;
+  for (int32_t reader_id = 0; reader_id < readers_count; ++reader_id) {
+    readers.emplace_back([&pv_manager, keys_count, readers_count, reader_id]() {
+      for (int32_t key_id = reader_id; key_id < keys_count; key_id += readers_count) {
+        const auto result = pv_manager->Get("/root/" + std::to_string(key_id));
+        EXPECT_EQ(static_cast<uint32_t>(key_id), std::get<uint32_t>(result.value()));
+      }
+    });
+  }
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  pv_manager.reset();
+
+  const auto finish_time = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(finish_time - start_time).count();
+}
+
+TEST(PVManager, DISABLED_DevicesBenchmark) {
+  const int32_t keys_count = 100000;
+  const int32_t readers_count = 4;
+  const auto pv_path = fs::temp_directory_path() / "yas_pv_fd60f6e1ae21d37aa1e10007636431ab_24";
+
+  const auto file_device_time = MeasurePutGetWorkload<devices::FileDevice<DOffsetType>>(pv_path,
+      keys_count, readers_count);
+  const auto posix_device_time = MeasurePutGetWorkload<devices::PosixFileDevice<DOffsetType>>(pv_path,
+      keys_count, readers_count);
+  const auto mapped_device_time = MeasurePutGetWorkload<devices::MappedFileDevice<DOffsetType>>(pv_path,
+      keys_count, readers_count);
+
+  std::cout << "Put/Get of " << keys_count << " keys with " << readers_count << " readers: FileDevice - "
+      << file_device_time << " ms, PosixFileDevice - " << posix_device_time << " ms, MappedFileDevice - "
+      << mapped_device_time << " ms" << std::endl;
+}
+
+// counts all device reads to measure round trips per operation
+template <typename OffsetType>
+class ReadsCountingDevice : public devices::PosixFileDevice<OffsetType> {
+ public:
+  static inline int64_t reads_count = 0;
+
+  static inline int64_t writes_count = 0;
+
+  static inline int64_t written_size = 0;
+
+  explicit ReadsCountingDevice(fs::path path)
+      : devices::PosixFileDevice<OffsetType>(std::move(path)) {
+  }
+
+  template <typename Iterator>
+  void Read(OffsetType position, Iterator begin, Iterator end) {
+    ++reads_count;
+    devices::PosixFileDevice<OffsetType>::Read(position, begin, end);
+  }
+
+  void ReadV(const std::vector<devices::ReadSegment<OffsetType>> &segments) {
+    ++reads_count;
+    devices::PosixFileDevice<OffsetType>::ReadV(segments);
+  }
+
+  template <typename Iterator>
+  OffsetType Write(OffsetType position, Iterator begin, Iterator end) {
+    ++writes_count;
+    const auto written = devices::PosixFileDevice<OffsetType>::Write(position, begin, end);
+    written_size += written;
+    return written;
+  }
+
+  OffsetType WriteV(const std::vector<devices::WriteSegment<OffsetType>> &segments) {
+    ++writes_count;
+    const auto written = devices::PosixFileDevice<OffsetType>::WriteV(segments);
+    written_size += written;
+    return written;
+  }
+
+  // only reserves of the foreground thread are counted
+  void Reserve(OffsetType size) {
+    if (std::this_thread::get_id() == foreground_thread_id) {
+      ++foreground_reserves_count;
+    }
+    devices::PosixFileDevice<OffsetType>::Reserve(size);
+  }
+
+  static inline std::thread::id foreground_thread_id;
+  static inline int64_t foreground_reserves_count = 0;
+};
+
+TEST(PVManager, DeviceReadsPerOperation) {
+  using CountingDeviceType = ReadsCountingDevice<DOffsetType>;
+  using PVManagerType = storage::PVManager<DCharType, DOffsetType, CountingDeviceType>;
+  const auto pv_path = fs::temp_directory_path() / "yas_pv_fd60f6e1ae21d37aa1e10007636431ab_25";
+  fs::remove(pv_path);
+
+  const int32_t keys_count = 1000;
+  auto pv_manager = PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0);
+  CountingDeviceType::reads_count = 0;
+  for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+    pv_manager->Put("/root/" + std::to_string(key_id), static_cast<uint64_t>(key_id));
+  }
+  const auto put_reads_count = CountingDeviceType::reads_count;
+
+  CountingDeviceType::reads_count = 0;
+  for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+    pv_manager->Get("/root/" + std::to_string(key_id));
+  }
+  const auto get_reads_count = CountingDeviceType::reads_count;
+
+  CountingDeviceType::reads_count = 0;
+  for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+    pv_manager->Delete("/root/" + std::to_string(key_id));
+  }
+  const auto delete_reads_count = CountingDeviceType::reads_count;
+
+  // the free space is found in memory, so Put doesn't read anything
+  EXPECT_EQ(0, put_reads_count);
+  // one header read for the expiration check and one for the value
+  EXPECT_EQ(2 * keys_count, get_reads_count);
+  // only the header of the deleted entry is read
+  EXPECT_EQ(keys_count, delete_reads_count);
+}
+
+TEST(PVManager, DeviceRequestsPerComplexValue) {
+  using CountingDeviceType = ReadsCountingDevice<DOffsetType>;
+  using PVManagerType = storage::PVManager<DCharType, DOffsetType, CountingDeviceType>;
+  const auto pv_path = fs::temp_directory_path() / "yas_pv_fd60f6e1ae21d37aa1e10007636431ab_26";
+  fs::remove(pv_path);
+
+  // the value should be small enough to be placed in the chain of clusters instead of the extent
+  const int32_t chunks_count = static_cast<int32_t>(kExtentThreshold / kDefaultClusterSize);
+  ByteVector blob_value(kDefaultClusterSize * chunks_count);
+  for (size_t byte_id = 0; byte_id < blob_value.size(); ++byte_id) {
+    blob_value[byte_id] = static_cast<uint8_t>(byte_id * 7);
+  }
+
+  auto pv_manager = PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0);
+  CountingDeviceType::writes_count = 0;
+  EXPECT_TRUE(pv_manager->Put("/root/blob", blob_value));
+  const auto put_writes_count = CountingDeviceType::writes_count;
+
+  CountingDeviceType::reads_count = 0;
+  const auto blob_result = pv_manager->Get("/root/blob");
+  const auto get_reads_count = CountingDeviceType::reads_count;
+  EXPECT_EQ(blob_value, std::get<ByteVector>(blob_result.value()));
+
+  // chunks aren't written one by one
+  EXPECT_GT(chunks_count, put_writes_count);
+  // one read per header of the chain (it is a bit longer than chunks_count because of headers) and the one
+  // vectored read of the whole data instead of two reads per chunk
+  EXPECT_GE(chunks_count + 8, get_reads_count);
+}
+
+TEST(PVManager, ExtentPutGetDeleteTest) {
+  using CountingDeviceType = ReadsCountingDevice<DOffsetType>;
+  using PVManagerType = storage::PVManager<DCharType, DOffsetType, CountingDeviceType>;
+  const auto pv_path = fs::temp_directory_path() / "yas_pv_fd60f6e1ae21d37aa1e10007636431ab_27";
+  fs::remove(pv_path);
+
+  ByteVector extent_value(kExtentThreshold * 4 + 0x123);
+  for (size_t byte_id = 0; byte_id < extent_value.size(); ++byte_id) {
+    extent_value[byte_id] = static_cast<uint8_t>(byte_id * 13);
+  }
+  const ByteVector chain_value(kDefaultClusterSize * 3, '\x41');
+
+  {
+    auto pv_manager = PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0);
+    // only the header and the value are written, the rest of the last cluster is just reserved
+    CountingDeviceType::written_size = 0;
+    EXPECT_TRUE(pv_manager->Put("/root/extent", extent_value));
+    EXPECT_EQ(serialization_utils::offset_of(&pv_layout_headers::ComplexTypeHeader::data_) + extent_value.size(),
+        CountingDeviceType::written_size);
+
+    // the expiration date doesn't break the extent header
+    EXPECT_TRUE(pv_manager->SetExpiredDate("/root/extent", time(nullptr) + 1000));
+    CountingDeviceType::reads_count = 0;
+    const auto extent_result = pv_manager->Get("/root/extent");
+    EXPECT_EQ(extent_value, std::get<ByteVector>(extent_result.value()));
+    // the header for the expiration check, the entry header and the whole value at once
+    EXPECT_EQ(3, CountingDeviceType::reads_count);
+
+    // the freed extent is reused by the next extent and chains don't take chunks bigger than the cluster from it
+    const auto device_end = fs::file_size(pv_path);
+    EXPECT_TRUE(pv_manager->Delete("/root/extent"));
+    EXPECT_TRUE(pv_manager->Put("/root/extent", extent_value));
+    EXPECT_EQ(device_end, fs::file_size(pv_path));
+    EXPECT_TRUE(pv_manager->Delete("/root/extent"));
+    EXPECT_TRUE(pv_manager->Put("/root/chain", chain_value));
+  }
+
+  auto pv_manager = PVManagerType::Load(pv_path, kMaximumSupportedVersion);
+  const auto chain_result = pv_manager->Get("/root/chain");
+  EXPECT_EQ(chain_value, std::get<ByteVector>(chain_result.value()));
+  EXPECT_TRUE(pv_manager->Put("/root/extent", extent_value));
+  const auto extent_result = pv_manager->Get("/root/extent");
+  EXPECT_EQ(extent_value, std::get<ByteVector>(extent_result.value()));
+}
+
+TEST(PVManager, GrowthPolicyTest) {
+  using CountingDeviceType = ReadsCountingDevice<DOffsetType>;
+  using PVManagerType = storage::PVManager<DCharType, DOffsetType, CountingDeviceType>;
+  const auto pv_path = fs::temp_directory_path() / "yas_pv_fd60f6e1ae21d37aa1e10007636431ab_28";
+  fs::remove(pv_path);
+
+  auto pv_manager = PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0);
+  const DOffsetType initial_extend_size = 0x100000;
+  pv_manager->growth_policy({ 2.0, static_cast<int32_t>(initial_extend_size) });
+  EXPECT_EQ(2.0, pv_manager->growth_policy().extend_factor_);
+
+  // the expansion only reserves the space and the free space is tracked in memory, so each Put writes only the
+  // value
+  const int32_t keys_count = 1000;
+  CountingDeviceType::writes_count = 0;
+  for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+    EXPECT_TRUE(pv_manager->Put("/root/" + std::to_string(key_id), static_cast<uint64_t>(key_id)));
+  }
+  EXPECT_EQ(keys_count, CountingDeviceType::writes_count);
+  EXPECT_LT(initial_extend_size, fs::file_size(pv_path));
+  EXPECT_GT(initial_extend_size * 3, fs::file_size(pv_path));
+
+  for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+    const auto result = pv_manager->Get("/root/" + std::to_string(key_id));
+    EXPECT_EQ(static_cast<uint64_t>(key_id), std::get<uint64_t>(result.value()));
+  }
+}
+
+TEST(PVManager, BackgroundExtenderTest) {
+  using CountingDeviceType = ReadsCountingDevice<DOffsetType>;
+  using PVManagerType = storage::PVManager<DCharType, DOffsetType, CountingDeviceType>;
+  const auto pv_path = fs::temp_directory_path() / "yas_pv_fd60f6e1ae21d37aa1e10007636431ab_29";
+  fs::remove(pv_path);
+
+  auto pv_manager = PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0);
+  const uint64_t low_water_mark = 0x40000;
+  pv_manager->growth_policy({ 1.1, 5 * 0x1000, low_water_mark });
+  EXPECT_LE(low_water_mark * 2, fs::file_size(pv_path));
+
+  // expansions take the already reserved space
+  CountingDeviceType::foreground_thread_id = std::this_thread::get_id();
+  CountingDeviceType::foreground_reserves_count = 0;
+  for (int32_t key_id = 0; key_id < 1000; ++key_id) {
+    EXPECT_TRUE(pv_manager->Put("/root/" + std::to_string(key_id), static_cast<uint64_t>(key_id)));
+  }
+  EXPECT_EQ(0, CountingDeviceType::foreground_reserves_count);
+
+  // the extent takes the most of the reserve, so it is refilled by the background thread
+  const auto file_size = fs::file_size(pv_path);
+  EXPECT_TRUE(pv_manager->Put("/root/blob", ByteVector(low_water_mark + 0x100, '\x41')));
+  for (int32_t attempt = 0; attempt < 100 && fs::file_size(pv_path) < file_size + low_water_mark; ++attempt) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_LE(file_size + low_water_mark, fs::file_size(pv_path));
+  EXPECT_EQ(0, CountingDeviceType::foreground_reserves_count);
+
+  // the extender is stopped by the policy without the low water mark
+  pv_manager->growth_policy({ 1.1, 5 * 0x1000, 0 });
+  EXPECT_EQ(0, pv_manager->growth_policy().low_water_mark_);
+
+  // the extender could be started and stopped while other threads put values
+  std::thread writer_thread([&pv_manager]() {
+    for (int32_t key_id = 0; key_id < 2000; ++key_id) {
+      EXPECT_TRUE(pv_manager->Put("/writer/" + std::to_string(key_id), ByteVector(0x100, '\x42')));
+    }
+  });
+  for (int32_t switch_id = 0; switch_id < 20; ++switch_id) {
+    pv_manager->growth_policy({ 1.1, 5 * 0x1000, (switch_id % 2) ? 0 : low_water_mark });
+  }
+  writer_thread.join();
+}
+
+TEST(PVManager, FreeSpaceIndexTest) {
+  using CountingDeviceType = ReadsCountingDevice<DOffsetType>;
+  using PVManagerType = storage::PVManager<DCharType, DOffsetType, CountingDeviceType>;
+  const auto pv_path = fs::temp_directory_path() / "yas_pv_fd60f6e1ae21d37aa1e10007636431ab_30";
+  fs::remove(pv_path);
+
+  const int32_t keys_count = 500;
+  const std::string string_value(300, '\x42');
+  auto put_values = [&](auto &pv_manager, const std::string &prefix) {
+    for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+      EXPECT_TRUE(pv_manager->Put(prefix + std::to_string(key_id), static_cast<uint64_t>(key_id)));
+      EXPECT_TRUE(pv_manager->Put(prefix + "s" + std::to_string(key_id), string_value));
+    }
+  };
+  auto delete_values = [&](auto &pv_manager, const std::string &prefix) {
+    for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+      EXPECT_TRUE(pv_manager->Delete(prefix + std::to_string(key_id)));
+      EXPECT_TRUE(pv_manager->Delete(prefix + "s" + std::to_string(key_id)));
+    }
+  };
+
+  DOffsetType file_size = 0;
+  {
+    auto pv_manager = PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0);
+    put_values(pv_manager, "/root/a");
+    put_values(pv_manager, "/root/b");
+    file_size = fs::file_size(pv_path);
+
+    // allocations take freed entries without any device reads and the file doesn't grow
+    delete_values(pv_manager, "/root/a");
+    CountingDeviceType::reads_count = 0;
+    put_values(pv_manager, "/root/c");
+    EXPECT_EQ(0, CountingDeviceType::reads_count);
+    EXPECT_EQ(file_size, fs::file_size(pv_path));
+    delete_values(pv_manager, "/root/c");
+  }
+
+  // the free space is restored after reload (the saved inverted index could take a part of it, so the old values
+  // are freed too)
+  auto pv_manager = PVManagerType::Load(pv_path, kMaximumSupportedVersion);
+  for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+    const auto value_result = pv_manager->Get("/root/b" + std::to_string(key_id));
+    EXPECT_EQ(static_cast<uint64_t>(key_id), std::get<uint64_t>(value_result.value()));
+  }
+  delete_values(pv_manager, "/root/b");
+  // the space of saved values is reused after the sync
+  pv_manager->SyncIndex();
+  file_size = fs::file_size(pv_path);
+  CountingDeviceType::reads_count = 0;
+  put_values(pv_manager, "/root/d");
+  EXPECT_EQ(0, CountingDeviceType::reads_count);
+  EXPECT_EQ(file_size, fs::file_size(pv_path));
+
+  for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+    const auto string_result = pv_manager->Get("/root/ds" + std::to_string(key_id));
+    EXPECT_EQ(string_value, std::get<std::string>(string_result.value()));
+  }
+}
+
+TEST(PVManager, FreeSpaceIndexCrashTest) {
+  using PVManagerType = storage::PVManager<DCharType, DOffsetType, devices::PosixFileDevice<DOffsetType>>;
+  const auto pv_path = fs::temp_directory_path() / "yas_pv_fd60f6e1ae21d37aa1e10007636431ab_40";
+  const auto crashed_pv_path = fs::temp_directory_path() / "yas_pv_fd60f6e1ae21d37aa1e10007636431ab_40_crashed";
+  fs::remove(pv_path);
+
+  const int32_t keys_count = 3000;
+  {
+    auto pv_manager = PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0);
+    for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+      EXPECT_TRUE(pv_manager->Put("/root/" + std::to_string(key_id), key_id));
+    }
+    for (int32_t key_id = 0; key_id < keys_count; key_id += 2) {
+      EXPECT_TRUE(pv_manager->Delete("/root/" + std::to_string(key_id)));
+    }
+  }
+
+  // the free space index saved on close isn't overwritten by values put after Load, so the copy of PV made before
+  // the next save (the state after the crash of the process) is loaded
+  auto pv_manager = PVManagerType::Load(pv_path, kMaximumSupportedVersion);
+  for (int32_t key_id = 0; key_id < 2 * keys_count; ++key_id) {
+    EXPECT_TRUE(pv_manager->Put("/string/" + std::to_string(key_id), std::string(40, 'a' + key_id % 26)));
+  }
+  fs::remove(crashed_pv_path);
+  fs::copy_file(pv_path, crashed_pv_path);
+  {
+    auto crashed_pv_manager = PVManagerType::Load(crashed_pv_path, kMaximumSupportedVersion);
+    for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+      const auto result = crashed_pv_manager->Get("/root/" + std::to_string(key_id));
+      EXPECT_EQ(key_id % 2 != 0, static_cast<bool>(result));
+      if (result) {
+        EXPECT_EQ(key_id, std::get<int32_t>(result.value()));
+      }
+    }
+  }
+  fs::remove(crashed_pv_path);
+}
+
+TEST(PVManager, PreviousVersionUpgradeTest) {
+  using PVManagerType = storage::PVManager<DCharType, DOffsetType, devices::PosixFileDevice<DOffsetType>>;
+  const auto pv_path = fs::temp_directory_path() / "yas_pv_fd60f6e1ae21d37aa1e10007636431ab_41";
+  fs::remove(pv_path);
+
+  // PV saved by the 1.2 build (free entries are kept in linked lists): /a = 1, /c = "old", /b has been deleted.
+  // Bytes that aren't listed are zeros (the filler of free clusters is dropped)
+  const std::vector<std::pair<size_t, std::string>> pv_parts = {
+      { 0, "5941535f505601027c4b000000000000000f000000000000ea3c0000000000000b000000883c" },
+      { 116, "ea3e0000000000000fd5000000000000e00e000000000000e00e" },
+      { 3964, "0fd5000000000000e00e000000000000e00e" },
+      { 3996, "7c" },
+      { 7804, "0fd5000000000000e00e000000000000e00e" },
+      { 7836, "7c0f" },
+      { 11644, "0fd5000000000000e00e000000000000e00e" },
+      { 11676, "7c1e" },
+      { 15484, "0400000000000000010000000d" },
+      { 15508, "0a0200000000000003000000000000000300000000000000bf3c0000000000006f6c64" },
+      { 15551, "0fd50000000000009d0e0000000000009d0e" },
+      { 15583, "7c2d" },
+      { 15594, "0b02000000000000d800000000000000d800000000000000ea3d000000000000020000000000000005000000000000000102"
+          "080200000000000000943c00000000000004000000000000007c3c" },
+      { 15701, "ffffffffffffffff2f01" },
+      { 15726, "0100000000000000ffffffffffffffff2f0200000000000000010000000000000002" },
+      { 15775, "63030000000000000001000000000000000200000000000000ffffffffffffffff6204000000000000000100000000000000"
+          "0200000000000000010000000000000061" },
+      { 15850, "0fd5000000000000720d000000000000720d" },
+      { 15882, "7c2d" },
+      { 16106, "0fd5000000000000720c000000000000720c" },
+      { 16138, "7c2d" },
+  };
+  {
+    ByteVector pv_data(19324, 0);
+    for (const auto &[offset, hex_data] : pv_parts) {
+      for (size_t byte_id = 0; byte_id < hex_data.size() / 2; ++byte_id) {
+        pv_data[offset + byte_id] = static_cast<uint8_t>(std::stoi(hex_data.substr(byte_id * 2, 2), nullptr, 16));
+      }
+    }
+    std::ofstream pv_file(pv_path, std::ios_base::binary);
+    pv_file.write(reinterpret_cast<const char*>(pv_data.data()), pv_data.size());
+  }
+
+  const utils::Version previous_version(1, 2);
+  auto check_values = [](const auto &pv_manager) {
+    const auto int_result = pv_manager->Get("/a");
+    EXPECT_EQ(1, std::get<int32_t>(int_result.value()));
+    EXPECT_FALSE(pv_manager->Get("/b"));
+    const auto string_result = pv_manager->Get("/c");
+    EXPECT_EQ("old", std::get<std::string>(string_result.value()));
+  };
+  {
+    auto pv_manager = PVManagerType::Load(pv_path, previous_version);
+    check_values(pv_manager);
+    EXPECT_THROW(pv_manager->slab_mode(true), exception::YASException);
+    EXPECT_TRUE(pv_manager->Put("/d", 4));
+    EXPECT_TRUE(pv_manager->Put("/e", std::string(0x100, '\x45')));
+    EXPECT_TRUE(pv_manager->Delete("/e"));
+  }
+
+  // PV is saved in the format of the given version, so free entries are linked in lists again
+  const auto file_size = fs::file_size(pv_path);
+  {
+    auto pv_manager = PVManagerType::Load(pv_path, previous_version);
+    check_values(pv_manager);
+    const auto result = pv_manager->Get("/d");
+    EXPECT_EQ(4, std::get<int32_t>(result.value()));
+    EXPECT_TRUE(pv_manager->Put("/e", std::string(0x100, '\x46')));
+  }
+  EXPECT_EQ(file_size, fs::file_size(pv_path));
+
+  // the newer version upgrades PV, so the previous version can't load it anymore
+  {
+    auto pv_manager = PVManagerType::Load(pv_path, utils::Version(1, 4));
+    check_values(pv_manager);
+    const auto result = pv_manager->Get("/e");
+    EXPECT_EQ(std::string(0x100, '\x46'), std::get<std::string>(result.value()));
+  }
+  EXPECT_THROW(PVManagerType::Load(pv_path, previous_version), exception::YASException);
+  auto pv_manager = PVManagerType::Load(pv_path, utils::Version(1, 4));
+  const auto result = pv_manager->Get("/d");
+  EXPECT_EQ(4, std::get<int32_t>(result.value()));
+}
+
+TEST(PVManager, FreeSpaceCoalescingTest) {
+  using PVManagerType = storage::PVManager<DCharType, DOffsetType, devices::PosixFileDevice<DOffsetType>>;
+  const auto pv_path = fs::temp_directory_path() / "yas_pv_fd60f6e1ae21d37aa1e10007636431ab_31";
+  fs::remove(pv_path);
+
+  auto pv_manager = PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0);
+  const int32_t keys_count = 2000;
+  for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+    EXPECT_TRUE(pv_manager->Put("/root/" + std::to_string(key_id), std::string(20 + key_id % 100, '\x41')));
+    EXPECT_TRUE(pv_manager->Put("/root/n" + std::to_string(key_id), static_cast<uint64_t>(key_id)));
+  }
+
+  // freed small entries are merged, so the big values take their space instead of the device growth
+  for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+    EXPECT_TRUE(pv_manager->Delete("/root/" + std::to_string(key_id)));
+    EXPECT_TRUE(pv_manager->Delete("/root/n" + std::to_string(key_id)));
+  }
+  const auto file_size = fs::file_size(pv_path);
+  const ByteVector chain_value(kExtentThreshold / 2, '\x42');
+  const ByteVector extent_value(kExtentThreshold + 0x100, '\x43');
+  EXPECT_TRUE(pv_manager->Put("/root/chain", chain_value));
+  EXPECT_TRUE(pv_manager->Put("/root/extent", extent_value));
+  EXPECT_EQ(file_size, fs::file_size(pv_path));
+
+  const auto chain_result = pv_manager->Get("/root/chain");
+  EXPECT_EQ(chain_value, std::get<ByteVector>(chain_result.value()));
+  const auto extent_result = pv_manager->Get("/root/extent");
+  EXPECT_EQ(extent_value, std::get<ByteVector>(extent_result.value()));
+}
+
+TEST(PVManager, SlabModeTest) {
+  using PVManagerType = storage::PVManager<DCharType, DOffsetType, devices::PosixFileDevice<DOffsetType>>;
+  const auto pv_path = fs::temp_directory_path() / "yas_pv_fd60f6e1ae21d37aa1e10007636431ab_32";
+  fs::remove(pv_path);
+
+  const int32_t keys_count = 3000;
+  auto put_values = [&](auto &pv_manager, const std::string &prefix) {
+    for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+      EXPECT_TRUE(pv_manager->Put(prefix + std::to_string(key_id), static_cast<uint32_t>(key_id)));
+      EXPECT_TRUE(pv_manager->Put(prefix + "n" + std::to_string(key_id), static_cast<uint64_t>(key_id)));
+      EXPECT_TRUE(pv_manager->Put(prefix + "s" + std::to_string(key_id), std::string(40 + key_id % 50, '\x41')));
+    }
+  };
+  auto check_values = [&](auto &pv_manager, const std::string &prefix) {
+    for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+      const auto value_result = pv_manager->Get(prefix + std::to_string(key_id));
+      EXPECT_EQ(static_cast<uint32_t>(key_id), std::get<uint32_t>(value_result.value()));
+      const auto number_result = pv_manager->Get(prefix + "n" + std::to_string(key_id));
+      EXPECT_EQ(static_cast<uint64_t>(key_id), std::get<uint64_t>(number_result.value()));
+      const auto string_result = pv_manager->Get(prefix + "s" + std::to_string(key_id));
+      EXPECT_EQ(std::string(40 + key_id % 50, '\x41'), std::get<std::string>(string_result.value()));
+    }
+  };
+  auto delete_values = [&](auto &pv_manager, const std::string &prefix) {
+    for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+      EXPECT_TRUE(pv_manager->Delete(prefix + std::to_string(key_id)));
+      EXPECT_TRUE(pv_manager->Delete(prefix + "n" + std::to_string(key_id)));
+      EXPECT_TRUE(pv_manager->Delete(prefix + "s" + std::to_string(key_id)));
+    }
+  };
+
+  {
+    auto pv_manager = PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0);
+    EXPECT_FALSE(pv_manager->slab_mode());
+    pv_manager->slab_mode(true);
+    put_values(pv_manager, "/root/a");
+    put_values(pv_manager, "/root/b");
+  }
+
+  // slabs and the mode are restored after reload, so freed slots are reused
+  {
+    auto pv_manager = PVManagerType::Load(pv_path, kMaximumSupportedVersion);
+    EXPECT_TRUE(pv_manager->slab_mode());
+    check_values(pv_manager, "/root/a");
+    delete_values(pv_manager, "/root/a");
+    pv_manager->SyncIndex();
+    const auto file_size = fs::file_size(pv_path);
+    put_values(pv_manager, "/root/c");
+    EXPECT_EQ(file_size, fs::file_size(pv_path));
+    check_values(pv_manager, "/root/b");
+    check_values(pv_manager, "/root/c");
+
+    // values in slabs are still readable and deletable without the slab mode
+    pv_manager->slab_mode(false);
+    delete_values(pv_manager, "/root/b");
+    pv_manager->SyncIndex();
+    const auto synced_file_size = fs::file_size(pv_path);
+    put_values(pv_manager, "/root/d");
+    EXPECT_EQ(synced_file_size, fs::file_size(pv_path));
+  }
+
+  auto pv_manager = PVManagerType::Load(pv_path, kMaximumSupportedVersion);
+  EXPECT_FALSE(pv_manager->slab_mode());
+  check_values(pv_manager, "/root/c");
+  check_values(pv_manager, "/root/d");
+
+  // whole slots of values put in the slab mode are freed, so nothing is left in clusters of former slabs
+  const auto file_size = fs::file_size(pv_path);
+  delete_values(pv_manager, "/root/c");
+  delete_values(pv_manager, "/root/d");
+  pv_manager->SyncIndex();
+  pv_manager->Compact();
+  EXPECT_GE(file_size / 3, fs::file_size(pv_path));
+}
+
+TEST(PVManager, FreelistLimitsTest) {
+  using PVManagerType = storage::PVManager<DCharType, DOffsetType, devices::PosixFileDevice<DOffsetType>>;
+  using FreelistHelperType = freelist_helper::FreelistHelper<DOffsetType>;
+  const auto pv_path = fs::temp_directory_path() / "yas_pv_fd60f6e1ae21d37aa1e10007636431ab_33";
+  fs::remove(pv_path);
+
+  const int32_t keys_count = 500;
+  {
+    auto pv_manager = PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0);
+    EXPECT_EQ(FreelistHelperType::kFreelistLimits, pv_manager->freelist_limits());
+    for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+      EXPECT_TRUE(pv_manager->Put("/root/a" + std::to_string(key_id), static_cast<uint64_t>(key_id)));
+      EXPECT_TRUE(pv_manager->Put("/root/s" + std::to_string(key_id), std::string(200, '\x41')));
+    }
+  }
+
+  // the histogram of the reloaded PV gives limits that are saved in it
+  FreelistHelperType::limits_type derived_limits;
+  {
+    auto pv_manager = PVManagerType::Load(pv_path, kMaximumSupportedVersion);
+    const auto entry_sizes = pv_manager->GetEntrySizesHistogram();
+    ASSERT_EQ(2, entry_sizes.size());
+    EXPECT_EQ(keys_count, entry_sizes.at(sizeof(pv_layout_headers::Simple8TypeHeader)));
+    EXPECT_EQ(keys_count, std::crbegin(entry_sizes)->second);
+
+    derived_limits = FreelistHelperType::DeriveLimits(entry_sizes, pv_manager->cluster_size());
+    EXPECT_NE(FreelistHelperType::kFreelistLimits, derived_limits);
+    pv_manager->freelist_limits(derived_limits);
+    for (int32_t key_id = 0; key_id < keys_count; key_id += 2) {
+      EXPECT_TRUE(pv_manager->Delete("/root/s" + std::to_string(key_id)));
+    }
+  }
+
+  {
+    auto pv_manager = PVManagerType::Load(pv_path, kMaximumSupportedVersion);
+    EXPECT_EQ(derived_limits, pv_manager->freelist_limits());
+    const auto file_size = fs::file_size(pv_path);
+    for (int32_t key_id = 0; key_id < keys_count; key_id += 2) {
+      EXPECT_TRUE(pv_manager->Put("/root/s" + std::to_string(key_id), std::string(200, '\x42')));
+    }
+    EXPECT_EQ(file_size, fs::file_size(pv_path));
+    for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+      const auto result = pv_manager->Get("/root/s" + std::to_string(key_id));
+      EXPECT_EQ(std::string(200, key_id % 2 ? '\x41' : '\x42'), std::get<std::string>(result.value()));
+    }
+  }
+
+  // PV with another cluster size gets limits for it, custom limits could be set on creation
+  fs::remove(pv_path);
+  {
+    auto pv_manager = PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0, 0x4000, derived_limits);
+    EXPECT_EQ(derived_limits, pv_manager->freelist_limits());
+  }
+  fs::remove(pv_path);
+  auto pv_manager = PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0, 0x4000);
+  EXPECT_EQ(FreelistHelperType::DefaultLimits(pv_manager->cluster_size()), pv_manager->freelist_limits());
+  EXPECT_THROW(pv_manager->freelist_limits({}), exception::YASException);
+}
+
+TEST(PVManager, CompactionTest) {
+  using PVManagerType = storage::PVManager<DCharType, DOffsetType, devices::PosixFileDevice<DOffsetType>>;
+  const auto pv_path = fs::temp_directory_path() / "yas_pv_fd60f6e1ae21d37aa1e10007636431ab_34";
+
+  // numbers, short strings, chains of chunks and extents
+  const int32_t keys_count = 2000;
+  auto make_value = [](int32_t key_id) -> storage_value_type {
+    switch (key_id % 4) {
+    case 0: return static_cast<uint64_t>(key_id);
+    case 1: return std::string(20 + key_id % 70, static_cast<char>('a' + key_id % 26));
+    case 2: return ByteVector(key_id % 40 == 2 ? 0x3000 : 300, static_cast<uint8_t>(key_id));
+    default: return ByteVector(key_id % 200 == 3 ? 0x12000 : 12, static_cast<uint8_t>(key_id));
+    }
+  };
+  auto check_values = [&](auto &pv_manager) {
+    for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+      const auto result = pv_manager->Get("/root/" + std::to_string(key_id));
+      if (key_id % 5 != 4) {
+        EXPECT_FALSE(result);
+        continue;
+      }
+      ASSERT_TRUE(result);
+      EXPECT_EQ(make_value(key_id), result.value());
+    }
+  };
+
+  const time_t expired_date = std::time(nullptr) + 1000;
+  for (const bool is_slab_mode : { false, true }) {
+    fs::remove(pv_path);
+    {
+      auto pv_manager = PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0);
+      pv_manager->slab_mode(is_slab_mode);
+      for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+        EXPECT_TRUE(pv_manager->Put("/root/" + std::to_string(key_id), make_value(key_id)));
+      }
+      EXPECT_TRUE(pv_manager->SetExpiredDate("/root/9", expired_date));
+      // most of values are deleted, the rest are scattered through the whole PV
+      for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+        if (key_id % 5 != 4) {
+          EXPECT_TRUE(pv_manager->Delete("/root/" + std::to_string(key_id)));
+        }
+      }
+    }
+
+    {
+      auto pv_manager = PVManagerType::Load(pv_path, kMaximumSupportedVersion);
+      const auto file_size = fs::file_size(pv_path);
+      int32_t steps_count = 1;
+      while (!pv_manager->CompactStep(std::chrono::microseconds(1))) {
+        ++steps_count;
+      }
+      EXPECT_LT(1, steps_count);
+      EXPECT_GT(file_size / 2, fs::file_size(pv_path));
+      check_values(pv_manager);
+      const auto expired_result = pv_manager->GetExpiredDate("/root/9");
+      EXPECT_EQ(expired_date, expired_result.value());
+
+      // the compacted PV is still writable
+      EXPECT_TRUE(pv_manager->Put("/root/new", make_value(2)));
+    }
+
+    auto pv_manager = PVManagerType::Load(pv_path, kMaximumSupportedVersion);
+    check_values(pv_manager);
+    const auto result = pv_manager->Get("/root/new");
+    EXPECT_EQ(make_value(2), result.value());
+  }
+}
+
+TEST(PVManager, ShrinkTest) {
+  using PVManagerType = storage::PVManager<DCharType, DOffsetType, devices::PosixFileDevice<DOffsetType>>;
+  const auto pv_path = fs::temp_directory_path() / "yas_pv_fd60f6e1ae21d37aa1e10007636431ab_35";
+  fs::remove(pv_path);
+
+  const int32_t keys_count = 300;
+  auto put_values = [&](auto &pv_manager, const std::string &prefix) {
+    for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+      EXPECT_TRUE(pv_manager->Put(prefix + std::to_string(key_id), ByteVector(1000, static_cast<uint8_t>(key_id))));
+    }
+  };
+  auto delete_values = [&](auto &pv_manager, const std::string &prefix) {
+    for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+      EXPECT_TRUE(pv_manager->Delete(prefix + std::to_string(key_id)));
+    }
+  };
+
+  auto pv_manager = PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0);
+  put_values(pv_manager, "/root/steady");
+  const auto steady_size = fs::file_size(pv_path);
+
+  // the spike of values is deleted, but the PV keeps its size until it is shrunk
+  put_values(pv_manager, "/root/spike");
+  delete_values(pv_manager, "/root/spike");
+  EXPECT_LT(steady_size + keys_count * 900, fs::file_size(pv_path));
+  EXPECT_LT(0, pv_manager->Shrink());
+  EXPECT_GE(steady_size + kDefaultClusterSize, fs::file_size(pv_path));
+  EXPECT_EQ(0, pv_manager->Shrink());
+
+  // the automatic mode shrinks PV right after deletes
+  auto growth_policy = pv_manager->growth_policy();
+  growth_policy.shrink_threshold_ = 0x10000;
+  pv_manager->growth_policy(growth_policy);
+  put_values(pv_manager, "/root/spike");
+  EXPECT_LT(steady_size + keys_count * 900, fs::file_size(pv_path));
+  delete_values(pv_manager, "/root/spike");
+  EXPECT_GE(steady_size + growth_policy.shrink_threshold_, fs::file_size(pv_path));
+
+  for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+    const auto result = pv_manager->Get("/root/steady" + std::to_string(key_id));
+    EXPECT_EQ(ByteVector(1000, static_cast<uint8_t>(key_id)), std::get<ByteVector>(result.value()));
+  }
+}
+
+TEST(PVManager, HugeClusterTest) {
+  using PVManagerType = storage::PVManager<DCharType, DOffsetType, devices::PosixFileDevice<DOffsetType>>;
+  const auto pv_path = fs::temp_directory_path() / "yas_pv_fd60f6e1ae21d37aa1e10007636431ab_36";
+  fs::remove(pv_path);
+
+  EXPECT_THROW(PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0, kMinimumClusterSize - 1),
+      exception::YASException);
+  EXPECT_THROW(PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0, kMaximumClusterSize * 2),
+      exception::YASException);
+  EXPECT_FALSE(fs::exists(pv_path));
+
+  const std::vector<DOffsetType> value_sizes = { 10, 3000, 70000, 0x100000 + 17, 0x300000 };
+  auto make_value = [](DOffsetType value_size, int32_t seed) {
+    ByteVector value(value_size);
+    for (DOffsetType i = 0; i < value_size; ++i) {
+      value[i] = static_cast<uint8_t>(i * 7 + seed);
+    }
+    return value;
+  };
+  auto check_values = [&](auto &pv_manager, int32_t seed) {
+    for (size_t value_id = 0; value_id < value_sizes.size(); ++value_id) {
+      const auto result = pv_manager->Get("/root/blob" + std::to_string(value_id));
+      EXPECT_EQ(make_value(value_sizes[value_id], seed), std::get<ByteVector>(result.value()));
+    }
+  };
+
+  for (const int32_t cluster_size : { 0x10000, 0x200000 }) {
+    fs::remove(pv_path);
+    {
+      auto pv_manager = PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0, cluster_size);
+      EXPECT_EQ(cluster_size, pv_manager->cluster_size());
+      for (size_t value_id = 0; value_id < value_sizes.size(); ++value_id) {
+        EXPECT_TRUE(pv_manager->Put("/root/blob" + std::to_string(value_id), make_value(value_sizes[value_id], 1)));
+      }
+      check_values(pv_manager, 1);
+
+      // small values share clusters, so even 2M clusters don't make PV much bigger than its content
+      for (int32_t key_id = 0; key_id < 100; ++key_id) {
+        EXPECT_TRUE(pv_manager->Put("/root/small" + std::to_string(key_id), key_id));
+      }
+      EXPECT_GE(0x400000 + 0x100000 + static_cast<DOffsetType>(cluster_size), fs::file_size(pv_path));
+    }
+
+    // blobs are replaced by blobs of the same sizes after reload, the freed extents are reused
+    {
+      auto pv_manager = PVManagerType::Load(pv_path, kMaximumSupportedVersion);
+      EXPECT_EQ(cluster_size, pv_manager->cluster_size());
+      check_values(pv_manager, 1);
+      const auto pv_size = fs::file_size(pv_path);
+      for (size_t value_id = 0; value_id < value_sizes.size(); ++value_id) {
+        EXPECT_TRUE(pv_manager->Delete("/root/blob" + std::to_string(value_id)));
+        pv_manager->SyncIndex();
+        EXPECT_TRUE(pv_manager->Put("/root/blob" + std::to_string(value_id), make_value(value_sizes[value_id], 2)));
+      }
+      EXPECT_EQ(pv_size, fs::file_size(pv_path));
+    }
+
+    auto pv_manager = PVManagerType::Load(pv_path, kMaximumSupportedVersion);
+    check_values(pv_manager, 2);
+    for (int32_t key_id = 0; key_id < 100; ++key_id) {
+      const auto result = pv_manager->Get("/root/small" + std::to_string(key_id));
+      EXPECT_EQ(key_id, std::get<int32_t>(result.value()));
+    }
+  }
+}
+
+TEST(PVManager, FlatIndexTest) {
+  using PVManagerType = storage::PVManager<DCharType, DOffsetType, devices::PosixFileDevice<DOffsetType>>;
+  const auto pv_path = fs::temp_directory_path() / "yas_pv_fd60f6e1ae21d37aa1e10007636431ab_38";
+  fs::remove(pv_path);
+
+  const int32_t keys_count = 3000;
+  auto check_values = [&](auto &pv_manager, int32_t changed_key_id) {
+    for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+      const auto result = pv_manager->Get("/root/" + std::to_string(key_id));
+      EXPECT_EQ(key_id == changed_key_id ? -1 : key_id, std::get<int32_t>(result.value()));
+    }
+  };
+
+  // the index of the old version is upgraded to the flat index on close
+  const utils::Version previous_version(1, 4);
+  {
+    auto pv_manager = PVManagerType::Create(pv_path, previous_version, 0);
+    for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+      EXPECT_TRUE(pv_manager->Put("/root/" + std::to_string(key_id), key_id));
+    }
+  }
+  {
+    auto pv_manager = PVManagerType::Load(pv_path, previous_version);
+    check_values(pv_manager, keys_count);
+  }
+  {
+    auto pv_manager = PVManagerType::Load(pv_path, kMaximumSupportedVersion);
+    check_values(pv_manager, keys_count);
+  }
+  EXPECT_THROW(PVManagerType::Load(pv_path, previous_version), exception::YASException);
+  {
+    auto pv_manager = PVManagerType::Load(pv_path, kMaximumSupportedVersion);
+    check_values(pv_manager, keys_count);
+    EXPECT_FALSE(pv_manager->Get("/root/"));
+  }
+
+  // the flat index isn't rewritten if it hasn't been changed
+  const auto pv_size = fs::file_size(pv_path);
+  {
+    auto pv_manager = PVManagerType::Load(pv_path, kMaximumSupportedVersion);
+    check_values(pv_manager, keys_count);
+  }
+  EXPECT_EQ(pv_size, fs::file_size(pv_path));
+
+  // the mapped index is replaced by the changed one
+  {
+    auto pv_manager = PVManagerType::Load(pv_path, kMaximumSupportedVersion);
+    EXPECT_TRUE(pv_manager->Delete("/root/7"));
+    EXPECT_TRUE(pv_manager->Put("/root/7", -1));
+    check_values(pv_manager, 7);
+  }
+  auto pv_manager = PVManagerType::Load(pv_path, kMaximumSupportedVersion);
+  check_values(pv_manager, 7);
+}
+
+TEST(PVManager, IndexLogTest) {
+  using PVManagerType = storage::PVManager<DCharType, DOffsetType, devices::PosixFileDevice<DOffsetType>>;
+  const auto pv_path = fs::temp_directory_path() / "yas_pv_fd60f6e1ae21d37aa1e10007636431ab_39";
+  const auto crashed_pv_path = fs::temp_directory_path() / "yas_pv_fd60f6e1ae21d37aa1e10007636431ab_39_crashed";
+  fs::remove(pv_path);
+
+  const int32_t keys_count = 20000;
+  auto check_values = [&](const auto &pv_manager, int32_t changed_keys_count) {
+    for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+      const auto result = pv_manager->Get("/root/" + std::to_string(key_id));
+      EXPECT_EQ(key_id < changed_keys_count ? -key_id : key_id, std::get<int32_t>(result.value()));
+    }
+  };
+  auto change_values = [](auto &pv_manager, int32_t first_key_id, int32_t last_key_id) {
+    for (int32_t key_id = first_key_id; key_id < last_key_id; ++key_id) {
+      EXPECT_TRUE(pv_manager->Delete("/root/" + std::to_string(key_id)));
+      EXPECT_TRUE(pv_manager->Put("/root/" + std::to_string(key_id), -key_id));
+    }
+  };
+  // the copy of PV made while the manager is alive is what remains after the crash of the process
+  auto load_crashed = [&]() {
+    fs::remove(crashed_pv_path);
+    fs::copy_file(pv_path, crashed_pv_path);
+    return PVManagerType::Load(crashed_pv_path, kMaximumSupportedVersion);
+  };
+
+  auto pv_manager = PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0);
+  for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+    EXPECT_TRUE(pv_manager->Put("/root/" + std::to_string(key_id), key_id));
+  }
+  pv_manager->SyncIndex();
+  check_values(load_crashed(), 0);
+
+  // few changes are appended to the log, each sync is saved
+  change_values(pv_manager, 0, 10);
+  pv_manager->SyncIndex();
+  check_values(load_crashed(), 10);
+  change_values(pv_manager, 10, 20);
+  pv_manager->SyncIndex();
+  {
+    auto crashed_pv_manager = load_crashed();
+    check_values(crashed_pv_manager, 20);
+    // the log is continued after Load
+    change_values(crashed_pv_manager, 20, 30);
+  }
+  check_values(PVManagerType::Load(crashed_pv_path, kMaximumSupportedVersion), 30);
+
+  // the big log is merged into the checkpoint
+  storage::IndexSyncPolicy index_sync_policy;
+  index_sync_policy.checkpoint_ratio_ = 0.01;
+  pv_manager->index_sync_policy(index_sync_policy);
+  change_values(pv_manager, 20, 2000);
+  pv_manager->SyncIndex();
+  check_values(load_crashed(), 2000);
+
+  // the space of values deleted after the last sync isn't reused until the next one, so the saved values are intact
+  change_values(pv_manager, 2000, 4000);
+  check_values(load_crashed(), 2000);
+  pv_manager->SyncIndex();
+  check_values(load_crashed(), 4000);
+
+  // changes are saved by the background thread
+  index_sync_policy.sync_interval_ = std::chrono::milliseconds(10);
+  pv_manager->index_sync_policy(index_sync_policy);
+  EXPECT_TRUE(pv_manager->Put("/root/", 1));
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  {
+    auto crashed_pv_manager = load_crashed();
+    check_values(crashed_pv_manager, 4000);
+    const auto result = crashed_pv_manager->Get("/root/");
+    EXPECT_EQ(1, std::get<int32_t>(result.value()));
+  }
+  EXPECT_TRUE(pv_manager->Delete("/root/"));
+  index_sync_policy.sync_interval_ = std::chrono::milliseconds(0);
+  pv_manager->index_sync_policy(index_sync_policy);
+
+  // the compaction moves values, so the whole index is saved, old places of values are reused only after that
+  pv_manager->Compact();
+  {
+    auto crashed_pv_manager = load_crashed();
+    check_values(crashed_pv_manager, 4000);
+    EXPECT_FALSE(crashed_pv_manager->Get("/root/"));
+  }
+  change_values(pv_manager, 4000, 6000);
+  check_values(load_crashed(), 4000);
+  pv_manager.reset();
+  check_values(PVManagerType::Load(pv_path, kMaximumSupportedVersion), 6000);
+  fs::remove(crashed_pv_path);
+}
+
+TEST(PVManager, CompactionCrashTest) {
+  using PVManagerType = storage::PVManager<DCharType, DOffsetType, devices::PosixFileDevice<DOffsetType>>;
+  const auto pv_path = fs::temp_directory_path() / "yas_pv_fd60f6e1ae21d37aa1e10007636431ab_42";
+  const auto crashed_pv_path = fs::temp_directory_path() / "yas_pv_fd60f6e1ae21d37aa1e10007636431ab_42_crashed";
+  fs::remove(pv_path);
+
+  const int32_t keys_count = 2000;
+  auto make_value = [](int32_t key_id) -> storage_value_type {
+    return key_id % 2 == 0 ? storage_value_type(key_id) : std::string(20 + key_id % 300, 'a' + key_id % 26);
+  };
+  // values put after the last sync are lost by the crash, but the saved ones should be intact
+  auto check_crashed = [&]() {
+    fs::remove(crashed_pv_path);
+    fs::copy_file(pv_path, crashed_pv_path);
+    auto crashed_pv_manager = PVManagerType::Load(crashed_pv_path, kMaximumSupportedVersion);
+    for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+      const auto result = crashed_pv_manager->Get("/root/" + std::to_string(key_id));
+      if (key_id % 5 != 4) {
+        EXPECT_FALSE(result);
+        continue;
+      }
+      ASSERT_TRUE(result);
+      EXPECT_EQ(make_value(key_id), result.value());
+    }
+  };
+  auto put_new_values = [&](auto &pv_manager, const std::string &prefix) {
+    for (int32_t key_id = 0; key_id < keys_count; key_id += 5) {
+      EXPECT_TRUE(pv_manager->Put(prefix + std::to_string(key_id), make_value(key_id + 4)));
+    }
+  };
+
+  auto pv_manager = PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0);
+  for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+    EXPECT_TRUE(pv_manager->Put("/root/" + std::to_string(key_id), make_value(key_id)));
+  }
+  for (int32_t key_id = 0; key_id < keys_count; ++key_id) {
+    if (key_id % 5 != 4) {
+      EXPECT_TRUE(pv_manager->Delete("/root/" + std::to_string(key_id)));
+    }
+  }
+  pv_manager->SyncIndex();
+  check_crashed();
+
+  // the space of moved values (and of the moved index) isn't reused until the index refers to their new places
+  for (int32_t step_id = 0; step_id < 3; ++step_id) {
+    pv_manager->CompactStep(std::chrono::microseconds(0));
+  }
+  put_new_values(pv_manager, "/first/");
+  check_crashed();
+
+  pv_manager->Compact();
+  check_crashed();
+  put_new_values(pv_manager, "/second/");
+  check_crashed();
+  fs::remove(crashed_pv_path);
+}
+
+TEST(PVManager, DISABLED_BlobThroughputBenchmark) {
+  using PVManagerType = storage::PVManager<DCharType, DOffsetType, devices::PosixFileDevice<DOffsetType>>;
+  const auto pv_path = fs::temp_directory_path() / "yas_pv_fd60f6e1ae21d37aa1e10007636431ab_37";
+
+  const int32_t blobs_count = 32;
+  const DOffsetType blob_size = 0x100000;
+  const ByteVector blob(blob_size, 0x5a);
+  auto get_throughput = [&](auto start_time) {
+    const auto elapsed_time = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+    return static_cast<int64_t>(blobs_count) * blob_size / std::max<int64_t>(elapsed_time, 1);
+  };
+
+  std::cout << "1M blobs throughput (MB/s):" << std::endl;
+  for (const int32_t cluster_size : { static_cast<int32_t>(kDefaultClusterSize), 0x10000, 0x40000, 0x200000 }) {
+    fs::remove(pv_path);
+    auto pv_manager = PVManagerType::Create(pv_path, kMaximumSupportedVersion, 0, cluster_size);
+
+    auto start_time = std::chrono::steady_clock::now();
+    for (int32_t blob_id = 0; blob_id < blobs_count; ++blob_id) {
+      EXPECT_TRUE(pv_manager->Put("/root/blob" + std::to_string(blob_id), blob));
+    }
+    const auto put_throughput = get_throughput(start_time);
+
+    start_time = std::chrono::steady_clock::now();
+    for (int32_t blob_id = 0; blob_id < blobs_count; ++blob_id) {
+      const auto result = pv_manager->Get("/root/blob" + std::to_string(blob_id));
+      EXPECT_EQ(blob_size, std::get<ByteVector>(result.value()).size());
+    }
+    const auto get_throughput_value = get_throughput(start_time);
+    std::cout << "cluster " << cluster_size << ": put - " << put_throughput << ", get - " << get_throughput_value
+        << std::endl;
+  }
+  fs::remove(pv_path);
+}
+
 }
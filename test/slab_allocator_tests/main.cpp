@@ -0,0 +1,7 @@
+#include "gtest/gtest.h"
+#include "slab_allocator_tests.h"
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
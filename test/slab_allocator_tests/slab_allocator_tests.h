@@ -0,0 +1,94 @@
+#pragma once
+#include "storage/lib/physical_volume/SlabAllocator.hpp"
+#include <iostream>
+
+using namespace yas::slab_allocator;
+
+namespace {
+
+using SlabAllocatorType = SlabAllocator<yas::DOffsetType>;
+
+TEST(SlabAllocator, SlotsAllocationTest) {
+  SlabAllocatorType allocator(yas::kDefaultClusterSize);
+  const auto class_id = allocator.GetClassId(sizeof(yas::pv_layout_headers::Simple8TypeHeader));
+  EXPECT_EQ(1, class_id);
+  EXPECT_EQ(kSlabClassCount, allocator.GetClassId(1000));
+  EXPECT_FALSE(yas::offset_traits<yas::DOffsetType>::IsExistValue(allocator.PopFreeSlot(class_id)));
+
+  // slots of the slab are placed one after another
+  const yas::DOffsetType slab_offset = 0x1000;
+  const auto slots_count = yas::kDefaultClusterSize / SlabAllocatorType::kSlabClasses[class_id];
+  EXPECT_EQ(slab_offset, allocator.AddSlab(slab_offset, class_id));
+  for (yas::DOffsetType slot_id = 1; slot_id < slots_count; ++slot_id) {
+    EXPECT_EQ(slab_offset + slot_id * 16, allocator.PopFreeSlot(class_id));
+  }
+  EXPECT_FALSE(yas::offset_traits<yas::DOffsetType>::IsExistValue(allocator.PopFreeSlot(class_id)));
+
+  // the freed slot is reused and the slab is returned when it becomes empty
+  EXPECT_TRUE(allocator.HasSlot(slab_offset + 0x20));
+  EXPECT_FALSE(allocator.HasSlot(slab_offset + yas::kDefaultClusterSize));
+  EXPECT_FALSE(yas::offset_traits<yas::DOffsetType>::IsExistValue(allocator.FreeSlot(slab_offset + 0x20)));
+  EXPECT_THROW(allocator.FreeSlot(slab_offset + 0x20), yas::exception::YASException);
+  EXPECT_THROW(allocator.FreeSlot(slab_offset + 0x21), yas::exception::YASException);
+  EXPECT_EQ(slab_offset + 0x20, allocator.PopFreeSlot(class_id));
+  for (yas::DOffsetType slot_id = 0; slot_id < slots_count - 1; ++slot_id) {
+    allocator.FreeSlot(slab_offset + slot_id * 16);
+  }
+  EXPECT_EQ(slab_offset, allocator.FreeSlot(slab_offset + (slots_count - 1) * 16));
+  EXPECT_EQ(0, allocator.slabs_count());
+}
+
+TEST(SlabAllocator, SerializationTest) {
+  SlabAllocatorType allocator(yas::kDefaultClusterSize);
+  for (uint32_t class_id = 0; class_id < kSlabClassCount; ++class_id) {
+    allocator.AddSlab((class_id + 1) * 0x10000, class_id);
+    allocator.PopFreeSlot(class_id);
+  }
+
+  const auto serialized_slabs = allocator.Serialize();
+  SlabAllocatorType loaded_allocator(yas::kDefaultClusterSize);
+  loaded_allocator.Deserialize(std::cbegin(serialized_slabs), std::cend(serialized_slabs));
+  EXPECT_EQ(kSlabClassCount, loaded_allocator.slabs_count());
+  EXPECT_EQ(serialized_slabs, loaded_allocator.Serialize());
+  EXPECT_EQ(0x10000 + 2 * 12, loaded_allocator.PopFreeSlot(0));
+
+  const yas::ByteVector corrupted_slabs = { 0x10, 0x20 };
+  EXPECT_THROW(loaded_allocator.Deserialize(std::cbegin(corrupted_slabs), std::cend(corrupted_slabs)),
+      yas::exception::YASException);
+}
+
+TEST(SlabAllocator, LowerSlotTest) {
+  SlabAllocatorType allocator(yas::kDefaultClusterSize);
+  const auto class_id = allocator.GetClassId(64);
+  allocator.AddSlab(0x1000, class_id);
+  allocator.AddSlab(0x3000, class_id);
+
+  // the slot is taken only from the slab before the limit and only if the slot is before it too
+  EXPECT_FALSE(yas::offset_traits<yas::DOffsetType>::IsExistValue(allocator.PopLowerFreeSlot(class_id, 0x1000)));
+  EXPECT_FALSE(yas::offset_traits<yas::DOffsetType>::IsExistValue(allocator.PopLowerFreeSlot(class_id, 0x1040)));
+  EXPECT_EQ(0x1040, allocator.PopLowerFreeSlot(class_id, 0x3000));
+  EXPECT_EQ(0x1080, allocator.PopFreeSlot(class_id));
+}
+
+TEST(SlabAllocator, ReleaseTest) {
+  SlabAllocatorType allocator(yas::kDefaultClusterSize);
+  const auto class_id = allocator.GetClassId(100);
+  allocator.AddSlab(0x1000, class_id);
+  allocator.PopFreeSlot(class_id);
+  allocator.FreeSlot(0x1000);
+
+  // only the second slot is used, the rest of the cluster is free
+  const auto used_slots = allocator.GetUsedSlots();
+  ASSERT_EQ(1, used_slots.size());
+  EXPECT_EQ(0x1080, used_slots[0].first);
+  EXPECT_EQ(128, used_slots[0].second);
+  const auto free_slots = allocator.ReleaseAll();
+  EXPECT_EQ(0, allocator.slabs_count());
+  ASSERT_EQ(2, free_slots.size());
+  EXPECT_EQ(0x1000, free_slots[0].first);
+  EXPECT_EQ(128, free_slots[0].second);
+  EXPECT_EQ(0x1100, free_slots[1].first);
+  EXPECT_EQ(yas::kDefaultClusterSize - 256, free_slots[1].second);
+}
+
+}